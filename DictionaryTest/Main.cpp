@@ -0,0 +1,309 @@
+﻿/// @file Main.cpp
+/// @brief Dictionary的差分测试与性能测试
+/// @note  差分测试以随机操作序列对比Dictionary与std::unordered_map的行为；
+///        性能测试在100到50000个条目下对比Dictionary与原先基于MPQHash的std::unordered_map实现。
+///        用法: DictionaryTest [随机种子]，差分测试失败时返回1。
+#include "../LuaSTGPlus/Dictionary.hpp"
+
+#include <random>
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+namespace Baseline
+{
+	/// @brief 原先的Dictionary实现（不含LDEBUG下的键校验），仅用于性能对比
+	class MPQHashCryptTable
+	{
+	public:
+		static const MPQHashCryptTable& GetInstance()
+		{
+			static MPQHashCryptTable s_Table;
+			return s_Table;
+		}
+	private:
+		uint32_t m_CryptTable[0x500];
+	public:
+		uint32_t operator[](uint32_t idx)const
+		{
+			return m_CryptTable[idx];
+		}
+	public:
+		MPQHashCryptTable()
+		{
+			uint32_t seed = 0x00100001;
+			for (uint32_t index1 = 0; index1 < 0x100; index1++)
+			{
+				for (uint32_t index2 = index1, i = 0; i < 5; i++, index2 += 0x100)
+				{
+					unsigned long temp1, temp2;
+					seed = (seed * 125 + 3) % 0x2AAAAB;
+					temp1 = (seed & 0xFFFF) << 0x10;
+					seed = (seed * 125 + 3) % 0x2AAAAB;
+					temp2 = (seed & 0xFFFF);
+					m_CryptTable[index2] = (temp1 | temp2);
+				}
+			}
+		}
+	};
+
+	template <uint32_t dwHashType>
+	uint32_t MPQHash(const char* key)
+	{
+		uint32_t seed1 = 0x7FED7FED, seed2 = 0xEEEEEEEE;
+		uint32_t ch;
+		while (*key != 0)
+		{
+			ch = static_cast<unsigned char>(*key++);
+			seed1 = MPQHashCryptTable::GetInstance()[(dwHashType << 8) + ch] ^ (seed1 + seed2);
+			seed2 = ch + seed1 + seed2 + (seed2 << 5) + 3;
+		}
+		return seed1;
+	}
+
+	struct DictionaryKey
+	{
+		uint32_t HashKey;
+		uint32_t Hash1, Hash2;
+
+		bool operator==(const DictionaryKey& right)const
+		{
+			return (HashKey == right.HashKey && Hash1 == right.Hash1 &&
+				Hash2 == right.Hash2);
+		}
+
+		DictionaryKey(const char* KeyStr)
+		{
+			HashKey = MPQHash<0>(KeyStr);
+			Hash1 = MPQHash<1>(KeyStr);
+			Hash2 = MPQHash<2>(KeyStr);
+		}
+	};
+
+	struct DictionaryKeyHasher
+	{
+		size_t operator()(const DictionaryKey& k)const
+		{
+			return k.HashKey;
+		}
+	};
+
+	template <typename Value>
+	using Dictionary = std::unordered_map<DictionaryKey, Value, DictionaryKeyHasher>;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 差分测试
+////////////////////////////////////////////////////////////////////////////////
+
+static int s_iFailures = 0;
+
+#define CHECK(cond) \
+	if (!(cond)) \
+	{ \
+		if (s_iFailures++ < 16) \
+			printf("check failed at line %d (step %u): %s\n", __LINE__, tStep, #cond); \
+	}
+
+/// @brief 生成随机键，键空间较小以便反复命中同一个键
+static string RandomKey(mt19937& rnd, unsigned keySpace)
+{
+	static const char* const s_Prefix[] = { "", "image:", "bullet_", "laser_bent_", "a" };
+	unsigned tId = rnd() % keySpace;
+	string tRet = s_Prefix[tId % 5];
+	tRet += to_string(tId);
+	return tRet;
+}
+
+static bool SameContents(const Dictionary<int>& dict, const unordered_map<string, int>& ref)
+{
+	if (dict.size() != ref.size())
+		return false;
+	size_t tCount = 0;
+	for (Dictionary<int>::const_iterator i = dict.begin(); i != dict.end(); ++i)
+	{
+		unordered_map<string, int>::const_iterator j = ref.find(i->first);
+		if (j == ref.end() || j->second != i->second)
+			return false;
+		++tCount;
+	}
+	return tCount == ref.size();
+}
+
+static void RunDifferentialTest(unsigned seed, unsigned steps, unsigned keySpace)
+{
+	mt19937 tRnd(seed);
+	Dictionary<int> tDict;
+	unordered_map<string, int> tRef;
+
+	for (unsigned tStep = 0; tStep < steps; ++tStep)
+	{
+		string tKey = RandomKey(tRnd, keySpace);
+		unsigned tOp = tRnd() % 100;
+		if (tOp < 35)  // emplace
+		{
+			int tValue = (int)tRnd();
+			pair<Dictionary<int>::iterator, bool> r1 = tDict.emplace(tKey.c_str(), tValue);
+			pair<unordered_map<string, int>::iterator, bool> r2 = tRef.emplace(tKey, tValue);
+			CHECK(r1.second == r2.second);
+			CHECK(r1.first->first == tKey);
+			CHECK(r1.first->second == r2.first->second);
+		}
+		else if (tOp < 45)  // operator[]
+		{
+			int tValue = (int)tRnd();
+			tDict[tKey.c_str()] = tValue;
+			tRef[tKey] = tValue;
+		}
+		else if (tOp < 75)  // find
+		{
+			Dictionary<int>::iterator i = tDict.find(tKey.c_str());
+			unordered_map<string, int>::iterator j = tRef.find(tKey);
+			CHECK((i == tDict.end()) == (j == tRef.end()));
+			if (i != tDict.end() && j != tRef.end())
+			{
+				CHECK(i->first == j->first);
+				CHECK(i->second == j->second);
+			}
+		}
+		else if (tOp < 97)  // erase
+		{
+			Dictionary<int>::iterator i = tDict.find(tKey.c_str());
+			unordered_map<string, int>::iterator j = tRef.find(tKey);
+			CHECK((i == tDict.end()) == (j == tRef.end()));
+			if (i != tDict.end())
+				tDict.erase(i);
+			if (j != tRef.end())
+				tRef.erase(j);
+		}
+		else if (tOp < 98)  // reserve
+		{
+			tDict.reserve(tRnd() % (keySpace * 2));
+		}
+		else if (tRnd() % 20 == 0)  // clear，保持较低频率以免表总是很小
+		{
+			tDict.clear();
+			tRef.clear();
+		}
+
+		CHECK(tDict.size() == tRef.size());
+		if (tStep % 1024 == 0 || tStep + 1 == steps)
+			CHECK(SameContents(tDict, tRef));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 性能测试
+////////////////////////////////////////////////////////////////////////////////
+
+static int s_iChecksum = 0;  // 防止查找被优化掉
+
+struct BenchResult
+{
+	double insert;  // 每次操作的纳秒数
+	double findHit;
+	double findMiss;
+};
+
+template <typename Map>
+static BenchResult RunBench(const vector<string>& keys, const vector<string>& missKeys, size_t rounds)
+{
+	BenchResult tRet;
+
+	// 插入，每轮使用一个新的表
+	double tElapsed = 0.;
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		Map tMap;
+		fcyStopWatch tWatch;
+		for (size_t i = 0; i < keys.size(); ++i)
+			tMap.emplace(keys[i].c_str(), (int)i);
+		tElapsed += tWatch.GetElapsed();
+		s_iChecksum += (int)tMap.size();
+	}
+	tRet.insert = tElapsed * 1e9 / (double)(rounds * keys.size());
+
+	Map tMap;
+	for (size_t i = 0; i < keys.size(); ++i)
+		tMap.emplace(keys[i].c_str(), (int)i);
+
+	// 命中
+	{
+		fcyStopWatch tWatch;
+		for (size_t r = 0; r < rounds; ++r)
+		{
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				typename Map::iterator j = tMap.find(keys[i].c_str());
+				if (j != tMap.end())
+					s_iChecksum += j->second;
+			}
+		}
+		tRet.findHit = tWatch.GetElapsed() * 1e9 / (double)(rounds * keys.size());
+	}
+
+	// 未命中
+	{
+		fcyStopWatch tWatch;
+		for (size_t r = 0; r < rounds; ++r)
+		{
+			for (size_t i = 0; i < missKeys.size(); ++i)
+			{
+				if (tMap.find(missKeys[i].c_str()) != tMap.end())
+					++s_iChecksum;
+			}
+		}
+		tRet.findMiss = tWatch.GetElapsed() * 1e9 / (double)(rounds * missKeys.size());
+	}
+
+	return tRet;
+}
+
+static void RunBenchmarks()
+{
+	static const size_t s_Sizes[] = { 100, 1000, 10000, 50000 };
+	static const size_t s_OpsPerCase = 2000000;  // 每项约执行的操作数
+
+	printf("%8s  %-10s %10s %10s %10s\n", "entries", "impl", "insert", "find hit", "find miss");
+	for (size_t s = 0; s < sizeof(s_Sizes) / sizeof(s_Sizes[0]); ++s)
+	{
+		size_t tCount = s_Sizes[s];
+		size_t tRounds = max<size_t>(s_OpsPerCase / tCount, 1);
+
+		// 形如资源名的键，未命中的键与命中的键有相同的前缀和长度分布
+		vector<string> tKeys, tMissKeys;
+		tKeys.reserve(tCount);
+		tMissKeys.reserve(tCount);
+		for (size_t i = 0; i < tCount; ++i)
+		{
+			tKeys.push_back("image:bullet_" + to_string(i * 2));
+			tMissKeys.push_back("image:bullet_" + to_string(i * 2 + 1));
+		}
+
+		BenchResult tNew = RunBench<Dictionary<int>>(tKeys, tMissKeys, tRounds);
+		BenchResult tOld = RunBench<Baseline::Dictionary<int>>(tKeys, tMissKeys, tRounds);
+		printf("%8u  %-10s %8.1fns %8.1fns %8.1fns\n", (unsigned)tCount, "Dictionary", tNew.insert, tNew.findHit, tNew.findMiss);
+		printf("%8u  %-10s %8.1fns %8.1fns %8.1fns\n", (unsigned)tCount, "baseline", tOld.insert, tOld.findHit, tOld.findMiss);
+	}
+	printf("(checksum %d)\n", s_iChecksum);
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned tSeed = argc > 1 ? (unsigned)strtoul(argv[1], nullptr, 10) : 1;
+
+	// 小键空间使探测簇与后移删除被反复触发，大键空间覆盖多次扩容
+	printf("differential test (seed %u)...\n", tSeed);
+	RunDifferentialTest(tSeed, 200000, 64);
+	RunDifferentialTest(tSeed + 1, 200000, 4096);
+	RunDifferentialTest(tSeed + 2, 500000, 60000);
+	if (s_iFailures > 0)
+	{
+		printf("differential test FAILED: %d check(s)\n", s_iFailures);
+		return 1;
+	}
+	printf("differential test passed\n\n");
+
+	RunBenchmarks();
+	return 0;
+}
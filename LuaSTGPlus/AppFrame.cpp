@@ -1,6 +1,7 @@
 ﻿#include "AppFrame.h"
 #include "Utility.h"
 #include "LuaWrapper.h"
+#include "Profiler.h"
 
 #include "resource.h"
 
@@ -337,6 +338,8 @@ LNOINLINE AppFrame& AppFrame::GetInstance()
 
 AppFrame::AppFrame()
 {
+	memset(&m_RenderStats, 0, sizeof(m_RenderStats));
+	memset(&m_RenderStatsLast, 0, sizeof(m_RenderStatsLast));
 }
 
 AppFrame::~AppFrame()
@@ -351,6 +354,9 @@ AppFrame::~AppFrame()
 #pragma region 脚本接口
 LNOINLINE void AppFrame::ShowSplashWindow(const char* imgPath)LNOEXCEPT
 {
+	if (m_bHeadless)
+		return;
+
 	if (m_iStatus == AppStatus::Initializing)
 	{
 		try
@@ -437,9 +443,17 @@ LNOINLINE void AppFrame::SetTitle(const char* v)LNOEXCEPT
 	}
 }
 
+void AppFrame::SetWorkerCount(int v)LNOEXCEPT
+{
+	if (m_iStatus == AppStatus::Initializing)
+		m_OptionWorkerCount = v;
+	else if (m_iStatus == AppStatus::Running)
+		LWARNING("试图在运行时更改工作线程数");
+}
+
 LNOINLINE bool AppFrame::ChangeVideoMode(int width, int height, bool windowed, bool vsync)LNOEXCEPT
 {
-	if (m_iStatus == AppStatus::Initialized)
+	if (m_iStatus == AppStatus::Initialized && !m_bHeadless)
 	{
 		// 切换到新的视频选项
 		if (FCYOK(m_pRenderDev->SetBufferSize(
@@ -521,6 +535,9 @@ LNOINLINE void AppFrame::LoadScript(const char* path)LNOEXCEPT
 
 fBool AppFrame::GetKeyState(int VKCode)LNOEXCEPT
 {
+	if (m_Replay.IsPlaying())  // 回放时只使用录像中的输入
+		return m_Replay.GetKeyState(VKCode);
+
 	if (VKCode > 0 && VKCode < _countof(m_KeyStateMap))
 	{
 		if (LJOYSTICK1_MAPPING_START <= VKCode && VKCode <= LJOYSTICK1_MAPPING_END)  // joystick1映射区域
@@ -602,7 +619,7 @@ bool AppFrame::BeginScene()LNOEXCEPT
 		return false;
 	}
 
-	if (m_GraphType == GraphicsType::Graph2D)
+	if (m_GraphType == GraphicsType::Graph2D && !m_bHeadless)
 	{
 		if (FCYFAILED(m_Graph2D->Begin()))
 		{
@@ -616,7 +633,7 @@ bool AppFrame::BeginScene()LNOEXCEPT
 
 bool AppFrame::EndScene()LNOEXCEPT
 {
-	if (m_GraphType == GraphicsType::Graph2D)
+	if (m_GraphType == GraphicsType::Graph2D && !m_bHeadless)
 	{
 		if (FCYFAILED(m_Graph2D->End()))
 		{
@@ -630,6 +647,9 @@ bool AppFrame::EndScene()LNOEXCEPT
 
 void AppFrame::SetFog(float start, float end, fcyColor color)
 {
+	if (m_bHeadless)
+		return;
+
 	if (m_Graph2D->IsInRender())
 		m_Graph2D->Flush();
 
@@ -668,6 +688,16 @@ bool AppFrame::RenderText(ResFont* p, wchar_t* strBuf, fcyRect rect, fcyVec2 sca
 		LERROR("RenderText: 只有2D渲染器可以执行该方法");
 		return false;
 	}
+	fuInt tGlyphs = 0;
+	for (const wchar_t* pText = strBuf; *pText; ++pText)
+	{
+		if (*pText != L'\n')
+			++tGlyphs;
+	}
+	m_RenderStats.glyphs += tGlyphs;
+	countQuads(tGlyphs);
+	if (headlessDraw())
+		return true;
 
 	f2dFontProvider* pFontProvider = p->GetFontProvider();
 
@@ -817,6 +847,8 @@ fcyVec2 AppFrame::CalcuTextSize(ResFont* p, const wchar_t* strBuf, fcyVec2 scale
 		LERROR("RenderText: 只有2D渲染器可以执行该方法");
 		return false;
 	}
+	if (m_bHeadless)  // 无窗口模式下没有字形数据
+		return fcyVec2();
 
 	f2dFontProvider* pFontProvider = p->GetFontProvider();
 
@@ -844,14 +876,9 @@ fcyVec2 AppFrame::CalcuTextSize(ResFont* p, const wchar_t* strBuf, fcyVec2 scale
 	return fcyVec2(fMaxLineWidth, iLineCount * pFontProvider->GetLineHeight() * scale.y);
 }
 
-LNOINLINE bool AppFrame::RenderText(const char* name, const char* str, float x, float y, float scale, ResFont::FontAlignHorizontal halign, ResFont::FontAlignVertical valign)LNOEXCEPT
+LNOINLINE bool AppFrame::RenderText(ResFont* p, const char* str, float x, float y, float scale, ResFont::FontAlignHorizontal halign, ResFont::FontAlignVertical valign)LNOEXCEPT
 {
-	fcyRefPointer<ResFont> p = m_ResourceMgr.FindSpriteFont(name);
-	if (!p)
-	{
-		LERROR("RenderText: 找不到文字资源'%m'", name);
-		return false;
-	}
+	LASSERT(p);
 
 	// 编码转换
 	static std::wstring s_TempStringBuf;
@@ -903,14 +930,20 @@ LNOINLINE bool AppFrame::RenderText(const char* name, const char* str, float x,
 		);
 }
 
-LNOINLINE bool AppFrame::RenderTTF(const char* name, const char* str, float left, float right, float bottom, float top, float scale, int format, fcyColor c)LNOEXCEPT
+LNOINLINE bool AppFrame::RenderText(const char* name, const char* str, float x, float y, float scale, ResFont::FontAlignHorizontal halign, ResFont::FontAlignVertical valign)LNOEXCEPT
 {
-	fcyRefPointer<ResFont> p = m_ResourceMgr.FindTTFFont(name);
+	fcyRefPointer<ResFont> p = m_ResourceMgr.FindSpriteFont(name);
 	if (!p)
 	{
-		LERROR("RenderTTF: 找不到文字资源'%m'", name);
+		LERROR("RenderText: 找不到文字资源'%m'", name);
 		return false;
 	}
+	return RenderText(p, str, x, y, scale, halign, valign);
+}
+
+LNOINLINE bool AppFrame::RenderTTF(ResFont* p, const char* str, float left, float right, float bottom, float top, float scale, int format, fcyColor c)LNOEXCEPT
+{
+	LASSERT(p);
 
 	// 编码转换
 	static std::wstring s_TempStringBuf;
@@ -954,8 +987,22 @@ LNOINLINE bool AppFrame::RenderTTF(const char* name, const char* str, float left
 		);
 }
 
+LNOINLINE bool AppFrame::RenderTTF(const char* name, const char* str, float left, float right, float bottom, float top, float scale, int format, fcyColor c)LNOEXCEPT
+{
+	fcyRefPointer<ResFont> p = m_ResourceMgr.FindTTFFont(name);
+	if (!p)
+	{
+		LERROR("RenderTTF: 找不到文字资源'%m'", name);
+		return false;
+	}
+	return RenderTTF(p, str, left, right, bottom, top, scale, format, c);
+}
+
 LNOINLINE void AppFrame::SnapShot(const char* path)LNOEXCEPT
 {
+	if (m_bHeadless)
+		return;
+
 	LASSERT(m_pRenderDev);
 
 	try
@@ -995,21 +1042,29 @@ bool AppFrame::CheckRenderTargetInUse(ResTexture* rt)LNOEXCEPT
 
 bool AppFrame::PushRenderTarget(fcyRefPointer<f2dTexture2D> rt)LNOEXCEPT
 {
-	fcyRect orgVP = m_pRenderDev->GetViewport();
-	if (FCYFAILED(m_pRenderDev->SetRenderTarget(rt)))
+	// 无窗口模式下只维护RenderTarget栈以保证调用检查的一致
+	fcyRect orgVP;
+	if (!m_bHeadless)
 	{
-		LERROR("PushRenderTarget: 内部错误 (f2dRenderDevice::SetRenderTarget failed.)");
-		return false;
+		orgVP = m_pRenderDev->GetViewport();
+		if (FCYFAILED(m_pRenderDev->SetRenderTarget(rt)))
+		{
+			LERROR("PushRenderTarget: 内部错误 (f2dRenderDevice::SetRenderTarget failed.)");
+			return false;
+		}
+		m_pRenderDev->SetViewport(orgVP);
 	}
-	m_pRenderDev->SetViewport(orgVP);
 
 	try
 	{
 		m_stRenderTargetStack.push_back(rt);
+		++m_RenderStats.renderTargetPushes;
 	}
 	catch (const std::bad_alloc&)
 	{
 		LERROR("PushRenderTarget: 内存不足");
+		if (m_bHeadless)
+			return false;
 		if (m_stRenderTargetStack.empty())
 			m_pRenderDev->SetRenderTarget(nullptr);
 		else
@@ -1051,6 +1106,13 @@ LNOINLINE bool AppFrame::PopRenderTarget()LNOEXCEPT
 		LERROR("PopRenderTarget: RenderTarget栈为空");
 		return false;
 	}
+	++m_RenderStats.renderTargetPops;
+
+	if (m_bHeadless)
+	{
+		m_stRenderTargetStack.pop_back();
+		return true;
+	}
 
 	fcyRect orgVP = m_pRenderDev->GetViewport();
 
@@ -1066,6 +1128,10 @@ LNOINLINE bool AppFrame::PopRenderTarget()LNOEXCEPT
 
 bool AppFrame::PostEffect(fcyRefPointer<f2dTexture2D> rt, ResFX* shader, BlendMode blend)LNOEXCEPT
 {
+	++m_RenderStats.postEffects;
+	if (headlessDraw())
+		return true;
+
 	f2dEffectTechnique* pTechnique = shader->GetEffect()->GetTechnique(0U);
 
 	if (!pTechnique)
@@ -1173,7 +1239,8 @@ LNOINLINE bool AppFrame::PostEffectCapture()LNOEXCEPT
 	}
 
 	PushRenderTarget(m_PostEffectBuffer);
-	m_pRenderDev->ClearColor();
+	if (!m_bHeadless)
+		m_pRenderDev->ClearColor();
 	m_bPostEffectCaptureStarted = true;
 	return true;
 }
@@ -1229,99 +1296,8 @@ static int StackTraceback(lua_State *L)
 	return 1;
 }
 
-bool AppFrame::Init()LNOEXCEPT
+bool AppFrame::initEngine()LNOEXCEPT
 {
-	LASSERT(m_iStatus == AppStatus::NotInitialized);
-
-	LINFO("开始初始化 版本: %s", LVERSION);
-	m_iStatus = AppStatus::Initializing;
-
-	Scope tSplashWindowExit([this]() {
-		m_SplashWindow.HideSplashWindow();
-	});
-
-	//////////////////////////////////////// Lua初始化部分
-	LINFO("开始初始化Lua虚拟机 版本: %m", LVERSION_LUA);
-	L = lua_open();
-	if (!L)
-	{
-		LERROR("无法初始化Lua虚拟机");
-		return false;
-	}
-	if (0 != luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON))
-		LWARNING("无法启动JIT模式");
-
-	lua_gc(L, LUA_GCSTOP, 0);  // 初始化时关闭GC
-
-	luaL_openlibs(L);  // 内建库
-	luaopen_lfs(L);  // 文件系统库
-	luaopen_cjson(L);  // CJSON库
-	ColorWrapper::Register(L);  // 颜色对象
-	RandomizerWrapper::Register(L);  // 随机数发生器
-	BentLaserDataWrapper::Register(L);  // 曲线激光
-	BuiltInFunctionWrapper::Register(L);  // 内建函数库
-
-	lua_gc(L, LUA_GCRESTART, -1);  // 重启GC
-
-	// 为对象池分配空间
-	LINFO("初始化对象池 上限=%u", LGOBJ_MAXCNT);
-	try
-	{
-		m_GameObjectPool = make_unique<GameObjectPool>(L);
-	}
-	catch (const bad_alloc&)
-	{
-		LERROR("无法为对象池分配足够内存");
-		return false;
-	}
-
-	// 设置命令行参数
-	regex tDebuggerPattern("\\/debugger:(\\d+)");
-	lua_getglobal(L, "lstg");  // t
-	lua_newtable(L);  // t t
-	for (int i = 0, c = 1; i < __argc; ++i)
-	{
-		cmatch tMatch;
-		if (regex_match(__argv[i], tMatch, tDebuggerPattern))
-		{
-#if (defined LDEVVERSION) || (defined LDEBUG)
-			// 创建调试器
-			if (!m_DebuggerClient)
-			{
-				fuShort tPort = atoi(tMatch[1].first);
-				
-				try
-				{
-					m_DebuggerClient = make_unique<RemoteDebuggerClient>(tPort);
-					LINFO("调试器已创建，于端口：%d", (fuInt)tPort);
-				}
-				catch (const fcyException& e)
-				{
-					LERROR("创建调试器失败 (详细信息: %m)", e.GetDesc());
-				}
-			}
-			else
-				LWARNING("命令行参数中带有多个/debugger项，忽略。");
-#endif
-			// 不将debugger项传入用户命令行参数中
-			continue;
-		}
-		lua_pushinteger(L, c++);  // t t i
-		lua_pushstring(L, __argv[i]);  // t t i s
-		lua_settable(L, -3);  // t t
-	}
-	lua_setfield(L, -2, "args");  // t
-	lua_pop(L, 1);
-
-	//////////////////////////////////////// 装载初始化脚本
-	LINFO("装载初始化脚本'%s'", LLAUNCH_SCRIPT);
-	fcyRefPointer<fcyMemStream> tMemStream;
-	if (!m_ResourceMgr.LoadFile(LLAUNCH_SCRIPT, tMemStream))
-		return false;
-	if (!SafeCallScript((fcStr)tMemStream->GetInternalBuffer(), (size_t)tMemStream->GetLength(), "launch"))
-		return false;
-	
-	//////////////////////////////////////// 初始化fancy2d引擎
 	LINFO("初始化fancy2d 版本 %d.%d (分辨率: %dx%d 垂直同步: %b 窗口化: %b)",
 		(F2DVERSION & 0xFFFF0000) >> 16, F2DVERSION & 0x0000FFFF,
 		(int)m_OptionResolution.x, (int)m_OptionResolution.y, m_OptionVsync, m_OptionWindowed);
@@ -1361,7 +1337,8 @@ bool AppFrame::Init()LNOEXCEPT
 	LINFO("CPU %m %m / GPU %m", stCPUInfo.CPUBrandString, stCPUInfo.CPUString, m_pRenderDev->GetDeviceName());
 
 	// 创建渲染器
-	if (FCYFAILED(m_pRenderDev->CreateGraphics2D(1024, 2048, &m_Graph2D)))
+	// 索引缓冲需要容纳一条曲线激光的全部线段((LGOBJ_MAXLASERNODE - 1) * 6个索引)
+	if (FCYFAILED(m_pRenderDev->CreateGraphics2D(1024, 4096, &m_Graph2D)))
 	{
 		LERROR("无法创建渲染器 (fcyRenderDevice::CreateGraphics2D failed)");
 		return false;
@@ -1438,6 +1415,177 @@ bool AppFrame::Init()LNOEXCEPT
 		m_pMainWindow->SetVisiable(true);
 	}
 
+	return true;
+}
+
+bool AppFrame::Init()LNOEXCEPT
+{
+	LASSERT(m_iStatus == AppStatus::NotInitialized);
+
+	LINFO("开始初始化 版本: %s", LVERSION);
+	m_iStatus = AppStatus::Initializing;
+	LPROFILER.RegisterThread("Main");
+
+	Scope tSplashWindowExit([this]() {
+		m_SplashWindow.HideSplashWindow();
+	});
+
+	//////////////////////////////////////// Lua初始化部分
+	LINFO("开始初始化Lua虚拟机 版本: %m", LVERSION_LUA);
+	L = lua_open();
+	if (!L)
+	{
+		LERROR("无法初始化Lua虚拟机");
+		return false;
+	}
+	if (0 != luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON))
+		LWARNING("无法启动JIT模式");
+
+	lua_gc(L, LUA_GCSTOP, 0);  // 初始化时关闭GC
+
+	luaL_openlibs(L);  // 内建库
+	luaopen_lfs(L);  // 文件系统库
+	luaopen_cjson(L);  // CJSON库
+	ColorWrapper::Register(L);  // 颜色对象
+	RandomizerWrapper::Register(L);  // 随机数发生器
+	BentLaserDataWrapper::Register(L);  // 曲线激光
+	ResourceHandleWrapper::Register(L);  // 资源句柄
+	BuiltInFunctionWrapper::Register(L);  // 内建函数库
+
+	lua_gc(L, LUA_GCRESTART, -1);  // 重启GC
+
+	// 为对象池分配空间
+	LINFO("初始化对象池 上限=%u", LGOBJ_MAXCNT);
+	try
+	{
+		m_GameObjectPool = make_unique<GameObjectPool>(L);
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("无法为对象池分配足够内存");
+		return false;
+	}
+
+	// 设置命令行参数
+	regex tDebuggerPattern("\\/debugger:(\\d+)");
+	regex tHeadlessPattern("\\/headless(?::(\\d+))?");
+	regex tRecordPattern("\\/record:(.+)");
+	regex tBenchmarkPattern("\\/benchmark:(.+)");
+	regex tReplayPattern("\\/replay:(.+)");
+	regex tSamplePattern("\\/sample:(.+)");
+	wstring tRecordPath, tReplayPath;
+	lua_getglobal(L, "lstg");  // t
+	lua_newtable(L);  // t t
+	for (int i = 0, c = 1; i < __argc; ++i)
+	{
+		cmatch tMatch;
+		if (regex_match(__argv[i], tMatch, tDebuggerPattern))
+		{
+#if (defined LDEVVERSION) || (defined LDEBUG)
+			// 创建调试器
+			if (!m_DebuggerClient)
+			{
+				fuShort tPort = atoi(tMatch[1].first);
+				
+				try
+				{
+					m_DebuggerClient = make_unique<RemoteDebuggerClient>(tPort);
+					LINFO("调试器已创建，于端口：%d", (fuInt)tPort);
+				}
+				catch (const fcyException& e)
+				{
+					LERROR("创建调试器失败 (详细信息: %m)", e.GetDesc());
+				}
+			}
+			else
+				LWARNING("命令行参数中带有多个/debugger项，忽略。");
+#endif
+			// 不将debugger项传入用户命令行参数中
+			continue;
+		}
+		if (regex_match(__argv[i], tMatch, tHeadlessPattern))
+		{
+			m_bHeadless = true;
+			if (tMatch[1].matched)
+				m_iHeadlessFrameLimit = (fuInt)atoi(tMatch[1].first);
+			continue;
+		}
+		if (regex_match(__argv[i], tMatch, tBenchmarkPattern))
+		{
+			// 基准测试总是在无窗口模式下执行
+			m_bHeadless = true;
+			m_Benchmark.Enable(fcyStringHelper::MultiByteToWideChar(tMatch[1].str(), CP_ACP));
+			continue;
+		}
+		if (regex_match(__argv[i], tMatch, tRecordPattern))
+		{
+			tRecordPath = fcyStringHelper::MultiByteToWideChar(tMatch[1].str(), CP_ACP);
+			continue;
+		}
+		if (regex_match(__argv[i], tMatch, tReplayPattern))
+		{
+			tReplayPath = fcyStringHelper::MultiByteToWideChar(tMatch[1].str(), CP_ACP);
+			continue;
+		}
+		if (regex_match(__argv[i], tMatch, tSamplePattern))
+		{
+			m_SamplerPath = fcyStringHelper::MultiByteToWideChar(tMatch[1].str(), CP_ACP);
+			continue;
+		}
+		lua_pushinteger(L, c++);  // t t i
+		lua_pushstring(L, __argv[i]);  // t t i s
+		lua_settable(L, -3);  // t t
+	}
+	lua_setfield(L, -2, "args");  // t
+	lua_pop(L, 1);
+
+	// 开始录制或回放，需要在执行任何脚本之前进行以便捕获初始化时设置的随机数种子
+	if (!tReplayPath.empty())
+	{
+		if (!tRecordPath.empty())
+			LWARNING("命令行参数中同时带有/record与/replay项，忽略/record。");
+		if (!m_Replay.StartPlayback(tReplayPath.c_str()))
+			return false;
+	}
+	else if (!tRecordPath.empty())
+	{
+		if (!m_Replay.StartRecording(tRecordPath.c_str()))
+			return false;
+	}
+
+	// 从初始化脚本开始采样直到退出
+	if (!m_SamplerPath.empty())
+		m_Sampler.Start(L, LSAMPLER_INTERVAL);
+
+	//////////////////////////////////////// 装载初始化脚本
+	LINFO("装载初始化脚本'%s'", LLAUNCH_SCRIPT);
+	fcyRefPointer<fcyMemStream> tMemStream;
+	if (!m_ResourceMgr.LoadFile(LLAUNCH_SCRIPT, tMemStream))
+		return false;
+	if (!SafeCallScript((fcStr)tMemStream->GetInternalBuffer(), (size_t)tMemStream->GetLength(), "launch"))
+		return false;
+
+	// 创建工作线程
+	size_t tWorkerCount = m_OptionWorkerCount < 0 ?
+		max(thread::hardware_concurrency(), 1U) - 1 : (size_t)m_OptionWorkerCount;
+	tWorkerCount = min<size_t>(tWorkerCount, LWORKER_MAXCNT);
+	LINFO("初始化工作线程池 线程数=%u", tWorkerCount);
+	try
+	{
+		m_WorkerPool = make_unique<WorkerPool>(tWorkerCount);
+	}
+	catch (const exception&)
+	{
+		LERROR("无法创建工作线程");
+		return false;
+	}
+	
+	//////////////////////////////////////// 初始化fancy2d引擎
+	if (m_bHeadless)
+		LINFO("以无窗口模式运行，不创建窗口、渲染器、声音与输入设备 (帧数上限: %u)", m_iHeadlessFrameLimit);
+	else if (!initEngine())
+		return false;
+
 	m_LastChar = 0;
 	m_LastKey = 0;
 	::memset(m_KeyStateMap, 0, sizeof(m_KeyStateMap));
@@ -1459,9 +1607,18 @@ bool AppFrame::Init()LNOEXCEPT
 
 void AppFrame::Shutdown()LNOEXCEPT
 {
+	m_Replay.Stop();
+	LPROFILER.EndCapture();
+	m_Sampler.Stop();
+	if (!m_SamplerPath.empty())
+		m_Sampler.Save(m_SamplerPath);
+
 	m_GameObjectPool = nullptr;
 	LINFO("已清空对象池");
 
+	m_WorkerPool = nullptr;
+	LINFO("已结束工作线程");
+
 	m_ResourceMgr.ClearAllResource();
 	LINFO("已清空所有资源");
 
@@ -1499,17 +1656,25 @@ void AppFrame::Run()LNOEXCEPT
 	LINFO("开始执行游戏循环");
 
 	m_fFPS = 0.f;
-#if (defined LDEVVERSION) || (defined LDEBUG)
 	m_UpdateTimer = 0.f;
 	m_RenderTimer = 0.f;
+#if (defined LDEVVERSION) || (defined LDEBUG)
 	m_PerformanceUpdateTimer = 0.f;
 	m_PerformanceUpdateCounter = 0.f;
 	m_FPSTotal = 0.f;
 	m_ObjectTotal = 0.f;
 	m_UpdateTimerTotal = 0.f;
 	m_RenderTimerTotal = 0.f;
+	m_FrameStatsInterval.Reset();
 #endif
 
+	if (m_bHeadless)
+	{
+		runHeadless();
+		LINFO("退出游戏循环");
+		return;
+	}
+
 	if (m_bSplashWindowEnabled)  // 显示过载入窗口
 	{
 		// 显示窗口
@@ -1535,6 +1700,123 @@ void AppFrame::Run()LNOEXCEPT
 	LINFO("退出游戏循环");
 }
 
+void AppFrame::runHeadless()LNOEXCEPT
+{
+	// 不限速地执行FrameFunc与RenderFunc，没有消息循环，输入为空或来自录像
+	fcyStopWatch tStopWatch;
+	fuInt tFrameCount = 0;
+	m_iHeadlessDrawCount = 0;
+
+	// 阶段计时在每帧结束时转存，帧内读到的仍是上一帧的结果
+	m_GameObjectPool->BeginPhaseTimer();
+
+	while (m_iHeadlessFrameLimit == 0 || tFrameCount < m_iHeadlessFrameLimit)
+	{
+		LPROFILER.FrameMark();
+
+		m_LastKey = 0;
+		if (!updateReplay())
+			break;
+		++tFrameCount;
+
+		// 执行帧函数
+		fcyStopWatch tFrameWatch;
+		bool tFrameResult;
+		{
+			LPROFILE_ZONE("FrameFunc");
+			SamplerContext tSamplerContext(m_Sampler, "FrameFunc");
+			tFrameResult = SafeCallGlobalFunction(LFUNC_FRAME, 1);
+			if (tFrameResult)
+				m_GameObjectPool->UpdateParticles();  // 脚本没有调用UpdateParticles时补做
+		}
+		if (!tFrameResult)
+		{
+			m_iExitCode = 1;
+			break;
+		}
+		bool tAbort = lua_toboolean(L, -1) == 0 ? false : true;
+		lua_pop(L, 1);
+		float tFrameFuncTime = (float)tFrameWatch.GetElapsed();
+
+		// 执行渲染函数，绘制调用只计数
+		beginRenderStats();
+		m_bRenderStarted = true;
+		m_bPostEffectCaptureStarted = false;
+		bool tRenderResult;
+		{
+			LPROFILE_ZONE("RenderFunc");
+			SamplerContext tSamplerContext(m_Sampler, "RenderFunc");
+			tRenderResult = SafeCallGlobalFunction(LFUNC_RENDER, 0);
+		}
+		if (!m_stRenderTargetStack.empty())
+		{
+			LWARNING("OnRender: 渲染结束时没有推出所有的RenderTarget.");
+			m_stRenderTargetStack.clear();
+		}
+		m_bRenderStarted = false;
+		if (!tRenderResult)
+		{
+			m_iExitCode = 1;
+			break;
+		}
+		float tFrameTime = (float)tFrameWatch.GetElapsed();
+		recordFrameTime(tFrameFuncTime, tFrameTime - tFrameFuncTime);
+
+		m_GameObjectPool->BeginPhaseTimer();
+		if (m_Benchmark.IsEnabled())
+		{
+			float tTiming[BenchmarkReport::TimingCount];
+			float tPoolTime = 0.f;
+			static_assert(BenchmarkReport::TimingAfterFrame - BenchmarkReport::TimingObjFrame + 1 == (int)GameObjectPoolPhase::Count,
+				"benchmark timings mismatch pool phases.");
+			for (int i = 0; i < (int)GameObjectPoolPhase::Count; ++i)
+			{
+				tTiming[BenchmarkReport::TimingObjFrame + i] = m_GameObjectPool->GetPhaseTime((GameObjectPoolPhase)i);
+				tPoolTime += tTiming[BenchmarkReport::TimingObjFrame + i];
+			}
+			tTiming[BenchmarkReport::TimingScript] = max(tFrameFuncTime - tPoolTime, 0.f);
+			tTiming[BenchmarkReport::TimingRender] = tFrameTime - tFrameFuncTime;
+			try
+			{
+				m_Benchmark.AddFrame(tTiming, tFrameTime, m_GameObjectPool->GetObjectCount(), (size_t)lua_gc(L, LUA_GCCOUNT, 0));
+			}
+			catch (const bad_alloc&)
+			{
+				LERROR("BenchmarkReport: 内存不足");
+			}
+		}
+
+		if (tAbort)
+			break;
+	}
+
+	fDouble tElapsed = tStopWatch.GetElapsed();
+	m_fFPS = tElapsed > 0. ? tFrameCount / tElapsed : 0.;
+	LINFO("无窗口模式执行完毕 (帧数: %u 耗时: %lf秒 帧率: %lf 对象数: %u 绘制调用: %lu)",
+		tFrameCount, tElapsed, m_fFPS, (fuInt)m_GameObjectPool->GetObjectCount(), m_iHeadlessDrawCount);
+
+	if (!m_Benchmark.Save())
+		m_iExitCode = 1;
+}
+
+bool AppFrame::updateReplay()LNOEXCEPT
+{
+	if (m_Replay.IsRecording())
+	{
+		fBool tKeyState[_countof(m_KeyStateMap)] = { false };
+		for (int i = 1; i < _countof(tKeyState); ++i)
+			tKeyState[i] = GetKeyState(i);
+		m_Replay.RecordFrame(tKeyState, m_LastKey);
+	}
+	else if (m_Replay.IsPlaying())
+	{
+		if (!m_Replay.PlayFrame())
+			return false;  // 录像结束时结束循环
+		m_LastKey = m_Replay.GetLastKey();
+	}
+	return true;
+}
+
 bool AppFrame::SafeCallScript(const char* source, size_t len, const char* desc)LNOEXCEPT
 {
 	lua_pushcfunction(L, StackTraceback);
@@ -1550,12 +1832,15 @@ bool AppFrame::SafeCallScript(const char* source, size_t len, const char* desc)L
 			);
 
 			LERROR("脚本错误：%s", tErrorInfo.c_str());
-			MessageBox(
-				m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
-				tErrorInfo.c_str(),
-				L"LuaSTGPlus脚本错误",
-				MB_ICONERROR | MB_OK
-			);
+			if (!m_bHeadless)
+			{
+				MessageBox(
+					m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
+					tErrorInfo.c_str(),
+					L"LuaSTGPlus脚本错误",
+					MB_ICONERROR | MB_OK
+				);
+			}
 		}
 		catch (const bad_alloc&)
 		{
@@ -1577,12 +1862,15 @@ bool AppFrame::SafeCallScript(const char* source, size_t len, const char* desc)L
 			);
 
 			LERROR("脚本错误：%s", tErrorInfo.c_str());
-			MessageBox(
-				m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
-				tErrorInfo.c_str(),
-				L"LuaSTGPlus脚本错误",
-				MB_ICONERROR | MB_OK
-			);
+			if (!m_bHeadless)
+			{
+				MessageBox(
+					m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
+					tErrorInfo.c_str(),
+					L"LuaSTGPlus脚本错误",
+					MB_ICONERROR | MB_OK
+				);
+			}
 		}
 		catch (const bad_alloc&)
 		{
@@ -1614,12 +1902,15 @@ bool AppFrame::SafeCallGlobalFunction(const char* name, int retc)LNOEXCEPT
 			);
 
 			LERROR("脚本错误：%s", tErrorInfo.c_str());
-			MessageBox(
-				m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
-				tErrorInfo.c_str(),
-				L"LuaSTGPlus脚本错误",
-				MB_ICONERROR | MB_OK
-			);
+			if (!m_bHeadless)
+			{
+				MessageBox(
+					m_pMainWindow ? (HWND)m_pMainWindow->GetHandle() : 0,
+					tErrorInfo.c_str(),
+					L"LuaSTGPlus脚本错误",
+					MB_ICONERROR | MB_OK
+				);
+			}
 		}
 		catch (const bad_alloc&)
 		{
@@ -1638,9 +1929,12 @@ bool AppFrame::SafeCallGlobalFunction(const char* name, int retc)LNOEXCEPT
 #pragma region 游戏循环
 fBool AppFrame::OnUpdate(fDouble ElapsedTime, f2dFPSController* pFPSController, f2dMsgPump* pMsgPump)
 {
-#if (defined LDEVVERSION) || (defined LDEBUG)
+	// 多线程窗口模式下游戏循环运行在fancy2d创建的线程上，首帧时为其分配缓冲区
+	LPROFILER.RegisterThread("GameLoop");
+	LPROFILER.FrameMark();
+	LPROFILE_ZONE("OnUpdate");
+
 	TimerScope tProfileScope(m_UpdateTimer);
-#endif
 
 	m_fFPS = (float)pFPSController->GetFPS();
 
@@ -1891,12 +2185,26 @@ fBool AppFrame::OnUpdate(fDouble ElapsedTime, f2dFPSController* pFPSController,
 		}
 	}
 
-	// 执行帧函数
-	if (!SafeCallGlobalFunction(LFUNC_FRAME, 1))
+	// 录制或回放输入
+	if (!updateReplay())
 		return false;
+
+	// 执行帧函数
+	m_GameObjectPool->BeginPhaseTimer();
+	{
+		LPROFILE_ZONE("FrameFunc");
+		SamplerContext tSamplerContext(m_Sampler, "FrameFunc");
+		if (!SafeCallGlobalFunction(LFUNC_FRAME, 1))
+			return false;
+		m_GameObjectPool->UpdateParticles();  // 脚本没有调用UpdateParticles时补做
+	}
 	bool tAbort = lua_toboolean(L, -1) == 0 ? false : true;
 	lua_pop(L, 1);
 
+	// 计时器中仍是上一帧的耗时，首帧时尚未计时
+	if (m_UpdateTimer > 0.f)
+		recordFrameTime(m_UpdateTimer, m_RenderTimer);
+
 #if (defined LDEVVERSION) || (defined LDEBUG)
 	// 刷新性能计数器
 	m_PerformanceUpdateTimer += static_cast<float>(ElapsedTime);
@@ -1916,6 +2224,10 @@ fBool AppFrame::OnUpdate(fDouble ElapsedTime, f2dFPSController* pFPSController,
 				m_UpdateTimerTotal / m_PerformanceUpdateCounter,
 				m_RenderTimerTotal / m_PerformanceUpdateCounter
 				);
+			m_DebuggerClient->SendRenderStats(m_RenderStatsLast);
+			m_DebuggerClient->SendFrameStats(m_FrameStatsInterval);
+			if (m_GameObjectPool->IsClassStatsEnabled())
+				m_DebuggerClient->SendClassStats(m_GameObjectPool->GetClassStats());
 		}
 			
 		m_PerformanceUpdateTimer = 0.f;
@@ -1924,6 +2236,7 @@ fBool AppFrame::OnUpdate(fDouble ElapsedTime, f2dFPSController* pFPSController,
 		m_ObjectTotal = 0.f;
 		m_UpdateTimerTotal = 0.f;
 		m_RenderTimerTotal = 0.f;
+		m_FrameStatsInterval.Reset();
 	}
 #endif
 
@@ -1932,17 +2245,23 @@ fBool AppFrame::OnUpdate(fDouble ElapsedTime, f2dFPSController* pFPSController,
 
 fBool AppFrame::OnRender(fDouble ElapsedTime, f2dFPSController* pFPSController)
 {
-#if (defined LDEVVERSION) || (defined LDEBUG)
+	LPROFILER.RegisterThread("GameLoop");
+	LPROFILE_ZONE("OnRender");
+
 	TimerScope tProfileScope(m_RenderTimer);
-#endif
 
 	m_pRenderDev->Clear();
 
 	// 执行渲染函数
+	beginRenderStats();
 	m_bRenderStarted = true;
 	m_bPostEffectCaptureStarted = false;
-	if (!SafeCallGlobalFunction(LFUNC_RENDER, 0))
-		m_pEngine->Abort();
+	{
+		LPROFILE_ZONE("RenderFunc");
+		SamplerContext tSamplerContext(m_Sampler, "RenderFunc");
+		if (!SafeCallGlobalFunction(LFUNC_RENDER, 0))
+			m_pEngine->Abort();
+	}
 	if (!m_stRenderTargetStack.empty())
 	{
 		LWARNING("OnRender: 渲染结束时没有推出所有的RenderTarget.");
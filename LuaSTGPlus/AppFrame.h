@@ -5,6 +5,11 @@
 #include "SplashWindow.h"
 #include "ResourceMgr.h"
 #include "GameObjectPool.h"
+#include "WorkerPool.h"
+#include "InputReplay.h"
+#include "BenchmarkReport.h"
+#include "LuaSampler.h"
+#include "FrameStats.h"
 #include "UnicodeStringEncoding.h"
 
 #if (defined LDEVVERSION) || (defined LDEBUG)
@@ -31,6 +36,22 @@ namespace LuaSTGPlus
 		Graph3D
 	};
 
+	/// @brief һ֡Ⱦͳ
+	/// @note ޴ģʽ»Ƶòִеͬͳ
+	struct RenderStats
+	{
+		fuInt drawCalls;  // ܵĻƵ
+		fuInt sprites;  // ͼ붯Ļ
+		fuInt quads;  // ύı(ͼӡ߼ĸ)
+		fuInt vertices;  // ύĶ
+		fuInt glyphs;  // 
+		fuInt particles;  // 
+		fuInt blendChanges;  // 2Dģʽл
+		fuInt renderTargetPushes;
+		fuInt renderTargetPops;
+		fuInt postEffects;
+	};
+
 	/// @brief Ӧó
 	class AppFrame :
 		public f2dEngineEventListener
@@ -61,15 +82,13 @@ namespace LuaSTGPlus
 		std::unique_ptr<RemoteDebuggerClient> m_DebuggerClient;
 
 		// ܼ
-		float m_UpdateTimer = 0.f;
-		float m_RenderTimer = 0.f;
-
 		float m_PerformanceUpdateTimer = 0.f;  // ¼ܲۼƲʱ
 		float m_PerformanceUpdateCounter = 0.f;  // ¼
 		float m_FPSTotal = 0.f;  // ¼ڲʱۼƵFPS
 		float m_ObjectTotal = 0.f;  // ¼ڲʱۼƵĶ
 		float m_UpdateTimerTotal = 0.f;  // ¼ڲʱۼƵĸʱ
 		float m_RenderTimerTotal = 0.f;  // ¼ڲʱۼƵȾʱ
+		FrameStats m_FrameStatsInterval;  // ¼ڲʱڵ֡ʱ
 
 		bool m_bShowCollider = false;
 #endif
@@ -84,6 +103,9 @@ namespace LuaSTGPlus
 		// 
 		std::unique_ptr<GameObjectPool> m_GameObjectPool;
 
+		// ̳߳
+		std::unique_ptr<WorkerPool> m_WorkerPool;
+
 		// Lua
 		lua_State* L = nullptr;
 
@@ -95,8 +117,30 @@ namespace LuaSTGPlus
 		fcyVec2 m_OptionResolution = fcyVec2(640.f, 480.f);
 		bool m_OptionSplash = false;
 		std::wstring m_OptionTitle = L"LuaSTGPlus";
+		int m_OptionWorkerCount = -1;  // ߳С0ʱCPU
 		fDouble m_fFPS = 0.;
 
+		// ޴ģʽ
+		bool m_bHeadless = false;
+		fuInt m_iHeadlessFrameLimit = 0;  // ִе֡Ϊ0ʱִеFrameFunctrueΪֹ
+		uint64_t m_iHeadlessDrawCount = 0;  // ܵδʵִеĻƵ
+		int m_iExitCode = 0;
+
+		// ¼
+		InputReplay m_Replay;
+
+		// ׼Ա
+		BenchmarkReport m_Benchmark;
+
+		// lua
+		LuaSampler m_Sampler;
+		std::wstring m_SamplerPath;  // /sampleʱ˳ǰд·
+
+		// ֡ʱͳ
+		float m_UpdateTimer = 0.f;  // һ֡ĸºʱ
+		float m_RenderTimer = 0.f;  // һ֡Ⱦʱ
+		FrameStats m_FrameStats;  // Կʼͳ֡ʱ
+
 		// 
 		fcyRefPointer<f2dEngine> m_pEngine;
 		f2dWindow* m_pMainWindow = nullptr;
@@ -108,8 +152,12 @@ namespace LuaSTGPlus
 		GraphicsType m_GraphType = GraphicsType::Graph2D;
 		bool m_bRenderStarted = false;
 
+		// Ⱦͳ
+		RenderStats m_RenderStats;  // ֡ۼ
+		RenderStats m_RenderStatsLast;  // һ֡
+
 		// 2Dģʽ
-		BlendMode m_Graph2DLastBlendMode;
+		BlendMode m_Graph2DLastBlendMode = BlendMode::AddAlpha;
 		f2dBlendState m_Graph2DBlendState;
 		F2DGRAPH2DBLENDTYPE m_Graph2DColorBlendState;
 		fcyRefPointer<f2dGeometryRenderer> m_GRenderer;
@@ -136,10 +184,51 @@ namespace LuaSTGPlus
 		fcyVec2 m_MousePosition;
 		fBool m_MouseState[3];
 	private:
+		/// @brief ¼һλƵ
+		/// @return ޴ģʽtrueӦֱӷ
+		bool headlessDraw()LNOEXCEPT
+		{
+			++m_RenderStats.drawCalls;
+			if (!m_bHeadless)
+				return false;
+			++m_iHeadlessDrawCount;
+			return true;
+		}
+		/// @brief ¼ύı
+		void countQuads(fuInt count)LNOEXCEPT
+		{
+			m_RenderStats.quads += count;
+			m_RenderStats.vertices += count * 4;
+		}
+		void beginRenderStats()LNOEXCEPT
+		{
+			m_RenderStatsLast = m_RenderStats;
+			memset(&m_RenderStats, 0, sizeof(m_RenderStats));
+		}
+		void recordFrameTime(float updateTime, float renderTime)LNOEXCEPT
+		{
+			// ֡ƶӦ֡ʱΪԤ
+			double tBudget = m_OptionFPSLimit > 0 ? 1. / m_OptionFPSLimit : 0.;
+			m_FrameStats.Record(updateTime, renderTime, tBudget);
+#if (defined LDEVVERSION) || (defined LDEBUG)
+			m_FrameStatsInterval.Record(updateTime, renderTime, tBudget);
+#endif
+		}
+		bool initEngine()LNOEXCEPT;
+		void runHeadless()LNOEXCEPT;
+		bool updateReplay()LNOEXCEPT;
+
 		void updateGraph2DBlendMode(BlendMode m)
 		{
 			if (m != m_Graph2DLastBlendMode)
 			{
+				++m_RenderStats.blendChanges;
+				if (m_bHeadless)  // ޴ģʽֻ¼ģʽ
+				{
+					m_Graph2DLastBlendMode = m;
+					return;
+				}
+
 				switch (m)
 				{
 				case BlendMode::AddAdd:
@@ -248,6 +337,7 @@ namespace LuaSTGPlus
 		void SetResolution(fuInt width, fuInt height)LNOEXCEPT;
 		void SetSplash(bool v)LNOEXCEPT;
 		LNOINLINE void SetTitle(const char* v)LNOEXCEPT;  // UTF8
+		void SetWorkerCount(int v)LNOEXCEPT;
 
 		/// @brief ʹµƵʾģʽ
 		/// @note лʧлع
@@ -256,6 +346,28 @@ namespace LuaSTGPlus
 		/// @brief ȡǰFPS
 		double GetFPS()LNOEXCEPT { return m_fFPS; }
 
+		/// @brief Ƿ޴ģʽ
+		/// @note ޴ģʽ²ڡȾ豸Ƶִֻ
+		bool IsHeadless()const LNOEXCEPT { return m_bHeadless; }
+
+		/// @brief ȡ޴ģʽۼƵĻƵ
+		uint64_t GetHeadlessDrawCount()const LNOEXCEPT { return m_iHeadlessDrawCount; }
+
+		/// @brief ȡ˳
+		int GetExitCode()const LNOEXCEPT { return m_iExitCode; }
+
+		/// @brief ȡlua߳
+		lua_State* GetLuaEngine()LNOEXCEPT { return L; }
+
+		/// @brief ȡ¼
+		InputReplay& GetInputReplay()LNOEXCEPT { return m_Replay; }
+
+		/// @brief ȡ׼Ա
+		BenchmarkReport& GetBenchmarkReport()LNOEXCEPT { return m_Benchmark; }
+
+		/// @brief ȡlua
+		LuaSampler& GetLuaSampler()LNOEXCEPT { return m_Sampler; }
+
 		/// @brief ִԴеļ
 		/// @note úΪűϵͳʹ
 		LNOINLINE void LoadScript(const char* path)LNOEXCEPT;
@@ -289,12 +401,16 @@ namespace LuaSTGPlus
 		/// @brief 
 		void ClearScreen(const fcyColor& c)LNOEXCEPT
 		{
+			if (m_bHeadless)
+				return;
 			m_pRenderDev->Clear(c);
 		}
 
 		/// @brief ӿ
 		bool SetViewport(double left, double right, double bottom, double top)LNOEXCEPT
 		{
+			if (m_bHeadless)
+				return true;
 			if (FCYFAILED(m_pRenderDev->SetViewport(fcyRect(
 				static_cast<float>((int)left),
 				static_cast<float>((int)m_pRenderDev->GetBufferHeight() - (int)top),
@@ -311,7 +427,7 @@ namespace LuaSTGPlus
 		/// @brief ͶӰ
 		void SetOrtho(float left, float right, float bottom, float top)LNOEXCEPT
 		{
-			if (m_GraphType == GraphicsType::Graph2D)
+			if (m_GraphType == GraphicsType::Graph2D && !m_bHeadless)
 			{
 				// luastgluaѾ
 				// m_Graph2D->SetWorldTransform(fcyMatrix4::GetTranslateMatrix(fcyVec3(-0.5f, -0.5f, 0.f)));
@@ -325,7 +441,7 @@ namespace LuaSTGPlus
 		void SetPerspective(float eyeX, float eyeY, float eyeZ, float atX, float atY, float atZ, 
 			float upX, float upY, float upZ, float fovy, float aspect, float zn, float zf)LNOEXCEPT
 		{
-			if (m_GraphType == GraphicsType::Graph2D)
+			if (m_GraphType == GraphicsType::Graph2D && !m_bHeadless)
 			{
 				m_Graph2D->SetWorldTransform(fcyMatrix4::GetIdentity());
 				m_Graph2D->SetViewTransform(fcyMatrix4::GetLookAtLH(fcyVec3(eyeX, eyeY, eyeZ), fcyVec3(atX, atY, atZ), fcyVec3(upX, upY, upZ)));
@@ -346,9 +462,13 @@ namespace LuaSTGPlus
 				LERROR("Render: ֻ2DȾִи÷");
 				return false;
 			}
+			++m_RenderStats.sprites;
+			countQuads(1);
 
 			// û
 			updateGraph2DBlendMode(p->GetBlendMode());
+			if (headlessDraw())
+				return true;
 
 			// Ⱦ
 			f2dSprite* pSprite = p->GetSprite();
@@ -366,9 +486,13 @@ namespace LuaSTGPlus
 				LERROR("Render: ֻ2DȾִи÷");
 				return false;
 			}
+			++m_RenderStats.sprites;
+			countQuads(1);
 
 			// û
 			updateGraph2DBlendMode(p->GetBlendMode());
+			if (headlessDraw())
+				return true;
 
 			// Ⱦ
 			f2dSprite* pSprite = p->GetSprite(((fuInt)ani_timer / p->GetInterval()) % p->GetCount());
@@ -385,9 +509,13 @@ namespace LuaSTGPlus
 				LERROR("Render: ֻ2DȾִи÷");
 				return false;
 			}
+			m_RenderStats.particles += (fuInt)p->GetAliveCount();
+			countQuads((fuInt)p->GetAliveCount());
 
 			// û
 			updateGraph2DBlendMode(p->GetBlendMode());
+			if (headlessDraw())
+				return true;
 
 			// Ⱦ
 			p->Render(m_Graph2D, hscale, vscale);
@@ -407,23 +535,21 @@ namespace LuaSTGPlus
 		}
 
 		/// @brief Ⱦͼ
-		bool RenderRect(const char* name, float x1, float y1, float x2, float y2)LNOEXCEPT
+		bool RenderRect(ResSprite* p, float x1, float y1, float x2, float y2)LNOEXCEPT
 		{
+			LASSERT(p);
 			if (m_GraphType != GraphicsType::Graph2D)
 			{
 				LERROR("RenderRect: ֻ2DȾִи÷");
 				return false;
 			}
-
-			fcyRefPointer<ResSprite> p = m_ResourceMgr.FindSprite(name);
-			if (!p)
-			{
-				LERROR("RenderRect: ҲͼԴ'%m'", name);
-				return false;
-			}
+			++m_RenderStats.sprites;
+			countQuads(1);
 
 			// û
 			updateGraph2DBlendMode(p->GetBlendMode());
+			if (headlessDraw())
+				return true;
 
 			// Ⱦ
 			f2dSprite* pSprite = p->GetSprite();
@@ -433,24 +559,34 @@ namespace LuaSTGPlus
 		}
 
 		/// @brief Ⱦͼ
-		bool Render4V(const char* name, float x1, float y1, float z1, float x2, float y2, float z2, 
-			float x3, float y3, float z3, float x4, float y4, float z4)LNOEXCEPT
+		bool RenderRect(const char* name, float x1, float y1, float x2, float y2)LNOEXCEPT
 		{
-			if (m_GraphType != GraphicsType::Graph2D)
+			fcyRefPointer<ResSprite> p = m_ResourceMgr.FindSprite(name);
+			if (!p)
 			{
-				LERROR("Render4V: ֻ2DȾִи÷");
+				LERROR("RenderRect: ҲͼԴ'%m'", name);
 				return false;
 			}
+			return RenderRect(p, x1, y1, x2, y2);
+		}
 
-			fcyRefPointer<ResSprite> p = m_ResourceMgr.FindSprite(name);
-			if (!p)
+		/// @brief Ⱦͼ
+		bool Render4V(ResSprite* p, float x1, float y1, float z1, float x2, float y2, float z2, 
+			float x3, float y3, float z3, float x4, float y4, float z4)LNOEXCEPT
+		{
+			LASSERT(p);
+			if (m_GraphType != GraphicsType::Graph2D)
 			{
-				LERROR("Render4V: ҲͼԴ'%m'", name);
+				LERROR("Render4V: ֻ2DȾִи÷");
 				return false;
 			}
+			++m_RenderStats.sprites;
+			countQuads(1);
 			
 			// û
 			updateGraph2DBlendMode(p->GetBlendMode());
+			if (headlessDraw())
+				return true;
 
 			f2dSprite* pSprite = p->GetSprite();
 			pSprite->SetZ(0.5f);
@@ -458,17 +594,34 @@ namespace LuaSTGPlus
 			return true;
 		}
 
+		/// @brief Ⱦͼ
+		bool Render4V(const char* name, float x1, float y1, float z1, float x2, float y2, float z2, 
+			float x3, float y3, float z3, float x4, float y4, float z4)LNOEXCEPT
+		{
+			fcyRefPointer<ResSprite> p = m_ResourceMgr.FindSprite(name);
+			if (!p)
+			{
+				LERROR("Render4V: ҲͼԴ'%m'", name);
+				return false;
+			}
+			return Render4V(p, x1, y1, z1, x2, y2, z2, x3, y3, z3, x4, y4, z4);
+		}
+
 		/// @brief Ⱦ
 		bool RenderTexture(ResTexture* tex, BlendMode blend, const f2dGraphics2DVertex vertex[])LNOEXCEPT
 		{
+			LASSERT(tex);
 			if (m_GraphType != GraphicsType::Graph2D)
 			{
 				LERROR("RenderTexture: ֻ2DȾִи÷");
 				return false;
 			}
+			countQuads(1);
 			
 			// û
 			updateGraph2DBlendMode(blend);
+			if (headlessDraw())
+				return true;
 
 			// 
 			f2dGraphics2DVertex tVertex[4];
@@ -485,34 +638,42 @@ namespace LuaSTGPlus
 			return true;
 		}
 
-		/// @brief Ⱦ
-		bool RenderTexture(const char* name, BlendMode blend, f2dGraphics2DVertex vertex[])LNOEXCEPT
+		/// @brief Ⱦ(б)
+		/// @note  UVѹ淶[0,1]䣬ܳȾС
+		bool RenderTextureRaw(ResTexture* tex, BlendMode blend, const f2dGraphics2DVertex vertex[], fuInt vertCount, const fuShort index[], fuInt indexCount)LNOEXCEPT
 		{
 			if (m_GraphType != GraphicsType::Graph2D)
 			{
-				LERROR("RenderTexture: ֻ2DȾִи÷");
+				LERROR("RenderTextureRaw: ֻ2DȾִи÷");
 				return false;
 			}
+			// ÿ6()ΪһıΣ߼δΪ(vertCount - 2) / 2㰴ʵύ
+			m_RenderStats.quads += indexCount / 6;
+			m_RenderStats.vertices += vertCount;
 
+			// û
+			updateGraph2DBlendMode(blend);
+			if (headlessDraw())
+				return true;
+
+			if (FCYFAILED(m_Graph2D->DrawRaw(tex->GetTexture(), vertCount, indexCount, vertex, index, false)))
+			{
+				LERROR("RenderTextureRaw: ύʧ (f2dGraphics2D::DrawRaw failed)");
+				return false;
+			}
+			return true;
+		}
+
+		/// @brief Ⱦ
+		bool RenderTexture(const char* name, BlendMode blend, const f2dGraphics2DVertex vertex[])LNOEXCEPT
+		{
 			fcyRefPointer<ResTexture> p = m_ResourceMgr.FindTexture(name);
 			if (!p)
 			{
 				LERROR("RenderTexture: ҲԴ'%m'", name);
 				return false;
 			}
-
-			// û
-			updateGraph2DBlendMode(blend);
-
-			// UV[0,1]
-			for (int i = 0; i < 4; ++i)
-			{
-				vertex[i].u /= (float)p->GetTexture()->GetWidth();
-				vertex[i].v /= (float)p->GetTexture()->GetHeight();
-			}	
-
-			m_Graph2D->DrawQuad(p->GetTexture(), vertex, false);
-			return true;
+			return RenderTexture(p, blend, vertex);
 		}
 
 		/// @brief Ⱦ
@@ -520,8 +681,12 @@ namespace LuaSTGPlus
 
 		fcyVec2 CalcuTextSize(ResFont* p, const wchar_t* strBuf, fcyVec2 scale)LNOEXCEPT;
 
+		LNOINLINE bool RenderText(ResFont* p, const char* str, float x, float y, float scale, ResFont::FontAlignHorizontal halign, ResFont::FontAlignVertical valign)LNOEXCEPT;
+
 		LNOINLINE bool RenderText(const char* name, const char* str, float x, float y, float scale, ResFont::FontAlignHorizontal halign, ResFont::FontAlignVertical valign)LNOEXCEPT;
 
+		LNOINLINE bool RenderTTF(ResFont* p, const char* str, float left, float right, float bottom, float top, float scale, int format, fcyColor c)LNOEXCEPT;
+
 		LNOINLINE bool RenderTTF(const char* name, const char* str, float left, float right, float bottom, float top, float scale, int format, fcyColor c)LNOEXCEPT;
 
 		LNOINLINE void SnapShot(const char* path)LNOEXCEPT;
@@ -543,9 +708,19 @@ namespace LuaSTGPlus
 		LNOINLINE bool PostEffectCapture()LNOEXCEPT;
 
 		LNOINLINE bool PostEffectApply(ResFX* shader, BlendMode blend)LNOEXCEPT;
+
+		/// @brief ȡһ֡Ⱦͳ
+		const RenderStats& GetRenderStats()const LNOEXCEPT { return m_RenderStatsLast; }
+
+		/// @brief ȡԿʼͳ֡ʱͳ
+		const FrameStats& GetFrameStats()const LNOEXCEPT { return m_FrameStats; }
+
+		/// @brief ֡ʱͳ
+		void ResetFrameStats()LNOEXCEPT { m_FrameStats.Reset(); }
 	public:
 		ResourceMgr& GetResourceMgr()LNOEXCEPT { return m_ResourceMgr; }
 		GameObjectPool& GetGameObjectPool()LNOEXCEPT{ return *m_GameObjectPool.get(); }
+		WorkerPool& GetWorkerPool()LNOEXCEPT { return *m_WorkerPool.get(); }
 		f2dEngine* GetEngine()LNOEXCEPT { return m_pEngine; }
 		f2dRenderer* GetRenderer()LNOEXCEPT { return m_pRenderer; }
 		f2dRenderDevice* GetRenderDev()LNOEXCEPT { return m_pRenderDev; }
@@ -0,0 +1,163 @@
+﻿#include "BenchmarkReport.h"
+#include "ResourceMgr.h"
+#include "Utility.h"
+
+#include <psapi.h>
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+static const char* s_TimingNames[BenchmarkReport::TimingCount] =
+{
+	"script",
+	"objframe",
+	"particle",
+	"boundcheck",
+	"collisioncheck",
+	"updatexy",
+	"afterframe",
+	"render"
+};
+
+// 写出JSON字符串，转义引号、反斜杠与控制字符
+static void AppendJsonString(string& out, const string& s)
+{
+	out.push_back('"');
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char tBuf[8];
+			sprintf_s(tBuf, "\\u%04x", (unsigned)c);
+			out.append(tBuf);
+		}
+		else
+			out.push_back(c);
+	}
+	out.push_back('"');
+}
+
+// 取已排序序列的百分位数(最近秩)
+static float Percentile(const vector<float>& sorted, float p)
+{
+	if (sorted.empty())
+		return 0.f;
+	size_t tRank = (size_t)ceil(p * sorted.size());
+	return sorted[tRank > 0 ? tRank - 1 : 0];
+}
+
+void BenchmarkReport::Enable(const wstring& path)
+{
+	m_bEnabled = true;
+	m_Path = path;
+	m_Scenes.clear();
+}
+
+void BenchmarkReport::BeginScene(const char* name)
+{
+	Scene tScene;
+	tScene.name = name;
+	memset(tScene.timingTotal, 0, sizeof(tScene.timingTotal));
+	tScene.peakObjects = 0;
+	tScene.peakLuaMemory = 0;
+	tScene.peakParticleMemory = 0;
+	m_Scenes.emplace_back(std::move(tScene));
+	m_Scenes.back().frameTimes.reserve(4096);
+
+	ResParticle::ResetMemoryPeak();
+}
+
+void BenchmarkReport::AddFrame(const float timing[TimingCount], float frameTime, size_t objects, size_t luaMemory)
+{
+	if (m_Scenes.empty())
+		BeginScene("default");
+
+	Scene& tScene = m_Scenes.back();
+	tScene.frameTimes.push_back(frameTime);
+	for (int i = 0; i < TimingCount; ++i)
+		tScene.timingTotal[i] += timing[i];
+	tScene.peakObjects = max(tScene.peakObjects, objects);
+	tScene.peakLuaMemory = max(tScene.peakLuaMemory, luaMemory);
+	tScene.peakParticleMemory = max(tScene.peakParticleMemory, ResParticle::GetMemoryPeak());
+}
+
+bool BenchmarkReport::Save()LNOEXCEPT
+{
+	if (!m_bEnabled)
+		return true;
+
+	try
+	{
+		PROCESS_MEMORY_COUNTERS tMemCounters = { sizeof(PROCESS_MEMORY_COUNTERS) };
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &tMemCounters, sizeof(tMemCounters)))
+			memset(&tMemCounters, 0, sizeof(tMemCounters));
+
+		size_t tTotalFrames = 0;
+		for (const Scene& s : m_Scenes)
+			tTotalFrames += s.frameTimes.size();
+
+		string tJson;
+		tJson.append("{\n\t\"version\": ");
+		AppendJsonString(tJson, fcyStringHelper::WideCharToMultiByte(LVERSION));
+		tJson.append(StringFormat(",\n\t\"frames\": %u,\n\t\"peak_working_set\": %u,\n\t\"scenes\": [",
+			(fuInt)tTotalFrames, (fuInt)tMemCounters.PeakWorkingSetSize));
+
+		for (size_t i = 0; i < m_Scenes.size(); ++i)
+		{
+			const Scene& s = m_Scenes[i];
+			vector<float> tSorted(s.frameTimes);
+			sort(tSorted.begin(), tSorted.end());
+			double tTotal = 0.;
+			for (float t : tSorted)
+				tTotal += t;
+			double tCount = tSorted.empty() ? 1. : (double)tSorted.size();
+
+			tJson.append(i == 0 ? "\n\t\t{\n\t\t\t\"name\": " : ",\n\t\t{\n\t\t\t\"name\": ");
+			AppendJsonString(tJson, s.name);
+			tJson.append(StringFormat(",\n\t\t\t\"frames\": %u,\n\t\t\t\"phase_ms\": {", (fuInt)s.frameTimes.size()));
+			for (int j = 0; j < TimingCount; ++j)
+			{
+				tJson.append(StringFormat(j == 0 ? "\n\t\t\t\t\"%s\": %f" : ",\n\t\t\t\t\"%s\": %f",
+					s_TimingNames[j], s.timingTotal[j] * 1000. / tCount));
+			}
+			tJson.append(StringFormat(
+				"\n\t\t\t},\n\t\t\t\"frame_ms\": {\n\t\t\t\t\"mean\": %f,\n\t\t\t\t\"p50\": %f,\n\t\t\t\t\"p95\": %f,\n\t\t\t\t\"p99\": %f,\n\t\t\t\t\"max\": %f\n\t\t\t},",
+				tTotal * 1000. / tCount,
+				Percentile(tSorted, 0.50f) * 1000.,
+				Percentile(tSorted, 0.95f) * 1000.,
+				Percentile(tSorted, 0.99f) * 1000.,
+				tSorted.empty() ? 0. : tSorted.back() * 1000.));
+			tJson.append(StringFormat(
+				"\n\t\t\t\"peak_objects\": %u,\n\t\t\t\"peak_lua_memory_kb\": %u,\n\t\t\t\"peak_particle_memory\": %u\n\t\t}",
+				(fuInt)s.peakObjects, (fuInt)s.peakLuaMemory, (fuInt)s.peakParticleMemory));
+		}
+		tJson.append("\n\t]\n}\n");
+
+		fcyRefPointer<fcyFileStream> pFile;
+		pFile.DirectSet(new fcyFileStream(m_Path.c_str(), true));
+		if (FCYFAILED(pFile->SetLength(0)) ||
+			FCYFAILED(pFile->WriteBytes((fcData)tJson.data(), tJson.size(), nullptr)))
+		{
+			LERROR("BenchmarkReport: 无法向文件'%s'写出报告", m_Path.c_str());
+			return false;
+		}
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("BenchmarkReport: 内存不足");
+		return false;
+	}
+	catch (const fcyException& e)
+	{
+		LERROR("BenchmarkReport: 写出报告到'%s'失败 (异常信息'%m' 源'%m')", m_Path.c_str(), e.GetDesc(), e.GetSrc());
+		return false;
+	}
+
+	LINFO("BenchmarkReport: 报告已写出到'%s' (场景数: %u)", m_Path.c_str(), (fuInt)m_Scenes.size());
+	return true;
+}
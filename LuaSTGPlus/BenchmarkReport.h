@@ -0,0 +1,57 @@
+﻿#pragma once
+#include "Global.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 基准测试报告
+	/// @note  以/benchmark:文件路径启动时在无窗口模式下逐帧记录各阶段耗时，退出时以JSON格式写出。
+	///        脚本可以调用lstg.BenchmarkScene划分场景，每个场景分别统计。
+	class BenchmarkReport
+	{
+	public:
+		/// @brief 计时项
+		enum Timing
+		{
+			TimingScript = 0,  // FrameFunc中除对象池阶段以外的部分
+			TimingObjFrame,  // 对象帧函数与运动积分
+			TimingParticle,  // 粒子更新
+			TimingBoundCheck,  // 边界检查
+			TimingCollisionCheck,  // 碰撞检查
+			TimingUpdateXY,  // 坐标偏移量更新
+			TimingAfterFrame,  // 帧末更新与回收
+			TimingRender,  // RenderFunc
+			TimingCount
+		};
+	private:
+		struct Scene
+		{
+			std::string name;
+			std::vector<float> frameTimes;  // 每帧耗时(秒)
+			double timingTotal[TimingCount];  // 各计时项累计(秒)
+			size_t peakObjects;
+			size_t peakLuaMemory;  // lua虚拟机内存峰值(KB)
+			size_t peakParticleMemory;  // 粒子池内存峰值(字节)
+		};
+	private:
+		bool m_bEnabled = false;
+		std::wstring m_Path;
+		std::vector<Scene> m_Scenes;
+	public:
+		bool IsEnabled()const LNOEXCEPT { return m_bEnabled; }
+
+		/// @brief 开始记录，结果在Save时写出到path
+		void Enable(const std::wstring& path);
+
+		/// @brief 开始新的场景
+		/// @note  尚未开始任何场景时，第一帧会自动开始名为"default"的场景
+		void BeginScene(const char* name);
+
+		/// @brief 记录一帧
+		/// @param[in] timing    各计时项耗时(秒)
+		/// @param[in] frameTime 整帧耗时(秒)
+		void AddFrame(const float timing[TimingCount], float frameTime, size_t objects, size_t luaMemory);
+
+		/// @brief 写出JSON报告
+		bool Save()LNOEXCEPT;
+	};
+}
@@ -173,6 +173,78 @@ bool LuaSTGPlus::OBBCircleHitTest(fcyVec2 P1, fcyVec2 Size, float Angle,
 	return false;
 }
 
+// ߶ԭAABBཻ(slab)
+static bool SegmentOriginAABBHitTest(fcyVec2 A, fcyVec2 B, fcyVec2 HalfSize)
+{
+	float tStart[2] = { A.x, A.y };
+	float tDelta[2] = { B.x - A.x, B.y - A.y };
+	float tHalf[2] = { HalfSize.x, HalfSize.y };
+	float tMin = 0.f, tMax = 1.f;
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (fabs(tDelta[i]) < 0.00001f)
+		{
+			// ƽУslab
+			if (tStart[i] < -tHalf[i] || tStart[i] > tHalf[i])
+				return false;
+		}
+		else
+		{
+			float tInv = 1.f / tDelta[i];
+			float t1 = (-tHalf[i] - tStart[i]) * tInv;
+			float t2 = (tHalf[i] - tStart[i]) * tInv;
+			if (t1 > t2)
+				std::swap(t1, t2);
+			if (t1 > tMin)
+				tMin = t1;
+			if (t2 < tMax)
+				tMax = t2;
+			if (tMin > tMax)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool LuaSTGPlus::CapsuleOBBHitTest(fcyVec2 A, fcyVec2 B, float R,
+	fcyVec2 P, fcyVec2 Size, float Angle)
+{
+	// ߶α任εľֲϵ
+	float tSin, tCos;
+	SinCos(Angle, tSin, tCos);
+
+	A -= P;
+	B -= P;
+	A.RotationSC(-tSin, tCos);
+	B.RotationSC(-tSin, tCos);
+
+	// ཻȼ߶չRԲǾཻ
+	// ȼԲǾеʮֲ
+	if (SegmentOriginAABBHitTest(A, B, fcyVec2(Size.x + R, Size.y)) ||
+		SegmentOriginAABBHitTest(A, B, fcyVec2(Size.x, Size.y + R)))
+	{
+		return true;
+	}
+
+	// ĸ
+	fcyVec2 tCorner[4] =
+	{
+		fcyVec2(-Size.x, -Size.y),
+		fcyVec2(Size.x, -Size.y),
+		fcyVec2(Size.x, Size.y),
+		fcyVec2(-Size.x, Size.y)
+	};
+	float tDist2 = R * R;
+	for (int i = 0; i < 4; i++)
+	{
+		if (PointSegmentDistance2(tCorner[i], A, B) < tDist2)
+			return true;
+	}
+
+	return false;
+}
+
 bool LuaSTGPlus::OBBAABBHitTest(fcyVec2 P, fcyVec2 Size, float Angle, fcyRect Rect)
 {
 	// OBBε4
@@ -49,6 +49,39 @@ namespace LuaSTGPlus
 		return tRect1.Intersect(tRect2, NULL);
 	}
 
+	/// @brief 㵽߶εľƽ
+	/// @param[in] P 
+	/// @param[in] A ߶
+	/// @param[in] B ߶յ
+	inline float PointSegmentDistance2(fcyVec2 P, fcyVec2 A, fcyVec2 B)
+	{
+		fcyVec2 tAB = B - A;
+		float tLen2 = tAB.Length2();
+		float t = 0.f;
+		if (tLen2 > 0.f)
+		{
+			t = ((P - A) * tAB) / tLen2;
+			if (t < 0.f)
+				t = 0.f;
+			else if (t > 1.f)
+				t = 1.f;
+		}
+		fcyVec2 tOffset(A.x + tAB.x * t - P.x, A.y + tAB.y * t - P.y);
+		return tOffset.Length2();
+	}
+
+	/// @brief Բཻ
+	/// @param[in] A  ߶
+	/// @param[in] B  ߶յ
+	/// @param[in] R1 뾶
+	/// @param[in] P  Բ
+	/// @param[in] R2 Բ뾶
+	inline bool CapsuleCircleHitTest(fcyVec2 A, fcyVec2 B, float R1, fcyVec2 P, float R2)
+	{
+		float tRTotal = R1 + R2;
+		return PointSegmentDistance2(P, A, B) < tRTotal * tRTotal;
+	}
+
 	/// @brief OBBײ
 	/// @param[in] P1     1
 	/// @param[in] Size1  1߳
@@ -70,6 +103,17 @@ namespace LuaSTGPlus
 		fcyVec2 P1, fcyVec2 Size, float Angle,
 		fcyVec2 P2, float R);
 
+	/// @brief OBBײ
+	/// @param[in] A     ߶
+	/// @param[in] B     ߶յ
+	/// @param[in] R     뾶
+	/// @param[in] P     
+	/// @param[in] Size  ΰ߳
+	/// @param[in] Angle ת
+	bool CapsuleOBBHitTest(
+		fcyVec2 A, fcyVec2 B, float R,
+		fcyVec2 P, fcyVec2 Size, float Angle);
+
 	/// @brief OBBAABBΧײ
 	/// @param[in] P     
 	/// @param[in] Size  ΰ߳
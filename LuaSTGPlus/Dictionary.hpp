@@ -1,130 +1,269 @@
 /// @file Dictionary.h
-/// @brief MPQϣֵ
+/// @brief ڿѰֵַ
 #pragma once
 #include "Global.h"
+#include <tuple>
 
 namespace LuaSTGPlus
 {
-	/// @brief MPQHash
-	class MPQHashCryptTable
+	/// @brief 64λַϣFNV-1a
+	/// @param[in] key 
+	/// @param[out] len 
+	/// @note ֵ֤00ڱǿղ
+	inline uint64_t DictionaryHash(const char* key, size_t& len)
 	{
-	public:
-		static const MPQHashCryptTable& GetInstance()
+		uint64_t h = 0xCBF29CE484222325ULL;
+		const char* p = key;
+		while (*p != 0)
 		{
-			static MPQHashCryptTable s_Table;
-			return s_Table;
+			h ^= static_cast<unsigned char>(*p++);
+			h *= 0x100000001B3ULL;
 		}
-	private:
-		uint32_t m_CryptTable[0x500];
+		len = static_cast<size_t>(p - key);
+		h ^= h >> 29;  // ʹλȣλɵλ
+		return h ? h : 1;
+	}
+
+	/// @brief ֵ
+	/// @note ̽ĿѰַϣϣֵĿֿţֱӱĿ
+	///       ҿֱʹconst char*عʱɾʱƲλҪĹ
+	///       ޸ĺDictionaryTesṭаstd::unordered_mapĲֲԺܶԱ
+	template <typename Value>
+	class Dictionary
+	{
 	public:
-		uint32_t operator[](uint32_t idx)const
+		typedef std::pair<std::string, Value> value_type;
+
+		/// @brief 
+		template <typename T>
+		class IteratorImpl
 		{
-			return m_CryptTable[idx];
-		}
-	public:
-		MPQHashCryptTable()
+			friend class Dictionary;
+		private:
+			const uint64_t* m_pHashes;
+			T* m_pEntries;
+			size_t m_iIndex;
+			size_t m_iCapacity;
+		private:
+			void skipEmpty()
+			{
+				while (m_iIndex < m_iCapacity && m_pHashes[m_iIndex] == 0)
+					++m_iIndex;
+			}
+			IteratorImpl(const uint64_t* hashes, T* entries, size_t index, size_t capacity)
+				: m_pHashes(hashes), m_pEntries(entries), m_iIndex(index), m_iCapacity(capacity) {}
+		public:
+			T& operator*()const { return m_pEntries[m_iIndex]; }
+			T* operator->()const { return &m_pEntries[m_iIndex]; }
+			IteratorImpl& operator++()
+			{
+				++m_iIndex;
+				skipEmpty();
+				return *this;
+			}
+			bool operator==(const IteratorImpl& right)const { return m_iIndex == right.m_iIndex; }
+			bool operator!=(const IteratorImpl& right)const { return m_iIndex != right.m_iIndex; }
+		};
+
+		typedef IteratorImpl<value_type> iterator;
+		typedef IteratorImpl<const value_type> const_iterator;
+	private:
+		static const size_t MinCapacity = 16;
+
+		uint64_t* m_pHashes = nullptr;  // 0ʾղ
+		value_type* m_pEntries = nullptr;  // ǿղϹ˶
+		size_t m_iCapacity = 0;  // 2
+		size_t m_iSize = 0;
+	private:
+		/// @brief ѰҼڵĲۣʱm_iCapacity
+		size_t findSlot(const char* key, size_t len, uint64_t hash)const LNOEXCEPT
 		{
-			uint32_t seed = 0x00100001;
-			for (uint32_t index1 = 0; index1 < 0x100; index1++)
+			if (m_iCapacity == 0)
+				return m_iCapacity;
+
+			size_t tMask = m_iCapacity - 1;
+			for (size_t i = static_cast<size_t>(hash) & tMask; m_pHashes[i] != 0; i = (i + 1) & tMask)
 			{
-				for (uint32_t index2 = index1, i = 0; i < 5; i++, index2 += 0x100)
+				if (m_pHashes[i] == hash)
 				{
-					unsigned long temp1, temp2;
-					seed = (seed * 125 + 3) % 0x2AAAAB;
-					temp1 = (seed & 0xFFFF) << 0x10;
-					seed = (seed * 125 + 3) % 0x2AAAAB;
-					temp2 = (seed & 0xFFFF);
-					m_CryptTable[index2] = (temp1 | temp2);
+					const std::string& tKey = m_pEntries[i].first;
+					if (tKey.size() == len && memcmp(tKey.data(), key, len) == 0)
+						return i;
 				}
 			}
+			return m_iCapacity;
 		}
-	};
 
-	/// @brief MPQ Hash㷨
-	template <uint32_t dwHashType>
-	uint32_t MPQHash(const char* key)
-	{
-		uint32_t seed1 = 0x7FED7FED, seed2 = 0xEEEEEEEE;
-		uint32_t ch;
-		while (*key != 0)
+		/// @brief ѰҲõĿղ
+		size_t findEmptySlot(uint64_t hash)const LNOEXCEPT
 		{
-			ch = static_cast<unsigned char>(*key++);
-			seed1 = MPQHashCryptTable::GetInstance()[(dwHashType << 8) + ch] ^ (seed1 + seed2);
-			seed2 = ch + seed1 + seed2 + (seed2 << 5) + 3;
+			size_t tMask = m_iCapacity - 1;
+			size_t i = static_cast<size_t>(hash) & tMask;
+			while (m_pHashes[i] != 0)
+				i = (i + 1) & tMask;
+			return i;
 		}
-		return seed1;
-	}
 
-	/// @brief ֵ
-	struct DictionaryKey
-	{
-		uint32_t HashKey;
-		uint32_t Hash1, Hash2;
-#ifdef LDEBUG
-		std::string Key;
-#endif
+		/// @brief ·洢Ŀ
+		void rehash(size_t capacity)
+		{
+			uint64_t* tHashes = new uint64_t[capacity]();
+			value_type* tEntries = nullptr;
+			try
+			{
+				tEntries = static_cast<value_type*>(::operator new(sizeof(value_type) * capacity));
+			}
+			catch (...)
+			{
+				delete[] tHashes;
+				throw;
+			}
+
+			uint64_t* tOldHashes = m_pHashes;
+			value_type* tOldEntries = m_pEntries;
+			size_t tOldCapacity = m_iCapacity;
+
+			m_pHashes = tHashes;
+			m_pEntries = tEntries;
+			m_iCapacity = capacity;
+			for (size_t i = 0; i < tOldCapacity; ++i)
+			{
+				if (tOldHashes[i] != 0)
+				{
+					size_t j = findEmptySlot(tOldHashes[i]);
+					new(&m_pEntries[j]) value_type(std::move(tOldEntries[i]));
+					m_pHashes[j] = tOldHashes[i];
+					tOldEntries[i].~value_type();
+				}
+			}
 
-		bool operator==(const DictionaryKey& right)const
+			delete[] tOldHashes;
+			::operator delete(tOldEntries);
+		}
+
+		/// @brief ɾϵĿͬĿǰƲλ
+		void eraseSlot(size_t i)LNOEXCEPT
 		{
-#ifdef LDEBUG
-			if (HashKey == right.HashKey && Hash1 == right.Hash1 &&
-				Hash2 == right.Hash2)
+			size_t tMask = m_iCapacity - 1;
+			m_pEntries[i].~value_type();
+			for (size_t j = (i + 1) & tMask; m_pHashes[j] != 0; j = (j + 1) & tMask)
 			{
-				LASSERT(Key == right.Key);
-				return true;
+				// λkѭ(i, j]֮Ŀǰ
+				size_t k = static_cast<size_t>(m_pHashes[j]) & tMask;
+				if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+					continue;
+				new(&m_pEntries[i]) value_type(std::move(m_pEntries[j]));
+				m_pEntries[j].~value_type();
+				m_pHashes[i] = m_pHashes[j];
+				i = j;
 			}
-			LASSERT(Key != right.Key);
-			return false;
-#else
-			return (HashKey == right.HashKey && Hash1 == right.Hash1 &&
-				Hash2 == right.Hash2);
-#endif
+			m_pHashes[i] = 0;
+			--m_iSize;
 		}
 
-		DictionaryKey()
-			: HashKey(0), Hash1(0), Hash2(0) {}
-		DictionaryKey(fcStr KeyStr)
+		void destroyAll()LNOEXCEPT
 		{
-			HashKey = MPQHash<0>(KeyStr);
-			Hash1 = MPQHash<1>(KeyStr);
-			Hash2 = MPQHash<2>(KeyStr);
-#ifdef LDEBUG
-			Key = KeyStr;
-#endif
+			for (size_t i = 0; i < m_iCapacity; ++i)
+			{
+				if (m_pHashes[i] != 0)
+				{
+					m_pEntries[i].~value_type();
+					m_pHashes[i] = 0;
+				}
+			}
+			m_iSize = 0;
 		}
-		explicit DictionaryKey(const std::string& KeyStr)
+	public:
+		size_t size()const LNOEXCEPT { return m_iSize; }
+		bool empty()const LNOEXCEPT { return m_iSize == 0; }
+
+		iterator begin()LNOEXCEPT
 		{
-			HashKey = MPQHash<0>(KeyStr.c_str());
-			Hash1 = MPQHash<1>(KeyStr.c_str());
-			Hash2 = MPQHash<2>(KeyStr.c_str());
-#ifdef LDEBUG
-			Key = KeyStr;
-#endif
+			iterator tRet(m_pHashes, m_pEntries, 0, m_iCapacity);
+			tRet.skipEmpty();
+			return tRet;
 		}
-		DictionaryKey(const DictionaryKey& org)
-			: HashKey(org.HashKey), Hash1(org.Hash1), Hash2(org.Hash2)
+		iterator end()LNOEXCEPT { return iterator(m_pHashes, m_pEntries, m_iCapacity, m_iCapacity); }
+		const_iterator begin()const LNOEXCEPT
 		{
-#ifdef LDEBUG
-			Key = org.Key;
-#endif
+			const_iterator tRet(m_pHashes, m_pEntries, 0, m_iCapacity);
+			tRet.skipEmpty();
+			return tRet;
 		}
-		DictionaryKey(DictionaryKey&& org)
-			: HashKey(org.HashKey), Hash1(org.Hash1), Hash2(org.Hash2)
+		const_iterator end()const LNOEXCEPT { return const_iterator(m_pHashes, m_pEntries, m_iCapacity, m_iCapacity); }
+
+		iterator find(const char* key)LNOEXCEPT
 		{
-#ifdef LDEBUG
-			Key = std::move(org.Key);
-#endif
+			size_t tLen;
+			uint64_t tHash = DictionaryHash(key, tLen);
+			return iterator(m_pHashes, m_pEntries, findSlot(key, tLen, tHash), m_iCapacity);
+		}
+		const_iterator find(const char* key)const LNOEXCEPT
+		{
+			size_t tLen;
+			uint64_t tHash = DictionaryHash(key, tLen);
+			return const_iterator(m_pHashes, m_pEntries, findSlot(key, tLen, tHash), m_iCapacity);
 		}
-	};
 
-	struct DictionaryKeyHasher
-	{
-		size_t operator()(const DictionaryKey& k)const
+		/// @brief Ŀ
+		/// @note Ѵʱ޸ģĿ
+		template <typename... Args>
+		std::pair<iterator, bool> emplace(const char* key, Args&&... args)
 		{
-			return k.HashKey;
+			size_t tLen;
+			uint64_t tHash = DictionaryHash(key, tLen);
+			size_t i = findSlot(key, tLen, tHash);
+			if (i != m_iCapacity)
+				return std::make_pair(iterator(m_pHashes, m_pEntries, i, m_iCapacity), false);
+
+			// װӲ3/4
+			if ((m_iSize + 1) * 4 > m_iCapacity * 3)
+				rehash(m_iCapacity == 0 ? MinCapacity : m_iCapacity * 2);
+
+			i = findEmptySlot(tHash);
+			new(&m_pEntries[i]) value_type(std::piecewise_construct,
+				std::forward_as_tuple(key, tLen), std::forward_as_tuple(std::forward<Args>(args)...));
+			m_pHashes[i] = tHash;
+			++m_iSize;
+			return std::make_pair(iterator(m_pHashes, m_pEntries, i, m_iCapacity), true);
 		}
-	};
 
-	template <typename Value>
-	using Dictionary = std::unordered_map<DictionaryKey, Value, DictionaryKeyHasher>;
+		Value& operator[](const char* key)
+		{
+			return emplace(key).first->second;
+		}
+
+		void erase(iterator i)LNOEXCEPT
+		{
+			LASSERT(i.m_iIndex < m_iCapacity && m_pHashes[i.m_iIndex] != 0);
+			eraseSlot(i.m_iIndex);
+		}
+
+		/// @brief ĿѷĴ洢
+		void clear()LNOEXCEPT
+		{
+			destroyAll();
+		}
+
+		/// @brief ԤٿcountĿĴ洢
+		void reserve(size_t count)
+		{
+			size_t tCapacity = MinCapacity;
+			while (tCapacity * 3 < count * 4)
+				tCapacity *= 2;
+			if (tCapacity > m_iCapacity)
+				rehash(tCapacity);
+		}
+	private:
+		Dictionary& operator=(const Dictionary&);
+		Dictionary(const Dictionary&);
+	public:
+		Dictionary() {}
+		~Dictionary()
+		{
+			destroyAll();
+			delete[] m_pHashes;
+			::operator delete(m_pEntries);
+		}
+	};
 }
@@ -0,0 +1,78 @@
+﻿#include "FrameStats.h"
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+fuInt FrameTimeHistogram::bucketIndex(fuInt us)LNOEXCEPT
+{
+	if (us < SubBucketCount)
+		return us;
+
+	// 最高位决定区间，其后的SubBucketBits位决定区间内的桶
+	int tMsb = 0;
+	for (fuInt v = us; v >>= 1;)
+		++tMsb;
+	return (tMsb - SubBucketBits + 1) * SubBucketCount + ((us >> (tMsb - SubBucketBits)) & (SubBucketCount - 1));
+}
+
+fuInt FrameTimeHistogram::bucketUpperBound(fuInt index)LNOEXCEPT
+{
+	if (index < SubBucketCount)
+		return index;
+
+	fuInt tShift = index / SubBucketCount - 1;
+	fuInt tSub = index % SubBucketCount;
+	return ((SubBucketCount + tSub + 1) << tShift) - 1;
+}
+
+void FrameTimeHistogram::Record(double seconds, double budget)LNOEXCEPT
+{
+	static const fuInt s_MaxValue = (1u << (MaxValueBits + 1)) - 1;
+
+	double tUs = seconds * 1000000.;
+	fuInt tValue = tUs <= 0. ? 0 : (tUs >= s_MaxValue ? s_MaxValue : (fuInt)tUs);
+
+	++m_Counts[bucketIndex(tValue)];
+	if (m_iCount == 0 || tValue < m_iMin)
+		m_iMin = tValue;
+	if (m_iCount == 0 || tValue > m_iMax)
+		m_iMax = tValue;
+	++m_iCount;
+	if (budget > 0. && seconds > budget)
+		++m_iOverBudget;
+}
+
+double FrameTimeHistogram::GetPercentile(double percentile)const LNOEXCEPT
+{
+	if (m_iCount == 0)
+		return 0.;
+
+	// 第几个样本落在该百分位上，至少为1
+	double tRank = ceil(percentile / 100. * m_iCount);
+	fuInt tTarget = tRank < 1. ? 1 : (tRank >= m_iCount ? m_iCount : (fuInt)tRank);
+
+	fuInt tSeen = 0;
+	for (fuInt i = 0; i < BucketCount; ++i)
+	{
+		tSeen += m_Counts[i];
+		if (tSeen >= tTarget)
+		{
+			fuInt tValue = bucketUpperBound(i);
+			if (tValue > m_iMax)
+				tValue = m_iMax;
+			if (tValue < m_iMin)
+				tValue = m_iMin;
+			return tValue / 1000000.;
+		}
+	}
+	return m_iMax / 1000000.;
+}
+
+void FrameTimeHistogram::Reset()LNOEXCEPT
+{
+	memset(m_Counts, 0, sizeof(m_Counts));
+	m_iCount = 0;
+	m_iOverBudget = 0;
+	m_iMin = 0;
+	m_iMax = 0;
+}
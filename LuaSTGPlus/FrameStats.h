@@ -0,0 +1,67 @@
+﻿#pragma once
+#include "Global.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 帧耗时直方图
+	/// @note  以微秒为单位的对数线性分桶(类似HdrHistogram)，每个2的幂区间再等分为16个桶，
+	///        相对误差不超过1/16。记录为常数时间且不分配内存，超出范围的值被截断到最大桶中。
+	class FrameTimeHistogram
+	{
+	public:
+		static const int SubBucketBits = 4;
+		static const fuInt SubBucketCount = 1 << SubBucketBits;
+		static const int MaxValueBits = 24;  // 最高位，最大约33.5秒
+		static const fuInt BucketCount = (MaxValueBits - SubBucketBits + 2) * SubBucketCount;
+	private:
+		fuInt m_Counts[BucketCount];
+		fuInt m_iCount;
+		fuInt m_iOverBudget;  // 超出预算的帧数
+		fuInt m_iMin;
+		fuInt m_iMax;
+	private:
+		static fuInt bucketIndex(fuInt us)LNOEXCEPT;
+		static fuInt bucketUpperBound(fuInt index)LNOEXCEPT;
+	public:
+		fuInt GetCount()const LNOEXCEPT { return m_iCount; }
+		fuInt GetOverBudgetCount()const LNOEXCEPT { return m_iOverBudget; }
+		double GetMin()const LNOEXCEPT { return m_iCount ? m_iMin / 1000000. : 0.; }
+		double GetMax()const LNOEXCEPT { return m_iCount ? m_iMax / 1000000. : 0.; }
+
+		/// @brief 记录一帧的耗时
+		/// @param[in] seconds 耗时(秒)
+		/// @param[in] budget 帧预算(秒)，不大于0时不统计超出预算的帧数
+		void Record(double seconds, double budget)LNOEXCEPT;
+
+		/// @brief 取百分位数(秒)
+		/// @param[in] percentile 百分比，取值[0, 100]
+		/// @note  返回所在桶的上界，但不超过记录到的最大值
+		double GetPercentile(double percentile)const LNOEXCEPT;
+
+		void Reset()LNOEXCEPT;
+	public:
+		FrameTimeHistogram() { Reset(); }
+	};
+
+	/// @brief 帧耗时统计
+	struct FrameStats
+	{
+		FrameTimeHistogram update;  // 更新耗时
+		FrameTimeHistogram render;  // 渲染耗时
+		FrameTimeHistogram total;  // 更新与渲染的总耗时
+
+		void Record(double updateTime, double renderTime, double budget)LNOEXCEPT
+		{
+			update.Record(updateTime, budget);
+			render.Record(renderTime, budget);
+			total.Record(updateTime + renderTime, budget);
+		}
+
+		void Reset()LNOEXCEPT
+		{
+			update.Reset();
+			render.Reset();
+			total.Reset();
+		}
+	};
+}
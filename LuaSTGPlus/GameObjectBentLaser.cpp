@@ -0,0 +1,495 @@
+﻿#include "GameObjectBentLaser.h"
+#include "CollisionDetect.h"
+
+#ifdef min
+#undef min
+#endif
+#ifdef max
+#undef max
+#endif
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+static fcyMemPool<sizeof(GameObjectBentLaser)> s_GameObjectBentLaserPool(1024);
+
+GameObjectBentLaser* GameObjectBentLaser::s_pFirstInstance = nullptr;
+GameObjectBentLaser* GameObjectBentLaser::s_pLastInstance = nullptr;
+uint64_t GameObjectBentLaser::s_iInstanceCounter = 0;
+
+// 节点存储按容量分级分配
+// 每块依次存放6个float数组(x, y, half_width, dist, expand_x, expand_y)、分块包围盒数组以及翻转标记数组
+#define LBENTLASER_STORAGESIZE(cap) \
+	((cap) * (sizeof(float) * 6 + sizeof(bool)) + ((cap) / LGOBJ_LASERCHUNKSIZE + 1) * sizeof(fcyVec2) * 2)
+
+static_assert(LGOBJ_LASERCHUNKSIZE == 16 && LGOBJ_MAXLASERNODE == 512, "size classes of bent laser storage need to be updated.");
+static fcyMemPool<LBENTLASER_STORAGESIZE(16)> s_BentLaserStoragePool16(256);
+static fcyMemPool<LBENTLASER_STORAGESIZE(32)> s_BentLaserStoragePool32(256);
+static fcyMemPool<LBENTLASER_STORAGESIZE(64)> s_BentLaserStoragePool64(128);
+static fcyMemPool<LBENTLASER_STORAGESIZE(128)> s_BentLaserStoragePool128(128);
+static fcyMemPool<LBENTLASER_STORAGESIZE(256)> s_BentLaserStoragePool256(64);
+static fcyMemPool<LBENTLASER_STORAGESIZE(512)> s_BentLaserStoragePool512(64);
+
+static void* AllocBentLaserStorage(size_t capacity)
+{
+	switch (capacity)
+	{
+	case 16:
+		return s_BentLaserStoragePool16.Alloc();
+	case 32:
+		return s_BentLaserStoragePool32.Alloc();
+	case 64:
+		return s_BentLaserStoragePool64.Alloc();
+	case 128:
+		return s_BentLaserStoragePool128.Alloc();
+	case 256:
+		return s_BentLaserStoragePool256.Alloc();
+	default:
+		LASSERT(capacity == 512);
+		return s_BentLaserStoragePool512.Alloc();
+	}
+}
+
+static void FreeBentLaserStorage(void* p, size_t capacity)
+{
+	switch (capacity)
+	{
+	case 16:
+		s_BentLaserStoragePool16.Free(p);
+		break;
+	case 32:
+		s_BentLaserStoragePool32.Free(p);
+		break;
+	case 64:
+		s_BentLaserStoragePool64.Free(p);
+		break;
+	case 128:
+		s_BentLaserStoragePool128.Free(p);
+		break;
+	case 256:
+		s_BentLaserStoragePool256.Free(p);
+		break;
+	default:
+		LASSERT(capacity == 512);
+		s_BentLaserStoragePool512.Free(p);
+		break;
+	}
+}
+
+const fuShort* GameObjectBentLaser::GetIndexBuffer()LNOEXCEPT
+{
+	struct IndexBuffer
+	{
+		fuShort Data[(LGOBJ_MAXLASERNODE - 1) * 6];
+
+		IndexBuffer()
+		{
+			for (fuShort i = 0; i < LGOBJ_MAXLASERNODE - 1; ++i)
+			{
+				fuShort* p = &Data[i * 6];
+				p[0] = i * 2;
+				p[1] = i * 2 + 2;
+				p[2] = i * 2 + 3;
+				p[3] = i * 2;
+				p[4] = i * 2 + 3;
+				p[5] = i * 2 + 1;
+			}
+		}
+	};
+	static const IndexBuffer s_IndexBuffer;
+	return s_IndexBuffer.Data;
+}
+
+GameObjectBentLaser* GameObjectBentLaser::AllocInstance(size_t maxNode)
+{
+	size_t tCapacity = RingBufferIndex::NextPowerOfTwo(max<size_t>(maxNode, LGOBJ_LASERCHUNKSIZE));
+	tCapacity = min<size_t>(tCapacity, LGOBJ_MAXLASERNODE);
+
+	// ! 潜在bad_alloc
+	void* pStorage = AllocBentLaserStorage(tCapacity);
+	GameObjectBentLaser* pRet = new(s_GameObjectBentLaserPool.Alloc()) GameObjectBentLaser(tCapacity, pStorage);
+
+	// 追加到存活实例链表末尾，保持按创建序号排列
+	pRet->m_iInstanceId = s_iInstanceCounter++;
+	pRet->m_pPrevInstance = s_pLastInstance;
+	if (s_pLastInstance)
+		s_pLastInstance->m_pNextInstance = pRet;
+	else
+		s_pFirstInstance = pRet;
+	s_pLastInstance = pRet;
+	return pRet;
+}
+
+void GameObjectBentLaser::FreeInstance(GameObjectBentLaser* p)
+{
+	if (p->m_pPrevInstance)
+		p->m_pPrevInstance->m_pNextInstance = p->m_pNextInstance;
+	else
+		s_pFirstInstance = p->m_pNextInstance;
+	if (p->m_pNextInstance)
+		p->m_pNextInstance->m_pPrevInstance = p->m_pPrevInstance;
+	else
+		s_pLastInstance = p->m_pPrevInstance;
+
+	void* pStorage = p->m_pStorage;
+	size_t tCapacity = p->GetCapacity();
+	p->~GameObjectBentLaser();
+	FreeBentLaserStorage(pStorage, tCapacity);
+	s_GameObjectBentLaserPool.Free(p);
+}
+
+GameObjectBentLaser::GameObjectBentLaser(size_t capacity, void* storage)
+	: m_Ring(capacity), m_pStorage(storage)
+{
+	m_iChunkCount = capacity / LGOBJ_LASERCHUNKSIZE + 1;
+	m_iSerialPeriod = m_iChunkCount * LGOBJ_LASERCHUNKSIZE;  // 保证序号回绕时分块下标连续
+
+	// 划分存储
+	float* p = static_cast<float*>(storage);
+	m_pNodeX = p;
+	m_pNodeY = (p += capacity);
+	m_pNodeHalfWidth = (p += capacity);
+	m_pNodeSegLength = (p += capacity);
+	m_pNodeExpandX = (p += capacity);
+	m_pNodeExpandY = (p += capacity);
+	m_pChunkBound = reinterpret_cast<LaserBound*>(p + capacity);
+	m_pNodeFlip = reinterpret_cast<bool*>(m_pChunkBound + m_iChunkCount);
+
+	m_Bound.Reset();
+}
+
+GameObjectBentLaser::~GameObjectBentLaser()
+{
+}
+
+// 曲线激光保存状态的头部，随后是整块节点存储
+struct BentLaserState
+{
+	size_t capacity;
+	RingBufferIndex ring;
+	size_t headSerial;
+	fcyVec2 boundA, boundB;
+};
+
+size_t GameObjectBentLaser::GetStateSize()const LNOEXCEPT
+{
+	return sizeof(BentLaserState) + LBENTLASER_STORAGESIZE(m_Ring.Capacity());
+}
+
+size_t GameObjectBentLaser::SaveState(fByte* dest)const LNOEXCEPT
+{
+	BentLaserState tState;
+	tState.capacity = m_Ring.Capacity();
+	tState.ring = m_Ring;
+	tState.headSerial = m_iHeadSerial;
+	tState.boundA = m_Bound.a;
+	tState.boundB = m_Bound.b;
+	memcpy(dest, &tState, sizeof(tState));
+	memcpy(dest + sizeof(tState), m_pStorage, LBENTLASER_STORAGESIZE(tState.capacity));
+	return sizeof(tState) + LBENTLASER_STORAGESIZE(tState.capacity);
+}
+
+size_t GameObjectBentLaser::LoadState(const fByte* src)LNOEXCEPT
+{
+	BentLaserState tState;
+	memcpy(&tState, src, sizeof(tState));
+	if (tState.capacity != m_Ring.Capacity())
+		return 0;
+	m_Ring = tState.ring;
+	m_iHeadSerial = tState.headSerial;
+	m_Bound.a = tState.boundA;
+	m_Bound.b = tState.boundB;
+	memcpy(m_pStorage, src + sizeof(tState), LBENTLASER_STORAGESIZE(tState.capacity));
+	return sizeof(tState) + LBENTLASER_STORAGESIZE(tState.capacity);
+}
+
+bool GameObjectBentLaser::PushNode(float x, float y, int length, float width)LNOEXCEPT
+{
+	if (length <= 1)
+	{
+		LERROR("lstgBentLaserData: 无效的参数length");
+		return false;
+	}
+
+	// 移除多余的节点，保证长度在length范围内
+	bool bPopped = false;
+	bool bChunkRetired = false;
+	while (m_Ring.IsFull() || m_Ring.Size() >= (size_t)length)
+	{
+		m_Ring.Pop();
+		bPopped = true;
+
+		// 队首线段移出，若其所在分块已全部移出则需要重新计算整体包围盒
+		if (m_iHeadSerial % LGOBJ_LASERCHUNKSIZE == LGOBJ_LASERCHUNKSIZE - 1)
+			bChunkRetired = true;
+		m_iHeadSerial = (m_iHeadSerial + 1) % m_iSerialPeriod;
+	}
+	if (bChunkRetired)
+		updateBound();
+
+	// 队首节点改变，更新其渲染缓存
+	// 与新队首重合的节点沿用其扩展向量，需要一并更新
+	if (bPopped && m_Ring.Size() > 1)
+	{
+		updateNodeExpand(0);
+		for (size_t i = 1; i < m_Ring.Size(); ++i)
+		{
+			updateNodeExpand(i);
+			size_t cur = m_Ring[i], prev = m_Ring[i - 1];
+			if (fcyVec2(m_pNodeX[cur] - m_pNodeX[prev], m_pNodeY[cur] - m_pNodeY[prev]).Length() >= 0.0001f)
+				break;
+		}
+	}
+
+	// 添加新节点
+	if (m_Ring.Size() < (size_t)length)
+	{
+		size_t tLast = m_Ring.Push();
+		m_pNodeX[tLast] = x;
+		m_pNodeY[tLast] = y;
+		m_pNodeHalfWidth[tLast] = width / 2.f;
+		m_pNodeSegLength[tLast] = 0.f;
+		m_pNodeExpandX[tLast] = m_pNodeExpandY[tLast] = 0.f;
+		m_pNodeFlip[tLast] = false;
+
+		if (m_Ring.Size() > 1)
+		{
+			size_t tBeforeLast = m_Ring[m_Ring.Size() - 2];
+			float tLastX = m_pNodeX[tLast], tLastY = m_pNodeY[tLast];
+			float tBeforeLastX = m_pNodeX[tBeforeLast], tBeforeLastY = m_pNodeY[tBeforeLast];
+
+			// 线段长度
+			m_pNodeSegLength[tLast] = fcyVec2(tBeforeLastX - tLastX, tBeforeLastY - tLastY).Length();
+
+			// 原队尾节点和新节点的渲染缓存
+			updateNodeExpand(m_Ring.Size() - 2);
+			updateNodeExpand(m_Ring.Size() - 1);
+
+			// 将新线段并入所在分块及整体的包围盒
+			size_t tSerial = (m_iHeadSerial + m_Ring.Size() - 2) % m_iSerialPeriod;
+			LaserBound& tChunk = m_pChunkBound[tSerial / LGOBJ_LASERCHUNKSIZE];
+			if (tSerial % LGOBJ_LASERCHUNKSIZE == 0 || m_Ring.Size() == 2)  // 新分块或者第一条线段
+				tChunk.Reset();
+
+			float r = max(m_pNodeHalfWidth[tLast], m_pNodeHalfWidth[tBeforeLast]);
+			LaserBound tSegment;
+			tSegment.a.Set(min(tLastX, tBeforeLastX) - r, min(tLastY, tBeforeLastY) - r);
+			tSegment.b.Set(max(tLastX, tBeforeLastX) + r, max(tLastY, tBeforeLastY) + r);
+			tChunk.Merge(tSegment);
+			m_Bound.Merge(tSegment);
+		}
+	}
+
+	return true;
+}
+
+void GameObjectBentLaser::updateBound()LNOEXCEPT
+{
+	m_Bound.Reset();
+	if (m_Ring.Size() <= 1)
+		return;
+
+	// 合并所有仍包含线段的分块
+	// 部分移出的队首分块不做收缩，其包围盒偏大但仍然保守
+	size_t tSegmentCount = m_Ring.Size() - 1;
+	size_t tFirstChunk = m_iHeadSerial / LGOBJ_LASERCHUNKSIZE;
+	size_t tLastChunk = ((m_iHeadSerial + tSegmentCount - 1) % m_iSerialPeriod) / LGOBJ_LASERCHUNKSIZE;
+	for (size_t i = tFirstChunk; ; i = (i + 1) % m_iChunkCount)
+	{
+		m_Bound.Merge(m_pChunkBound[i]);
+		if (i == tLastChunk)
+			break;
+	}
+}
+
+void GameObjectBentLaser::updateNodeExpand(size_t i)LNOEXCEPT
+{
+	size_t cur = m_Ring[i];
+	fcyVec2 curPos(m_pNodeX[cur], m_pNodeY[cur]);
+	float halfWidth = m_pNodeHalfWidth[cur];
+	fcyVec2 expand;
+
+	m_pNodeFlip[cur] = false;
+	if (m_Ring.Size() <= 1)
+		return;
+
+	// 首个节点使用到下一节点的方向计算宽度扩展(旋转270度)
+	if (i == 0)
+	{
+		size_t next = m_Ring[1];
+		fcyVec2 offset = curPos - fcyVec2(m_pNodeX[next], m_pNodeY[next]);
+		float lenOffset = offset.Length();
+		if (lenOffset < 0.0001f)
+			expand.Set(0.f, 0.f);
+		else
+			expand.Set(offset.y / lenOffset * halfWidth, -offset.x / lenOffset * halfWidth);
+		m_pNodeExpandX[cur] = expand.x;
+		m_pNodeExpandY[cur] = expand.y;
+		return;
+	}
+
+	size_t prev = m_Ring[i - 1];
+
+	// 计算从cur到prev的向量，与前一节点重合时直接沿用前一节点的扩展
+	fcyVec2 offsetA = fcyVec2(m_pNodeX[prev], m_pNodeY[prev]) - curPos;
+	float lenOffsetA = offsetA.Length();
+	if (lenOffsetA < 0.0001f)
+	{
+		m_pNodeExpandX[cur] = m_pNodeExpandX[prev];
+		m_pNodeExpandY[cur] = m_pNodeExpandY[prev];
+		return;
+	}
+	offsetA *= (1 / lenOffsetA);
+
+	// 计算宽度上的扩展长度(旋转270度)
+	fcyVec2 expandVec(offsetA.y, -offsetA.x);
+
+	if (i == m_Ring.Size() - 1)  // 最后一个节点，则其宽度扩展使用expandVec计算
+		expand = expandVec * halfWidth;
+	else  // 否则，参考下一个节点
+	{
+		// 计算向量cur->next并规范化，相加offsetA和offsetB后得角平分线
+		size_t next = m_Ring[i + 1];
+		fcyVec2 offsetB = fcyVec2(m_pNodeX[next], m_pNodeY[next]) - curPos;
+		float lenOffsetB = offsetB.Length();
+		fcyVec2 angleBisect = offsetA;
+		if (lenOffsetB >= 0.0001f)
+			angleBisect += offsetB * (1 / lenOffsetB);
+		float angleBisectLen = angleBisect.Length();
+
+		if (lenOffsetB < 0.0001f || angleBisectLen < 0.00002f || angleBisectLen > 1.99998f)  // 几乎在一条直线上
+			expand = expandVec * halfWidth;
+		else  // 计算角平分线到角两边距离为half_width的偏移量
+		{
+			angleBisect *= (1 / angleBisectLen);  // angleBisect.Normalize();
+			float t = angleBisect * offsetA;
+			float expandDelta = sqrt(halfWidth * halfWidth / (1.f - t * t));
+			expand = angleBisect * expandDelta;
+		}
+	}
+	m_pNodeExpandX[cur] = expand.x;
+	m_pNodeExpandY[cur] = expand.y;
+
+	// 修正交叉的情况
+	// 当与前一节点的扩展向量夹角超过90度时四边形会自交，此时需要交换两侧的顶点
+	// 同逐段绘制时的行为，最后一个节点不做修正，成为非末尾节点时会重新计算
+	if (i != m_Ring.Size() - 1)
+		m_pNodeFlip[cur] = (expand.x * m_pNodeExpandX[prev] + expand.y * m_pNodeExpandY[prev] < 0.f);
+}
+
+void GameObjectBentLaser::Release()LNOEXCEPT
+{
+}
+
+size_t GameObjectBentLaser::BuildVertices(f2dGraphics2DVertex* out, fcyColor c, float u_left, float u_width, float v_top, float v_bottom, float scale)const LNOEXCEPT
+{
+	if (m_Ring.Size() <= 1)
+		return 0;
+
+	// 总长度每次从线段长度重新求和，长时间存活的激光也不会累积误差
+	size_t tCount = m_Ring.Size();
+	float tLength = 0.f;
+	for (size_t i = 1; i < tCount; ++i)
+		tLength += m_pNodeSegLength[m_Ring[i]];
+	float tUFactor = tLength > 0.f ? u_width / tLength : 0.f;
+
+	// 按两段连续区间顺序遍历节点
+	RingBufferIndex::Span tSpans[2];
+	m_Ring.GetSpans(tSpans[0], tSpans[1]);
+
+	size_t i = 0;
+	bool bFlip = false;
+	float tDist = 0.f;
+	for (int s = 0; s < 2; ++s)
+	{
+		for (size_t j = tSpans[s].Begin; j < tSpans[s].Begin + tSpans[s].Count; ++j, ++i)
+		{
+			bFlip = (bFlip != m_pNodeFlip[j]);
+
+			float expX = m_pNodeExpandX[j] * scale;
+			float expY = m_pNodeExpandY[j] * scale;
+			if (bFlip)
+			{
+				expX = -expX;
+				expY = -expY;
+			}
+			if (i > 0)
+				tDist += m_pNodeSegLength[j];
+			float u = (i == tCount - 1) ? u_left + u_width : u_left + tDist * tUFactor;
+
+			f2dGraphics2DVertex& v1 = out[i * 2];
+			v1.x = m_pNodeX[j] + expX;
+			v1.y = m_pNodeY[j] + expY;
+			v1.z = 0.5f;
+			v1.color = c.argb;
+			v1.u = u;
+			v1.v = v_top;
+
+			f2dGraphics2DVertex& v2 = out[i * 2 + 1];
+			v2.x = m_pNodeX[j] - expX;
+			v2.y = m_pNodeY[j] - expY;
+			v2.z = 0.5f;
+			v2.color = c.argb;
+			v2.u = u;
+			v2.v = v_bottom;
+		}
+	}
+
+	return tCount * 2;
+}
+
+bool GameObjectBentLaser::CollisionCheck(float x, float y, float rot, float a, float b, bool rect)LNOEXCEPT
+{
+	// 忽略只有一个节点的情况
+	if (m_Ring.Size() <= 1)
+		return false;
+
+	// 计算外接圆半径，同GameObject::UpdateCollisionCirclrRadius
+	fcyVec2 tPos(x, y), tSize(a, b);
+	float tColR = rect ? sqrt(a * a + b * b) : (a + b) / 2.f;
+
+	// 整体包围盒剔除
+	if (!m_Bound.Overlap(tPos, tColR))
+		return false;
+
+	size_t tSegmentCount = m_Ring.Size() - 1;
+	size_t i = 0;
+	while (i < tSegmentCount)
+	{
+		// 以分块为单位剔除
+		size_t tSerial = (m_iHeadSerial + i) % m_iSerialPeriod;
+		size_t tChunkEnd = min(tSegmentCount, i + LGOBJ_LASERCHUNKSIZE - tSerial % LGOBJ_LASERCHUNKSIZE);
+		if (!m_pChunkBound[tSerial / LGOBJ_LASERCHUNKSIZE].Overlap(tPos, tColR))
+		{
+			i = tChunkEnd;
+			continue;
+		}
+
+		// 将相邻两个节点构成的线段视作胶囊体进行检测
+		for (; i < tChunkEnd; ++i)
+		{
+			size_t cur = m_Ring[i];
+			size_t next = m_Ring[i + 1];
+			fcyVec2 curPos(m_pNodeX[cur], m_pNodeY[cur]);
+			fcyVec2 nextPos(m_pNodeX[next], m_pNodeY[next]);
+			float r = max(m_pNodeHalfWidth[cur], m_pNodeHalfWidth[next]);
+
+			// 快速检测
+			float tReach = r + tColR;
+			if (min(curPos.x, nextPos.x) - tReach >= x || max(curPos.x, nextPos.x) + tReach <= x ||
+				min(curPos.y, nextPos.y) - tReach >= y || max(curPos.y, nextPos.y) + tReach <= y)
+			{
+				continue;
+			}
+
+			if (rect)
+			{
+				if (CapsuleOBBHitTest(curPos, nextPos, r, tPos, tSize, rot))
+					return true;
+			}
+			else if (CapsuleCircleHitTest(curPos, nextPos, r, tPos, tColR))
+				return true;
+		}
+	}
+	return false;
+}
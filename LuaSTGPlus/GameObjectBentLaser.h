@@ -0,0 +1,128 @@
+﻿#pragma once
+#include "Global.h"
+#include "RingBuffer.hpp"
+#include "ResourceMgr.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 曲线激光特化实现
+	class GameObjectBentLaser
+	{
+	public:
+		/// @brief 创建曲线激光
+		/// @param[in] maxNode 最大节点数，实际容量为不小于该值的2的幂(最小为LGOBJ_LASERCHUNKSIZE，最大为LGOBJ_MAXLASERNODE)
+		static GameObjectBentLaser* AllocInstance(size_t maxNode = LGOBJ_MAXLASERNODE);
+		static void FreeInstance(GameObjectBentLaser* p);
+		/// @brief 获取最早创建的存活实例，实例按创建顺序排列
+		static GameObjectBentLaser* GetFirstInstance()LNOEXCEPT { return s_pFirstInstance; }
+	private:
+		static GameObjectBentLaser* s_pFirstInstance;
+		static GameObjectBentLaser* s_pLastInstance;
+		static uint64_t s_iInstanceCounter;
+	private:
+		/// @brief 包围盒，a为左下角，b为右上角
+		struct LaserBound
+		{
+			fcyVec2 a, b;
+
+			void Reset()
+			{
+				const float tMax = (std::numeric_limits<float>::max)();
+				a.Set(tMax, tMax);
+				b.Set(-tMax, -tMax);
+			}
+			void Merge(float left, float bottom, float right, float top)
+			{
+				if (left < a.x) a.x = left;
+				if (bottom < a.y) a.y = bottom;
+				if (right > b.x) b.x = right;
+				if (top > b.y) b.y = top;
+			}
+			void Merge(const LaserBound& other)
+			{
+				Merge(other.a.x, other.a.y, other.b.x, other.b.y);
+			}
+			bool Overlap(fcyVec2 pos, float r)const
+			{
+				return !(a.x >= pos.x + r || b.x <= pos.x - r || a.y >= pos.y + r || b.y <= pos.y - r);
+			}
+		};
+	private:
+		// 节点数据以SoA形式存放在按容量分级分配的同一块内存中，槽位由m_Ring管理
+		RingBufferIndex m_Ring;
+		void* m_pStorage = nullptr;
+		float* m_pNodeX = nullptr;  // 节点坐标
+		float* m_pNodeY = nullptr;
+		float* m_pNodeHalfWidth = nullptr;  // 节点宽度的一半
+
+		// 渲染缓存，仅在节点加入或移出时更新
+		float* m_pNodeSegLength = nullptr;  // 到前一节点的距离，用于计算纹理坐标，队首节点的值不使用
+		float* m_pNodeExpandX = nullptr;  // 未经缩放的宽度扩展向量
+		float* m_pNodeExpandY = nullptr;
+		bool* m_pNodeFlip = nullptr;  // 扩展方向是否相对前一节点翻转(修正交叉)
+
+		// 碰撞剔除用包围盒
+		// 第i段线段连接第i和第i+1个节点，按序号每LGOBJ_LASERCHUNKSIZE段分为一块，每块记录其所有线段的包围盒
+		size_t m_iHeadSerial = 0;  // 队首节点(线段)序号
+		size_t m_iSerialPeriod = 0;  // 序号的循环周期
+		LaserBound m_Bound;  // 所有线段的包围盒
+		LaserBound* m_pChunkBound = nullptr;
+		size_t m_iChunkCount = 0;
+
+		// 存活实例链表，用于保存和恢复快照
+		uint64_t m_iInstanceId = 0;  // 创建序号，不会重复
+		GameObjectBentLaser* m_pPrevInstance = nullptr;
+		GameObjectBentLaser* m_pNextInstance = nullptr;
+	private:
+		void updateBound()LNOEXCEPT;
+		void updateNodeExpand(size_t i)LNOEXCEPT;
+	public:
+		/// @brief 获取节点容量
+		size_t GetCapacity()LNOEXCEPT { return m_Ring.Capacity(); }
+
+		/// @brief 获取节点数
+		size_t GetNodeCount()const LNOEXCEPT { return m_Ring.Size(); }
+
+		/// @brief 获取创建序号
+		uint64_t GetInstanceId()const LNOEXCEPT { return m_iInstanceId; }
+
+		/// @brief 获取下一个存活实例
+		GameObjectBentLaser* GetNextInstance()const LNOEXCEPT { return m_pNextInstance; }
+
+		/// @brief 获取保存状态所需的字节数
+		size_t GetStateSize()const LNOEXCEPT;
+
+		/// @brief 保存节点队列与包围盒
+		/// @return 写出的字节数
+		size_t SaveState(fByte* dest)const LNOEXCEPT;
+
+		/// @brief 载入SaveState保存的状态
+		/// @return 读入的字节数，容量不一致时返回0且不作修改
+		size_t LoadState(const fByte* src)LNOEXCEPT;
+
+		/// @brief 在队尾加入节点，节点数达到length时先移除队首节点
+		bool PushNode(float x, float y, int length, float width)LNOEXCEPT;
+
+		/// @brief 生成整条激光的顶点，每个节点对应两侧的两个顶点，按GetIndexBuffer()组成三角形
+		/// @note  纹理坐标须已规范化到[0,1]区间，与原先逐段绘制的差分测试见RenderTest
+		/// @param[out] out 至少容纳GetNodeCount() * 2个顶点
+		/// @return 顶点数，节点数不足2时返回0
+		size_t BuildVertices(f2dGraphics2DVertex* out, fcyColor c, float u_left, float u_width, float v_top, float v_bottom, float scale)const LNOEXCEPT;
+
+		/// @brief 以对象id当前的位置加入节点(GameObjectPool.cpp)
+		bool Update(size_t id, int length, float width)LNOEXCEPT;
+		void Release()LNOEXCEPT;
+		/// @brief 按纹理资源渲染(GameObjectPool.cpp)
+		bool Render(const char* tex_name, BlendMode blend, fcyColor c, float tex_left, float tex_top, float tex_width, float tex_height, float scale)LNOEXCEPT;
+		bool CollisionCheck(float x, float y, float rot, float a, float b, bool rect)LNOEXCEPT;
+		/// @brief 检查是否有节点位于对象池边界内(GameObjectPool.cpp)
+		bool BoundCheck()LNOEXCEPT;
+	public:
+		/// @brief 所有曲线激光共享的索引缓冲
+		/// @note  第i段由顶点2i、2i+1(节点i两侧)和2i+2、2i+3(节点i+1两侧)组成两个三角形
+		static const fuShort* GetIndexBuffer()LNOEXCEPT;
+	protected:
+		GameObjectBentLaser(size_t capacity, void* storage);
+		~GameObjectBentLaser();
+	};
+}
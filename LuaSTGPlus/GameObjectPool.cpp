@@ -2,6 +2,8 @@
 #include "GameObjectPropertyHash.inl"
 #include "AppFrame.h"
 #include "CollisionDetect.h"
+#include "Profiler.h"
+#include "Utility.h"
 
 #define METATABLE_OBJ "mt"
 
@@ -40,6 +42,26 @@
         p->p##field##Next->p##field##Prev = p->p##field##Prev; \
     } while(false)
 
+// ɨһժз״̬Ķ
+#define LIST_SWEEP(header, tail, field) \
+    do { \
+        GameObject* pKeep = (header); \
+        for (GameObject* pSweep = pKeep->p##field##Next; pSweep != (tail); pSweep = pSweep->p##field##Next) \
+        { \
+            if (pSweep->status == STATUS_DEFAULT) \
+            { \
+                if (pKeep->p##field##Next != pSweep) \
+                { \
+                    pKeep->p##field##Next = pSweep; \
+                    pSweep->p##field##Prev = pKeep; \
+                } \
+                pKeep = pSweep; \
+            } \
+        } \
+        pKeep->p##field##Next = (tail); \
+        (tail)->p##field##Prev = pKeep; \
+    } while(false)
+
 #define LIST_INSERT_SORT(p, field, func) \
     do { \
         if (p->p##field##Next->p##field##Next && func(p->p##field##Next, p)) \
@@ -75,6 +97,46 @@ static inline bool RenderListSortFunc(GameObject* p1, GameObject* p2)LNOEXCEPT
     return (p1->layer < p2->layer) || ((p1->layer == p2->layer) && (p1->uid < p2->uid));
 }
 
+static inline bool PhaseResultSortFunc(const pair<GameObject*, GameObject*>& a, const pair<GameObject*, GameObject*>& b)LNOEXCEPT
+{
+    // ײuid򣬰(A, B)uid򼴿ɻԭб˳
+    return (a.first->uid < b.first->uid) || ((a.first == b.first) && b.second && (a.second->uid < b.second->uid));
+}
+
+// н׶еĽ壬дʱύÿ
+class PhaseResultBuffer
+{
+private:
+    static const size_t BufferSize = 64;
+
+    mutex& m_Lock;
+    vector<pair<GameObject*, GameObject*>>& m_Results;
+    pair<GameObject*, GameObject*> m_Buffer[BufferSize];
+    size_t m_iCount = 0;
+public:
+    void Push(GameObject* pA, GameObject* pB)LNOEXCEPT
+    {
+        if (m_iCount == BufferSize)
+            Flush();
+        m_Buffer[m_iCount++] = make_pair(pA, pB);
+    }
+    void Flush()LNOEXCEPT
+    {
+        if (m_iCount == 0)
+            return;
+        lock_guard<mutex> tLock(m_Lock);
+        m_Results.insert(m_Results.end(), m_Buffer, m_Buffer + m_iCount);
+        m_iCount = 0;
+    }
+public:
+    PhaseResultBuffer(mutex& lock, vector<pair<GameObject*, GameObject*>>& results)
+        : m_Lock(lock), m_Results(results) {}
+    ~PhaseResultBuffer()
+    {
+        Flush();
+    }
+};
+
 static inline bool CollisionCheck(GameObject* p1, GameObject* p2)LNOEXCEPT
 {
     if (!p1->colli || !p2->colli)  // Բײ
@@ -139,82 +201,20 @@ static inline bool CollisionCheck(GameObject* p1, GameObject* p2)LNOEXCEPT
 ////////////////////////////////////////////////////////////////////////////////
 /// GameObjectBentLaser
 ////////////////////////////////////////////////////////////////////////////////
-static fcyMemPool<sizeof(GameObjectBentLaser)> s_GameObjectBentLaserPool(1024);
-
-GameObjectBentLaser* GameObjectBentLaser::AllocInstance()
-{
-    // ! Ǳbad_alloc
-    GameObjectBentLaser* pRet = new(s_GameObjectBentLaserPool.Alloc()) GameObjectBentLaser();
-    return pRet;
-}
-
-void GameObjectBentLaser::FreeInstance(GameObjectBentLaser* p)
-{
-    p->~GameObjectBentLaser();
-    s_GameObjectBentLaserPool.Free(p);
-}
-
-GameObjectBentLaser::GameObjectBentLaser()
-{
-}
-
-GameObjectBentLaser::~GameObjectBentLaser()
-{
-}
+// ڵ붥ɼGameObjectBentLaser.cppֻʵغԴĲ
 
 bool GameObjectBentLaser::Update(size_t id, int length, float width)LNOEXCEPT
 {
     GameObject* p = LPOOL.GetPooledObject(id);
     if (!p)
         return false;
-    if (length <= 1)
-    {
-        LERROR("lstgBentLaserData: ЧĲlength");
-        return false;
-    }
-
-    // ƳĽڵ㣬֤lengthΧ
-    while (m_Queue.IsFull() || m_Queue.Size() >= (size_t)length)
-    {
-        LaserNode tLastPop;
-        m_Queue.Pop(tLastPop);
-
-        // ܳ
-        if (!m_Queue.IsEmpty())
-        {
-            LaserNode tFront = m_Queue.Front();
-            m_fLength -= (tLastPop.pos - tFront.pos).Length();
-        }
-    }
-
-    // ½ڵ
-    if (m_Queue.Size() < (size_t)length)
-    {
-        LaserNode tNode;
-        tNode.pos.Set((float)p->x, (float)p->y);
-        tNode.half_width = width / 2.f;
-        m_Queue.Push(tNode);
-
-        // ܳ
-        if (m_Queue.Size() > 1)
-        {
-            LaserNode& tNodeLast = m_Queue.Back();
-            LaserNode& tNodeBeforeLast = m_Queue[m_Queue.Size() - 2];
-            m_fLength += (tNodeBeforeLast.pos - tNodeLast.pos).Length();
-        }
-    }
-
-    return true;
-}
-
-void GameObjectBentLaser::Release()LNOEXCEPT
-{
+    return PushNode((float)p->x, (float)p->y, length, width);
 }
 
 bool GameObjectBentLaser::Render(const char* tex_name, BlendMode blend, fcyColor c, float tex_left, float tex_top, float tex_width, float tex_height, float scale)LNOEXCEPT
 {
     // ֻһڵ
-    if (m_Queue.Size() <= 1)
+    if (m_Ring.Size() <= 1)
         return true;
 
     fcyRefPointer<ResTexture> pTex = LRES.FindTexture(tex_name);
@@ -224,160 +224,39 @@ bool GameObjectBentLaser::Render(const char* tex_name, BlendMode blend, fcyColor
         return false;
     }
 
-    f2dGraphics2DVertex renderVertex[4] = {
-        { 0, 0, 0.5f, c.argb, 0, tex_top },
-        { 0, 0, 0.5f, c.argb, 0, tex_top },
-        { 0, 0, 0.5f, c.argb, 0, tex_top + tex_height },
-        { 0, 0, 0.5f, c.argb, 0, tex_top + tex_height }
-    };
+    // ߼⹲Ķ㻺壬ÿڵӦ
+    static f2dGraphics2DVertex s_LaserVertex[LGOBJ_MAXLASERNODE * 2];
 
-    float tVecLength = 0;
-    for (size_t i = 0; i < m_Queue.Size() - 1; ++i)
+    // ޴ģʽ²ɶ㣬ֻڵ¼Ƶ붥㡢ı
+    if (LAPP.IsHeadless())
     {
-        LaserNode& cur = m_Queue[i];
-        LaserNode& next = m_Queue[i + 1];
-
-        // ===  ===
-        // curnext
-        fcyVec2 offsetA = cur.pos - next.pos;
-        float lenOffsetA = offsetA.Length();
-        if (lenOffsetA < 0.0001f && i + 1 != m_Queue.Size() - 1)
-            continue;
-
-        // ϵչ(ת270)
-        fcyVec2 expandVec = offsetA.GetNormalize();
-        std::swap(expandVec.x, expandVec.y);
-        expandVec.y = -expandVec.y;
-
-        if (i == 0)  // ǵһڵ㣬չʹexpandVec
-        {
-            float expX = expandVec.x * scale * cur.half_width;
-            float expY = expandVec.y * scale * cur.half_width;
-            renderVertex[0].x = cur.pos.x + expX;
-            renderVertex[0].y = cur.pos.y + expY;
-            renderVertex[0].u = tex_left;
-            renderVertex[3].x = cur.pos.x - expX;
-            renderVertex[3].y = cur.pos.y - expY;
-            renderVertex[3].u = tex_left;
-        }
-        else  // 򣬿12
-        {
-            renderVertex[0].x = renderVertex[1].x;
-            renderVertex[0].y = renderVertex[1].y;
-            renderVertex[0].u = renderVertex[1].u;
-            renderVertex[3].x = renderVertex[2].x;
-            renderVertex[3].y = renderVertex[2].y;
-            renderVertex[3].u = renderVertex[2].u;
-        }
-
-        // === Ҳ ===
-        tVecLength += lenOffsetA;
-        if (i == m_Queue.Size() - 2)  // ڵ㣬չʹexpandVec
-        {
-            float expX = expandVec.x * scale * next.half_width;
-            float expY = expandVec.y * scale * next.half_width;
-            renderVertex[1].x = next.pos.x + expX;
-            renderVertex[1].y = next.pos.y + expY;
-            renderVertex[1].u = tex_left + tex_width;
-            renderVertex[2].x = next.pos.x - expX;
-            renderVertex[2].y = next.pos.y - expY;
-            renderVertex[2].u = tex_left + tex_width;
-        }
-        else  // 򣬲ο
-        {
-            float expX, expY;
-            LaserNode& afterNext = m_Queue[i + 2];
-
-            // next->afterNext淶offsetAoffsetBýƽ
-            fcyVec2 offsetB = afterNext.pos - next.pos;
-            fcyVec2 angleBisect = offsetA.GetNormalize() + offsetB.GetNormalize();
-            float angleBisectLen = angleBisect.Length();
-
-            if (angleBisectLen < 0.00002f || angleBisectLen > 1.99998f)  // һֱ
-            {
-                expX = expandVec.x * scale * next.half_width;
-                expY = expandVec.y * scale * next.half_width;
-            }
-            else // ƽߵ߾Ϊnext.half_width * scaleƫ
-            {
-                angleBisect *= (1 / angleBisectLen);  // angleBisect.Normalize();
-                float t = angleBisect * offsetA.GetNormalize();
-                float l = scale * next.half_width;
-                float expandDelta = sqrt(l * l / (1.f - t * t));
-                expX = angleBisect.x * expandDelta;
-                expY = angleBisect.y * expandDelta;
-            }
-            
-            // ö
-            float u = tex_left + tVecLength / m_fLength * tex_width;
-            renderVertex[1].x = next.pos.x + expX;
-            renderVertex[1].y = next.pos.y + expY;
-            renderVertex[1].u = u;
-            renderVertex[2].x = next.pos.x - expX;
-            renderVertex[2].y = next.pos.y - expY;
-            renderVertex[2].u = u;
-
-            // 
-            float cross1 = fcyVec2(renderVertex[1].x - renderVertex[0].x, renderVertex[1].y - renderVertex[0].y) *
-                fcyVec2(renderVertex[2].x - renderVertex[3].x, renderVertex[2].y - renderVertex[3].y);
-            float cross2 = fcyVec2(renderVertex[2].x - renderVertex[0].x, renderVertex[2].y - renderVertex[0].y) *
-                fcyVec2(renderVertex[1].x - renderVertex[3].x, renderVertex[1].y - renderVertex[3].y);
-            if (cross2 > cross1)
-            {
-                std::swap(renderVertex[1].x, renderVertex[2].x);
-                std::swap(renderVertex[1].y, renderVertex[2].y);
-            }    
-        }
-
-        // һ
-        if (!LAPP.RenderTexture(pTex, blend, renderVertex))
-            return false;
+        size_t tVertCount = GetNodeCount() * 2;
+        return LAPP.RenderTextureRaw(pTex, blend, s_LaserVertex, tVertCount, nullptr, (tVertCount / 2 - 1) * 6);
     }
-    return true;
-}
 
-bool GameObjectBentLaser::CollisionCheck(float x, float y, float rot, float a, float b, bool rect)LNOEXCEPT
-{
-    // ֻһڵ
-    if (m_Queue.Size() <= 1)
-        return false;
+    // Ԥȹ淶[0,1]
+    float tTexWidth = (float)pTex->GetTexture()->GetWidth();
+    float tTexHeight = (float)pTex->GetTexture()->GetHeight();
+    size_t tVertCount = BuildVertices(s_LaserVertex, c, tex_left / tTexWidth, tex_width / tTexWidth,
+        tex_top / tTexHeight, (tex_top + tex_height) / tTexHeight, scale);
 
-    GameObject testObjA;
-    testObjA.Reset();
-    testObjA.rot = 0.;
-    testObjA.rect = false;
-
-    GameObject testObjB;
-    testObjB.Reset();
-    testObjB.x = x;
-    testObjB.y = y;
-    testObjB.rot = rot;
-    testObjB.a = a;
-    testObjB.b = b;
-    testObjB.rect = rect;
-    testObjB.UpdateCollisionCirclrRadius();
-
-    for (size_t i = 0; i < m_Queue.Size(); ++i)
-    {
-        LaserNode& n = m_Queue[i];
-        testObjA.x = n.pos.x;
-        testObjA.y = n.pos.y;
-        testObjA.a = testObjA.b = n.half_width;
-        testObjA.UpdateCollisionCirclrRadius();
-        if (::CollisionCheck(&testObjA, &testObjB))
-            return true;
-    }
-    return false;
+    // һύ⣬ÿ
+    return LAPP.RenderTextureRaw(pTex, blend, s_LaserVertex, tVertCount, GetIndexBuffer(), (tVertCount / 2 - 1) * 6);
 }
 
 bool GameObjectBentLaser::BoundCheck()LNOEXCEPT
 {
     fcyRect tBound = LPOOL.GetBound();
-    for (size_t i = 0; i < m_Queue.Size(); ++i)
+
+    RingBufferIndex::Span tSpans[2];
+    m_Ring.GetSpans(tSpans[0], tSpans[1]);
+    for (int s = 0; s < 2; ++s)
     {
-        LaserNode& n = m_Queue[i];
-        if (n.pos.x >= tBound.a.x && n.pos.x <= tBound.b.x && n.pos.y <= tBound.a.y && n.pos.y >= tBound.b.y)
-            return true;
+        for (size_t j = tSpans[s].Begin; j < tSpans[s].Begin + tSpans[s].Count; ++j)
+        {
+            if (m_pNodeX[j] >= tBound.a.x && m_pNodeX[j] <= tBound.b.x && m_pNodeY[j] <= tBound.a.y && m_pNodeY[j] >= tBound.b.y)
+                return true;
+        }
     }
     // ԽʱfalseֻееĵĻԽŷfalse
     return false;
@@ -388,11 +267,22 @@ bool GameObjectBentLaser::BoundCheck()LNOEXCEPT
 ////////////////////////////////////////////////////////////////////////////////
 bool GameObject::ChangeResource(const char* res_name)
 {
-    LASSERT(!res);
+    // ͼ񡢶ӹһȼһβ
+    Resource* tRes = LRES.FindImageResource(res_name);
+    if (!tRes)
+        return false;
+    return ChangeResource(tRes);
+}
+
+bool GameObject::ChangeResource(Resource* tRes)
+{
+    LASSERT(!res && tRes);
 
-    fcyRefPointer<ResSprite> tSprite = LRES.FindSprite(res_name);
-    if (tSprite)
+    switch (tRes->GetType())
     {
+    case ResourceType::Sprite:
+    {
+        ResSprite* tSprite = static_cast<ResSprite*>(tRes);
         res = tSprite;
         res->AddRef();
         a = tSprite->GetHalfSizeX() * LRES.GetGlobalImageScaleFactor();
@@ -401,10 +291,9 @@ bool GameObject::ChangeResource(const char* res_name)
         UpdateCollisionCirclrRadius();
         return true;
     }
-
-    fcyRefPointer<ResAnimation> tAnimation = LRES.FindAnimation(res_name);
-    if (tAnimation)
+    case ResourceType::Animation:
     {
+        ResAnimation* tAnimation = static_cast<ResAnimation*>(tRes);
         res = tAnimation;
         res->AddRef();
         a = tAnimation->GetHalfSizeX() * LRES.GetGlobalImageScaleFactor();
@@ -413,10 +302,9 @@ bool GameObject::ChangeResource(const char* res_name)
         UpdateCollisionCirclrRadius();
         return true;
     }
-
-    fcyRefPointer<ResParticle> tParticle = LRES.FindParticle(res_name);
-    if (tParticle)
+    case ResourceType::Particle:
     {
+        ResParticle* tParticle = static_cast<ResParticle*>(tRes);
         res = tParticle;
         if (!(ps = tParticle->AllocInstance()))
         {
@@ -424,6 +312,7 @@ bool GameObject::ChangeResource(const char* res_name)
             LERROR("޷ӳأڴ治");
             return false;
         }
+        ps->SetSeed((fuInt)(uid ^ (uid >> 32)) * 0x9E3779B1U);  // uid
         ps->SetInactive();
         ps->SetCenter(fcyVec2((float)x, (float)y));
         ps->SetRotation((float)rot);
@@ -436,8 +325,33 @@ bool GameObject::ChangeResource(const char* res_name)
         UpdateCollisionCirclrRadius();
         return true;
     }
+    default:
+        return false;
+    }
+}
 
-    return false;
+static bool ReadClassDefaultNumber(lua_State* L, int def, const char* key, lua_Number& out)
+{
+    lua_getfield(L, def, key);  // ... v
+    bool tRet = !lua_isnil(L, -1);
+    if (tRet)
+    {
+        if (!lua_isnumber(L, -1))
+            luaL_error(L, "invalid class default attribute '%s', number required.", key);
+        out = lua_tonumber(L, -1);
+    }
+    lua_pop(L, 1);  // ...
+    return tRet;
+}
+
+static bool ReadClassDefaultBoolean(lua_State* L, int def, const char* key, bool& out)
+{
+    lua_getfield(L, def, key);  // ... v
+    bool tRet = !lua_isnil(L, -1);
+    if (tRet)
+        out = lua_toboolean(L, -1) == 0 ? false : true;
+    lua_pop(L, 1);  // ...
+    return tRet;
 }
 
 GameObjectPool::GameObjectPool(lua_State* pL)
@@ -466,6 +380,16 @@ GameObjectPool::GameObjectPool(lua_State* pL)
         m_pCollisionListTail[i].pCollisionPrev = &m_pCollisionListHeader[i];
     }
 
+    // ! Ǳbad_allocAppFrame
+    m_ParticleUpdateList.reserve(LGOBJ_MAXCNT);
+    m_EventQueue.reserve(LGOBJ_MAXCNT);
+    m_FreeList.reserve(LGOBJ_MAXCNT);
+    m_PhaseResults.reserve(LGOBJ_MAXCNT);
+    m_CollisionListA.reserve(LGOBJ_MAXCNT);
+    m_CollisionListB.reserve(LGOBJ_MAXCNT);
+    memset(m_PhaseTimer, 0, sizeof(m_PhaseTimer));
+    memset(m_PhaseTimerLast, 0, sizeof(m_PhaseTimerLast));
+
     // һȫֱڴж
     lua_pushlightuserdata(L, (void*)&LAPP);  // p(ʹAPPʵָԷֹû)
     lua_createtable(L, LGOBJ_MAXCNT, 0);  // p t(㹻tableڴеϷluaеĶӦ)
@@ -490,6 +414,10 @@ GameObjectPool::GameObjectPool(lua_State* pL)
 GameObjectPool::~GameObjectPool()
 {
     ResetPool();
+    for (size_t i = 0; i < LGOBJ_SNAPSHOTCNT; ++i)
+        DropSnapshot(i);
+    for (int i : m_ClassStatsRefs)
+        luaL_unref(L, LUA_REGISTRYINDEX, i);
 }
 
 GameObject* GameObjectPool::freeObject(GameObject* p)LNOEXCEPT
@@ -520,8 +448,126 @@ GameObject* GameObjectPool::freeObject(GameObject* p)LNOEXCEPT
     return pRet;
 }
 
+template <typename Func>
+void GameObjectPool::parallelForEachObject(const char* zone, Func f)LNOEXCEPT
+{
+    // ʱضд򰴶زλֿ鲢д
+    if (m_ObjectPool.Size() < LGOBJ_PARALLELMINCNT)
+    {
+        PhaseResultBuffer tResults(m_PhaseResultLock, m_PhaseResults);
+        GameObject* p = m_pObjectListHeader.pObjectNext;
+        while (p && p != &m_pObjectListTail)
+        {
+            f(p, tResults);
+            p = p->pObjectNext;
+        }
+        return;
+    }
+
+    LAPP.GetWorkerPool().ParallelFor(LGOBJ_MAXCNT, LGOBJ_UPDATEGRAIN, [&](size_t begin, size_t end) {
+        LPROFILE_ZONE(zone);
+        PhaseResultBuffer tResults(m_PhaseResultLock, m_PhaseResults);
+        for (size_t i = begin; i < end; ++i)
+        {
+            GameObject* p = m_ObjectPool.Data(i);
+            if (p)
+                f(p, tResults);
+        }
+    });
+}
+
+void GameObjectPool::pushPhaseResultEvents(int callback)LNOEXCEPT
+{
+    // ռĽ˳򲻶봮бʱһ
+    sort(m_PhaseResults.begin(), m_PhaseResults.end(), PhaseResultSortFunc);
+    for (auto& i : m_PhaseResults)
+        pushEvent(callback, i.first, i.second, LUA_NOREF);
+    m_PhaseResults.clear();
+}
+
+GameObjectClassStats* GameObjectPool::getClassStats(int cls)LNOEXCEPT
+{
+    const void* tClass = lua_topointer(L, cls);
+    if (tClass == m_pLastStatsClass)
+        return m_pLastStats;
+
+    auto i = m_ClassStats.find(tClass);
+    if (i == m_ClassStats.end())
+    {
+        try
+        {
+            GameObjectClassStats tStats;
+            lua_pushliteral(L, "name");  // ... s
+            lua_rawget(L, cls);  // ... s(name)
+            if (lua_type(L, -1) == LUA_TSTRING)
+                tStats.name = lua_tostring(L, -1);
+            else
+            {
+                char tBuf[32];
+                sprintf_s(tBuf, "class@%p", tClass);
+                tStats.name = tBuf;
+            }
+            lua_pop(L, 1);  // ...
+            memset(tStats.time, 0, sizeof(tStats.time));
+            memset(tStats.calls, 0, sizeof(tStats.calls));
+
+            m_ClassStatsRefs.reserve(m_ClassStatsRefs.size() + 1);
+            i = m_ClassStats.emplace(tClass, std::move(tStats)).first;
+            lua_pushvalue(L, cls);  // ... t(class)
+            m_ClassStatsRefs.push_back(luaL_ref(L, LUA_REGISTRYINDEX));  // ...
+        }
+        catch (const bad_alloc&)
+        {
+            return nullptr;
+        }
+    }
+
+    // unordered_mapԪصַڲ󱣳ֲ
+    m_pLastStatsClass = tClass;
+    m_pLastStats = &i->second;
+    return m_pLastStats;
+}
+
+void GameObjectPool::callWithClassStats(GameObjectCallback callback, int cls, int nargs)
+{
+    if (cls < 0)
+        cls = lua_gettop(L) + cls + 1;
+    GameObjectClassStats* tStats = getClassStats(cls);
+
+    fcyStopWatch tStopWatch;
+    lua_call(L, nargs, 0);
+    if (tStats)
+    {
+        tStats->time[(size_t)callback] += tStopWatch.GetElapsed();
+        ++tStats->calls[(size_t)callback];
+    }
+}
+
+void GameObjectPool::ResetClassStats()LNOEXCEPT
+{
+    // ֻƳĿصеʱڼʱĿȻЧ
+    for (auto& i : m_ClassStats)
+    {
+        memset(i.second.time, 0, sizeof(i.second.time));
+        memset(i.second.calls, 0, sizeof(i.second.calls));
+    }
+}
+
+void GameObjectPool::BeginPhaseTimer()LNOEXCEPT
+{
+    memcpy(m_PhaseTimerLast, m_PhaseTimer, sizeof(m_PhaseTimer));
+    memset(m_PhaseTimer, 0, sizeof(m_PhaseTimer));
+}
+
 void GameObjectPool::DoFrame()LNOEXCEPT
 {
+    // ObjFrameʱȸһռϵͳ
+    UpdateParticles();
+
+    LPROFILE_ZONE("DoFrame");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::Frame]);
+    SamplerContext tSamplerContext(LAPP.GetLuaSampler(), "ObjFrame");
+
     GETOBJTABLE;  // ot
     
     GameObject* p = m_pObjectListHeader.pObjectNext;
@@ -532,7 +578,10 @@ void GameObjectPool::DoFrame()LNOEXCEPT
         lua_rawgeti(L, -1, 1);  // ot t(object) t(class)
         lua_rawgeti(L, -1, LGOBJ_CC_FRAME);  // ot t(object) t(class) f(frame)
         lua_pushvalue(L, -3);  // ot t(object) t(class) f(frame) t(object)
-        lua_call(L, 1, 0);  // ot t(object) t(class) ִ֡
+        if (m_bClassStats)
+            callWithClassStats(GameObjectCallback::Frame, -3, 1);  // ot t(object) t(class)
+        else
+            lua_call(L, 1, 0);  // ot t(object) t(class) ִ֡
         lua_pop(L, 2);  // ot
 
         // ¶״̬
@@ -555,17 +604,100 @@ void GameObjectPool::DoFrame()LNOEXCEPT
             }
             else
                 p->ps->SetCenter(fcyVec2((float)p->x, (float)p->y));
-            p->ps->Update(1.0f / 60.f);
+            m_ParticleUpdateList.push_back(p);
         }
 
         p = p->pObjectNext;
     }
 
     lua_pop(L, 1);
+
+    m_bParticleUpdatePending = true;
+}
+
+void GameObjectPool::applyParticleBudget()LNOEXCEPT
+{
+    m_iParticleThrottled = 0;
+
+    size_t tTotal = 0;
+    for (GameObject* p : m_ParticleUpdateList)
+        tTotal += p->ps->GetAliveCount();
+
+    if (m_iParticleBudget == 0 || tTotal <= m_iParticleBudget)
+    {
+        for (GameObject* p : m_ParticleUpdateList)
+            p->ps->SetEmissionScale(1.f);
+        return;
+    }
+
+    // Ԥʱȼ䣺ͼߵĶȣͬͼʱȴĶ
+    // Ԥ֮ӳֹͣӣճֱ
+    sort(m_ParticleUpdateList.begin(), m_ParticleUpdateList.end(), [](GameObject* a, GameObject* b) {
+        return (a->layer > b->layer) || ((a->layer == b->layer) && (a->uid < b->uid));
+    });
+
+    size_t tUsed = 0;
+    for (GameObject* p : m_ParticleUpdateList)
+    {
+        size_t tAlive = p->ps->GetAliveCount();
+        float tScale;
+        if (tUsed + tAlive <= m_iParticleBudget)
+            tScale = 1.f;
+        else if (tUsed < m_iParticleBudget)
+            tScale = (float)(m_iParticleBudget - tUsed) / (float)tAlive;
+        else
+            tScale = 0.f;
+        tUsed += tAlive;
+
+        if (tScale < 1.f)
+            ++m_iParticleThrottled;
+        p->ps->SetEmissionScale(tScale);
+    }
+}
+
+void GameObjectPool::UpdateParticles()LNOEXCEPT
+{
+    if (!m_bParticleUpdatePending)
+        return;
+    m_bParticleUpdatePending = false;
+
+    LPROFILE_ZONE("UpdateParticles");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::Particle]);
+
+    // ֡пͷŻ˶ԴҪ¼
+    size_t j = 0;
+    for (size_t i = 0; i < m_ParticleUpdateList.size(); ++i)
+    {
+        GameObject* p = m_ParticleUpdateList[i];
+        if (p->res && p->res->GetType() == ResourceType::Particle)
+            m_ParticleUpdateList[j++] = p;
+    }
+    m_ParticleUpdateList.resize(j);
+
+    applyParticleBudget();
+
+    // иʱܷڴ棬Ԥ߳ΪҪӵӳ
+    for (GameObject* p : m_ParticleUpdateList)
+        p->ps->ReserveForUpdate(1.0f / 60.f);
+
+    // ӳسжһʣԲи£߳޹
+    LAPP.GetWorkerPool().ParallelFor(m_ParticleUpdateList.size(), LPARTICLE_UPDATEGRAIN, [this](size_t begin, size_t end) {
+        LPROFILE_ZONE("UpdateParticles.Chunk");
+        for (size_t i = begin; i < end; ++i)
+            m_ParticleUpdateList[i]->ps->Update(1.0f / 60.f);
+    });
+
+    m_iParticleTotal = 0;
+    for (GameObject* p : m_ParticleUpdateList)
+        m_iParticleTotal += p->ps->GetAliveCount();
+    m_ParticleUpdateList.clear();
 }
 
 void GameObjectPool::DoRender()LNOEXCEPT
 {
+    LPROFILE_ZONE("DoRender");
+    SamplerContext tSamplerContext(LAPP.GetLuaSampler(), "ObjRender");
+
     GETOBJTABLE;  // ot
 
     GameObject* p = m_pRenderListHeader.pRenderNext;
@@ -579,7 +711,10 @@ void GameObjectPool::DoRender()LNOEXCEPT
             lua_rawgeti(L, -1, 1);  // ot t(object) t(class)
             lua_rawgeti(L, -1, LGOBJ_CC_RENDER);  // ot t(object) t(class) f(render)
             lua_pushvalue(L, -3);  // ot t(object) t(class) f(render) t(object)
-            lua_call(L, 1, 0);  // ot t(object) t(class) ִȾ
+            if (m_bClassStats)
+                callWithClassStats(GameObjectCallback::Render, -3, 1);  // ot t(object) t(class)
+            else
+                lua_call(L, 1, 0);  // ot t(object) t(class) ִȾ
             lua_pop(L, 2);  // ot
         }
         p = p->pRenderNext;
@@ -590,6 +725,24 @@ void GameObjectPool::DoRender()LNOEXCEPT
 
 void GameObjectPool::BoundCheck()LNOEXCEPT
 {
+    LPROFILE_ZONE("BoundCheck");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::BoundCheck]);
+
+    if (m_bDeferEvents)
+    {
+        // ֻ¼¼lua˸Բм
+        parallelForEachObject("BoundCheck.Chunk", [this](GameObject* p, PhaseResultBuffer& results) {
+            if ((p->x < m_BoundLeft || p->x > m_BoundRight || p->y < m_BoundBottom || p->y > m_BoundTop) && p->bound)
+            {
+                p->status = STATUS_DEL;
+                results.Push(p, nullptr);
+            }
+        });
+        pushPhaseResultEvents(LGOBJ_CC_DEL);
+        return;
+    }
+
+    SamplerContext tSamplerContext(LAPP.GetLuaSampler(), "ObjDel");
     GETOBJTABLE;  // ot
 
     GameObject* p = m_pObjectListHeader.pObjectNext;
@@ -619,12 +772,47 @@ void GameObjectPool::CollisionCheck(size_t groupA, size_t groupB)LNOEXCEPT
     if (groupA >= LGOBJ_MAXCNT || groupB >= LGOBJ_MAXCNT)
         luaL_error(L, "Invalid collision group.");
 
-    GETOBJTABLE;  // ot
+    LPROFILE_ZONE("CollisionCheck");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::CollisionCheck]);
 
     GameObject* pA = m_pCollisionListHeader[groupA].pCollisionNext;
     GameObject* pATail = &m_pCollisionListTail[groupA];
     GameObject* pBHeader = m_pCollisionListHeader[groupB].pCollisionNext;
     GameObject* pBTail = &m_pCollisionListTail[groupB];
+
+    if (m_bDeferEvents)
+    {
+        // ֻ¼¼lua˿ԽжԷֿ鲢м
+        m_CollisionListA.clear();
+        for (; pA && pA != pATail; pA = pA->pCollisionNext)
+            m_CollisionListA.push_back(pA);
+        m_CollisionListB.clear();
+        for (GameObject* pB = pBHeader; pB && pB != pBTail; pB = pB->pCollisionNext)
+            m_CollisionListB.push_back(pB);
+
+        size_t tCountB = m_CollisionListB.size();
+        LAPP.GetWorkerPool().ParallelFor(m_CollisionListA.size() * tCountB, LGOBJ_COLLIGRAIN, [&](size_t begin, size_t end) {
+            LPROFILE_ZONE("CollisionCheck.Chunk");
+            PhaseResultBuffer tResults(m_PhaseResultLock, m_PhaseResults);
+            size_t a = begin / tCountB, b = begin % tCountB;
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (::CollisionCheck(m_CollisionListA[a], m_CollisionListB[b]))
+                    tResults.Push(m_CollisionListA[a], m_CollisionListB[b]);
+                if (++b == tCountB)
+                {
+                    b = 0;
+                    ++a;
+                }
+            }
+        });
+        pushPhaseResultEvents(LGOBJ_CC_COLLI);
+        return;
+    }
+
+    SamplerContext tSamplerContext(LAPP.GetLuaSampler(), "ObjColli");
+    GETOBJTABLE;  // ot
+
     while (pA && pA != pATail)
     {
         GameObject* pB = pBHeader;
@@ -638,7 +826,10 @@ void GameObjectPool::CollisionCheck(size_t groupA, size_t groupB)LNOEXCEPT
                 lua_rawgeti(L, -1, LGOBJ_CC_COLLI);  // ot t(object) t(class) f(colli)
                 lua_pushvalue(L, -3);  // ot t(object) t(class) f(colli) t(object)
                 lua_rawgeti(L, -5, pB->id + 1);  // ot t(object) t(class) f(colli) t(object) t(object)
-                lua_call(L, 2, 0);  // ot t(object) t(class)
+                if (m_bClassStats)
+                    callWithClassStats(GameObjectCallback::Colli, -4, 2);  // ot t(object) t(class)
+                else
+                    lua_call(L, 2, 0);  // ot t(object) t(class)
                 lua_pop(L, 2);  // ot
             }
             pB = pB->pCollisionNext;
@@ -651,32 +842,326 @@ void GameObjectPool::CollisionCheck(size_t groupA, size_t groupB)LNOEXCEPT
 
 void GameObjectPool::UpdateXY()LNOEXCEPT
 {
-    GameObject* p = m_pObjectListHeader.pObjectNext;
-    while (p && p != &m_pObjectListTail)
-    {
+    LPROFILE_ZONE("UpdateXY");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::UpdateXY]);
+
+    // ĸ»Ӱ
+    parallelForEachObject("UpdateXY.Chunk", [](GameObject* p, PhaseResultBuffer&) {
         p->dx = p->x - p->lastx;
         p->dy = p->y - p->lasty;
         p->lastx = p->x;
         p->lasty = p->y;
         if (p->navi && (p->dx != 0 || p->dy != 0))
             p->rot = atan2(p->dy, p->dx);
+    });
+}
 
-        p = p->pObjectNext;
+void GameObjectPool::pushEvent(int callback, GameObject* pA, GameObject* pB, int args)
+{
+    DeferredEvent tEvent;
+    tEvent.callback = callback;
+    tEvent.idA = pA->id;
+    tEvent.uidA = pA->uid;
+    tEvent.idB = pB ? pB->id : 0;
+    tEvent.uidB = pB ? pB->uid : 0;
+    tEvent.args = args;
+    m_EventQueue.push_back(tEvent);
+}
+
+void GameObjectPool::clearEvents()LNOEXCEPT
+{
+    for (size_t i = m_iEventCursor; i < m_EventQueue.size(); ++i)
+        luaL_unref(L, LUA_REGISTRYINDEX, m_EventQueue[i].args);
+    m_EventQueue.clear();
+    m_iEventCursor = 0;
+}
+
+size_t GameObjectPool::DispatchEvents()LNOEXCEPT
+{
+    LPROFILE_ZONE("DispatchEvents");
+    SamplerContext tSamplerContext(LAPP.GetLuaSampler(), "ObjEvent");
+
+    size_t tCount = 0;
+
+    GETOBJTABLE;  // ot
+
+    // صпܲµ¼ʹݣÿΰ±긴Ƴ¼
+    // αڵǰƽصʱظɷ
+    while (m_iEventCursor < m_EventQueue.size())
+    {
+        DeferredEvent tEvent = m_EventQueue[m_iEventCursor++];
+
+        GameObject* pA = m_ObjectPool.Data(tEvent.idA);
+        GameObject* pB = tEvent.callback == LGOBJ_CC_COLLI ? m_ObjectPool.Data(tEvent.idB) : nullptr;
+        if (!pA || pA->uid != tEvent.uidA || (tEvent.callback == LGOBJ_CC_COLLI && (!pB || pB->uid != tEvent.uidB)))
+        {
+            luaL_unref(L, LUA_REGISTRYINDEX, tEvent.args);
+            continue;
+        }
+
+        // idȡluatableõclassõص
+        int tTop = lua_gettop(L);  // ot
+        lua_rawgeti(L, -1, tEvent.idA + 1);  // ot t(object)
+        lua_rawgeti(L, -1, 1);  // ot t(object) t(class)
+        lua_rawgeti(L, -1, tEvent.callback);  // ot t(object) t(class) f(callback)
+        lua_pushvalue(L, -3);  // ot t(object) t(class) f(callback) t(object)
+        if (tEvent.callback == LGOBJ_CC_COLLI)
+            lua_rawgeti(L, tTop, tEvent.idB + 1);  // ot t(object) t(class) f(colli) t(object) t(object)
+        else if (tEvent.args != LUA_NOREF)
+        {
+            // չӲ
+            lua_rawgeti(L, LUA_REGISTRYINDEX, tEvent.args);  // ot t(object) t(class) f(callback) t(object) t(args)
+            luaL_unref(L, LUA_REGISTRYINDEX, tEvent.args);
+            lua_getfield(L, -1, "n");  // ot t(object) t(class) f(callback) t(object) t(args) n
+            int tArgc = (int)lua_tointeger(L, -1);
+            lua_pop(L, 1);  // ot t(object) t(class) f(callback) t(object) t(args)
+            luaL_checkstack(L, tArgc, "too many arguments");
+            for (int i = 1; i <= tArgc; ++i)
+                lua_rawgeti(L, tTop + 5, i);  // ot t(object) t(class) f(callback) t(object) t(args) ...
+            lua_remove(L, tTop + 5);  // ot t(object) t(class) f(callback) t(object) ...
+        }
+        if (m_bClassStats && tEvent.callback == LGOBJ_CC_COLLI)
+            callWithClassStats(GameObjectCallback::Colli, tTop + 2, 2);  // ot t(object) t(class)
+        else
+            lua_call(L, lua_gettop(L) - tTop - 3, 0);  // ot t(object) t(class)
+        lua_pop(L, 2);  // ot
+        ++tCount;
     }
+
+    lua_pop(L, 1);
+
+    m_EventQueue.clear();
+    m_iEventCursor = 0;
+    return tCount;
 }
 
 void GameObjectPool::AfterFrame()LNOEXCEPT
 {
+    // űûеUpdateParticlesʱڴ˲беĶܱ
+    UpdateParticles();
+
+    LPROFILE_ZONE("AfterFrame");
+    AccumulatedTimerScope tTimer(m_PhaseTimer[(size_t)GameObjectPoolPhase::AfterFrame]);
+
+    // ִδɷ¼֤صڶ󱻻ǰ
+    if (!m_EventQueue.empty())
+        DispatchEvents();
+
+    // ¼ʱͬʱӶժɾĶ
     GameObject* p = m_pObjectListHeader.pObjectNext;
     while (p && p != &m_pObjectListTail)
     {
         p->timer++;
         p->ani_timer++;
+        GameObject* pNext = p->pObjectNext;
         if (p->status != STATUS_DEFAULT)
-            p = freeObject(p);
-        else
-            p = p->pObjectNext;
+        {
+            LIST_REMOVE(p, Object);
+            m_FreeList.push_back(p);
+        }
+        p = pNext;
+    }
+
+    if (!m_FreeList.empty())
+        freeObjects();
+}
+
+void GameObjectPool::freeObjects()LNOEXCEPT
+{
+    // ȾײƳ
+    // ɾ϶ʱɨֻ˳һժ
+    if (m_FreeList.size() * LGOBJ_SWEEPRATIO > m_ObjectPool.Size())
+    {
+        // ųΧĶκײ
+        uint32_t tGroups = 0;
+        for (GameObject* p : m_FreeList)
+        {
+            if (0 <= p->group && p->group < LGOBJ_GROUPCNT)
+                tGroups |= 1u << p->group;
+        }
+
+        LIST_SWEEP(&m_pRenderListHeader, &m_pRenderListTail, Render);
+        for (size_t i = 0; i < LGOBJ_GROUPCNT; ++i)
+        {
+            if (tGroups & (1u << i))
+                LIST_SWEEP(&m_pCollisionListHeader[i], &m_pCollisionListTail[i], Collision);
+        }
+    }
+    else
+    {
+        for (GameObject* p : m_FreeList)
+        {
+            LIST_REMOVE(p, Render);
+            LIST_REMOVE(p, Collision);
+        }
+    }
+
+    // ɾluaԪ
+    GETOBJTABLE;  // ot
+    for (GameObject* p : m_FreeList)
+    {
+        lua_pushnil(L);  // ot nil
+        lua_rawseti(L, -2, p->id + 1);  // ot
+    }
+    lua_pop(L, 1);
+
+    // ͷõԴյ
+    for (GameObject* p : m_FreeList)
+    {
+        p->ReleaseResource();
+        m_ObjectPool.Free(p->id);
+    }
+
+    m_FreeList.clear();
+}
+
+void GameObjectPool::readClassDefault(lua_State* L, int def, ClassDefault& out)
+{
+    // ͼջûʱΪnil
+    memset(&out, 0, sizeof(out));
+    out.source = lua_topointer(L, def);
+
+    lua_getfield(L, def, "img");  // ... s(img)
+    if (!lua_isnil(L, -1))
+    {
+        if (lua_type(L, -1) != LUA_TSTRING)
+            luaL_error(L, "invalid class default attribute 'img', string required.");
+        out.mask |= ClassDefault::HasImage;
+    }
+
+    if (ReadClassDefaultNumber(L, def, "layer", out.layer))
+        out.mask |= ClassDefault::HasLayer;
+    lua_Number tGroup = 0;
+    if (ReadClassDefaultNumber(L, def, "group", tGroup))
+    {
+        // ڲײǰȷײ飬˲Խ
+        out.group = static_cast<lua_Integer>(tGroup);
+        if (out.group < 0 || out.group >= LGOBJ_GROUPCNT)
+            luaL_error(L, "invalid class default attribute 'group', out of range.");
+        out.mask |= ClassDefault::HasGroup;
+    }
+    if (ReadClassDefaultNumber(L, def, "a", out.a))
+        out.mask |= ClassDefault::HasA;
+    if (ReadClassDefaultNumber(L, def, "b", out.b))
+        out.mask |= ClassDefault::HasB;
+    if (ReadClassDefaultBoolean(L, def, "rect", out.rect))
+        out.mask |= ClassDefault::HasRect;
+    if (ReadClassDefaultBoolean(L, def, "bound", out.bound))
+        out.mask |= ClassDefault::HasBound;
+    if (ReadClassDefaultBoolean(L, def, "colli", out.colli))
+        out.mask |= ClassDefault::HasColli;
+    if (ReadClassDefaultBoolean(L, def, "navi", out.navi))
+        out.mask |= ClassDefault::HasNavi;
+    if (ReadClassDefaultBoolean(L, def, "hide", out.hide))
+        out.mask |= ClassDefault::HasHide;
+    if (ReadClassDefaultNumber(L, def, "hscale", out.hscale))
+        out.mask |= ClassDefault::HasHScale;
+    if (ReadClassDefaultNumber(L, def, "vscale", out.vscale))
+        out.mask |= ClassDefault::HasVScale;
+}
+
+bool GameObjectPool::sameClassDefault(const ClassDefault& a, const char* aName, const ClassDefault& b, const char* bName)LNOEXCEPT
+{
+    // ֻȽdefaultиԣδԱΪ0
+    return a.mask == b.mask && strcmp(aName, bName) == 0 &&
+        a.layer == b.layer && a.a == b.a && a.b == b.b && a.hscale == b.hscale && a.vscale == b.vscale &&
+        a.group == b.group && a.rect == b.rect && a.bound == b.bound && a.colli == b.colli && a.navi == b.navi && a.hide == b.hide;
+}
+
+GameObjectPool::ClassDefault* GameObjectPool::buildClassDefault(lua_State* L, int cls, int def)
+{
+    // ȶʱṹʱ²Ļ
+    ClassDefault tDefault;
+    readClassDefault(L, def, tDefault);  // ... s(img)
+    size_t tNameLen = 0;
+    const char* tName = tDefault.mask & ClassDefault::HasImage ? lua_tolstring(L, -1, &tNameLen) : "";
+
+    ClassDefault* d = static_cast<ClassDefault*>(lua_newuserdata(L, sizeof(ClassDefault) + tNameLen + 1));  // ... s(img) u
+    memcpy(d, &tDefault, sizeof(ClassDefault));
+    memcpy(d + 1, tName, tNameLen + 1);
+    lua_rawseti(L, cls, LGOBJ_CC_DEFAULT);  // ... s(img)
+    lua_pop(L, 1);  // ...
+    return d;
+}
+
+GameObjectPool::ClassDefault* GameObjectPool::getClassDefault(lua_State* L, int cls)
+{
+    lua_pushliteral(L, "default");  // ... s
+    lua_rawget(L, cls);  // ... t(default)
+    if (lua_isnil(L, -1))
+    {
+        lua_pop(L, 1);  // ...
+        return nullptr;
     }
+    if (!lua_istable(L, -1))
+        luaL_error(L, "invalid class default attributes, table required.");
+
+    // defaultһһӦdefault滻(̳ʱ˸Ļ)
+    // ͵޸ı޷Ե¶Ĵۼ⣬˻ɺ󶳽ᣬ԰汾У
+    ClassDefault* d = nullptr;
+    lua_rawgeti(L, cls, LGOBJ_CC_DEFAULT);  // ... t(default) u
+    if (lua_type(L, -1) == LUA_TUSERDATA)
+        d = static_cast<ClassDefault*>(lua_touserdata(L, -1));
+    lua_pop(L, 1);  // ... t(default)
+    if (!d || d->source != lua_topointer(L, -1))
+        d = buildClassDefault(L, cls, lua_gettop(L));
+#ifdef LDEBUG
+    else
+    {
+        ClassDefault tCurrent;
+        readClassDefault(L, lua_gettop(L), tCurrent);  // ... t(default) s(img)
+        const char* tName = tCurrent.mask & ClassDefault::HasImage ? lua_tostring(L, -1) : "";
+        if (!sameClassDefault(*d, d->GetImageName(), tCurrent, tName))
+            luaL_error(L, "class default attributes were modified in place after the first object was created, "
+                "assign a new table to class.default instead.");
+        lua_pop(L, 1);  // ... t(default)
+    }
+#endif
+    lua_pop(L, 1);  // ...
+
+    // ͼԴҹChangeResource(const char*)һ
+    // κԴضıԴصĹؿԴڱǰ鵽ȫԴ
+    if ((d->mask & ClassDefault::HasImage) && (!d->res || d->resGeneration != LRES.GetResourceGeneration()))
+    {
+        d->res = LRES.FindImageResource(d->GetImageName());
+        d->resGeneration = LRES.GetResourceGeneration();
+        if (!d->res)
+            luaL_error(L, "can't find resource '%s' in image/animation/particle pool.", d->GetImageName());
+    }
+    return d;
+}
+
+bool GameObjectPool::applyClassDefault(GameObject* p, ClassDefault* d)LNOEXCEPT
+{
+    if (d->mask & ClassDefault::HasLayer)
+        p->layer = d->layer;
+    if (d->mask & ClassDefault::HasGroup)
+        p->group = d->group;
+    if (d->mask & ClassDefault::HasBound)
+        p->bound = d->bound;
+    if (d->mask & ClassDefault::HasColli)
+        p->colli = d->colli;
+    if (d->mask & ClassDefault::HasNavi)
+        p->navi = d->navi;
+    if (d->mask & ClassDefault::HasHide)
+        p->hide = d->hide;
+    if (d->mask & ClassDefault::HasHScale)
+        p->hscale = d->hscale;
+    if (d->mask & ClassDefault::HasVScale)
+        p->vscale = d->vscale;
+
+    // initimgabrectЧͬ
+    if ((d->mask & ClassDefault::HasImage) && !p->ChangeResource(d->res))
+        return false;
+    if (d->mask & ClassDefault::HasA)
+        p->a = d->a * LRES.GetGlobalImageScaleFactor();
+    if (d->mask & ClassDefault::HasB)
+        p->b = d->b * LRES.GetGlobalImageScaleFactor();
+    if (d->mask & ClassDefault::HasRect)
+        p->rect = d->rect;
+    if (d->mask & (ClassDefault::HasA | ClassDefault::HasB | ClassDefault::HasRect))
+        p->UpdateCollisionCirclrRadius();
+    return true;
 }
 
 int GameObjectPool::New(lua_State* L)LNOEXCEPT
@@ -689,6 +1174,9 @@ int GameObjectPool::New(lua_State* L)LNOEXCEPT
         return luaL_error(L, "invalid argument #1, luastg object class required for 'New'.");
     lua_pop(L, 1);  // t(class) ...
 
+    // ȡĬԣڷǰʱй©
+    ClassDefault* tDefault = getClassDefault(L, 1);
+
     // һ
     size_t id = 0;
     if (!m_ObjectPool.Alloc(id))
@@ -702,6 +1190,13 @@ int GameObjectPool::New(lua_State* L)LNOEXCEPT
     p->id = id;
     p->uid = m_iUid++;
 
+    // ڲǰӦĬԣͼײһź
+    if (tDefault && !applyClassDefault(p, tDefault))
+    {
+        m_ObjectPool.Free(id);
+        return luaL_error(L, "can't apply default attributes of class, out of memory.");
+    }
+
     // 
     LIST_INSERT_BEFORE(&m_pObjectListTail, p, Object);  // Objectֻuidйأĩβ
     LIST_INSERT_BEFORE(&m_pRenderListTail, p, Render);  // RenderڲҪ
@@ -747,6 +1242,27 @@ int GameObjectPool::Del(lua_State* L)LNOEXCEPT
     {
         p->status = STATUS_DEL;
 
+        if (m_bDeferEvents)
+        {
+            // Ӳעɷʱչ
+            int tArgs = LUA_NOREF;
+            int tArgc = lua_gettop(L) - 1;
+            if (tArgc > 0)
+            {
+                lua_createtable(L, tArgc, 1);  // t(object) ... t
+                for (int i = 1; i <= tArgc; ++i)
+                {
+                    lua_pushvalue(L, i + 1);  // t(object) ... t v
+                    lua_rawseti(L, -2, i);  // t(object) ... t
+                }
+                lua_pushinteger(L, tArgc);  // t(object) ... t n
+                lua_setfield(L, -2, "n");  // t(object) ... t(Ӳܺnil¼)
+                tArgs = luaL_ref(L, LUA_REGISTRYINDEX);  // t(object) ...
+            }
+            pushEvent(LGOBJ_CC_DEL, p, nullptr, tArgs);
+            return 0;
+        }
+
         // еĻص
         lua_rawgeti(L, 1, 1);  // t(object) ... class
         lua_rawgeti(L, -1, LGOBJ_CC_DEL);  // t(object) ... class f(del)
@@ -771,6 +1287,27 @@ int GameObjectPool::Kill(lua_State* L)LNOEXCEPT
     {
         p->status = STATUS_KILL;
 
+        if (m_bDeferEvents)
+        {
+            // Ӳעɷʱչ
+            int tArgs = LUA_NOREF;
+            int tArgc = lua_gettop(L) - 1;
+            if (tArgc > 0)
+            {
+                lua_createtable(L, tArgc, 1);  // t(object) ... t
+                for (int i = 1; i <= tArgc; ++i)
+                {
+                    lua_pushvalue(L, i + 1);  // t(object) ... t v
+                    lua_rawseti(L, -2, i);  // t(object) ... t
+                }
+                lua_pushinteger(L, tArgc);  // t(object) ... t n
+                lua_setfield(L, -2, "n");  // t(object) ... t(Ӳܺnil¼)
+                tArgs = luaL_ref(L, LUA_REGISTRYINDEX);  // t(object) ...
+            }
+            pushEvent(LGOBJ_CC_KILL, p, nullptr, tArgs);
+            return 0;
+        }
+
         // еĻص
         lua_rawgeti(L, 1, 1);  // t(object) ... class
         lua_rawgeti(L, -1, LGOBJ_CC_KILL);  // t(object) ... class f(kill)
@@ -871,14 +1408,18 @@ bool GameObjectPool::SetImgState(size_t id, BlendMode m, fcyColor c)LNOEXCEPT
         {
         case ResourceType::Sprite:
             static_cast<ResSprite*>(p->res)->SetBlendMode(m);
-            static_cast<ResSprite*>(p->res)->GetSprite()->SetColor(c);
+            if (!LAPP.IsHeadless())
+                static_cast<ResSprite*>(p->res)->GetSprite()->SetColor(c);
             break;
         case ResourceType::Animation:
             do {
                 ResAnimation* ani = static_cast<ResAnimation*>(p->res);
                 ani->SetBlendMode(m);
-                for (size_t i = 0; i < ani->GetCount(); ++i)
-                    ani->GetSprite(i)->SetColor(c);
+                if (!LAPP.IsHeadless())
+                {
+                    for (size_t i = 0; i < ani->GetCount(); ++i)
+                        ani->GetSprite(i)->SetColor(c);
+                }
             } while (false);
             break;
         default:
@@ -899,11 +1440,375 @@ bool GameObjectPool::BoxCheck(size_t id, double left, double right, double top,
 
 void GameObjectPool::ResetPool()LNOEXCEPT
 {
+    clearEvents();
+    m_ParticleUpdateList.clear();
+    m_bParticleUpdatePending = false;
+
     GameObject* p = m_pObjectListHeader.pObjectNext;
     while (p != &m_pObjectListTail)
         p = freeObject(p);
 }
 
+// ָ뻻Ϊ±꣬ʹidαͷαβж֮
+enum
+{
+    SNAPSHOT_OBJECTHEADER = LGOBJ_MAXCNT,
+    SNAPSHOT_OBJECTTAIL,
+    SNAPSHOT_RENDERHEADER,
+    SNAPSHOT_RENDERTAIL,
+    SNAPSHOT_COLLISIONHEADER,
+    SNAPSHOT_COLLISIONTAIL = SNAPSHOT_COLLISIONHEADER + LGOBJ_GROUPCNT
+};
+
+// ͷ
+struct PoolSnapshotHeader
+{
+    uint64_t uid;
+    size_t freeCount;
+    size_t objectCount;
+    size_t laserCount;
+    size_t listLinks[(2 + LGOBJ_GROUPCNT) * 2];  // Ϊαͷĺαβǰ
+    lua_Number bound[4];
+};
+
+// ¼
+struct ObjectSnapshotLinks
+{
+    size_t objectPrev, objectNext;
+    size_t renderPrev, renderNext;
+    size_t collisionPrev, collisionNext;
+};
+
+// ߼¼ͷ״̬
+struct LaserSnapshotHeader
+{
+    uint64_t instanceId;
+    size_t size;
+};
+
+size_t GameObjectPool::linkToIndex(GameObject* p)LNOEXCEPT
+{
+    if (p == &m_pObjectListHeader)
+        return SNAPSHOT_OBJECTHEADER;
+    if (p == &m_pObjectListTail)
+        return SNAPSHOT_OBJECTTAIL;
+    if (p == &m_pRenderListHeader)
+        return SNAPSHOT_RENDERHEADER;
+    if (p == &m_pRenderListTail)
+        return SNAPSHOT_RENDERTAIL;
+    if (p >= m_pCollisionListHeader && p < m_pCollisionListHeader + LGOBJ_GROUPCNT)
+        return SNAPSHOT_COLLISIONHEADER + (p - m_pCollisionListHeader);
+    if (p >= m_pCollisionListTail && p < m_pCollisionListTail + LGOBJ_GROUPCNT)
+        return SNAPSHOT_COLLISIONTAIL + (p - m_pCollisionListTail);
+    return p->id;
+}
+
+GameObject* GameObjectPool::indexToLink(size_t i)LNOEXCEPT
+{
+    if (i < LGOBJ_MAXCNT)
+        return m_ObjectPool.Data(i);
+    if (i == SNAPSHOT_OBJECTHEADER)
+        return &m_pObjectListHeader;
+    if (i == SNAPSHOT_OBJECTTAIL)
+        return &m_pObjectListTail;
+    if (i == SNAPSHOT_RENDERHEADER)
+        return &m_pRenderListHeader;
+    if (i == SNAPSHOT_RENDERTAIL)
+        return &m_pRenderListTail;
+    if (i < SNAPSHOT_COLLISIONTAIL)
+        return &m_pCollisionListHeader[i - SNAPSHOT_COLLISIONHEADER];
+    LASSERT(i < SNAPSHOT_COLLISIONTAIL + LGOBJ_GROUPCNT);
+    return &m_pCollisionListTail[i - SNAPSHOT_COLLISIONTAIL];
+}
+
+bool GameObjectPool::SaveSnapshot(size_t slot)LNOEXCEPT
+{
+    LASSERT(slot < LGOBJ_SNAPSHOTCNT);
+    Snapshot& tSnapshot = m_Snapshots[slot];
+
+    // ͳռ䣬һԷ
+    const vector<size_t>& tFreeIndex = m_ObjectPool.GetFreeIndex();
+    PoolSnapshotHeader tHeader;
+    tHeader.uid = m_iUid;
+    tHeader.freeCount = tFreeIndex.size();
+    tHeader.objectCount = 0;
+    tHeader.laserCount = 0;
+    size_t tParticleSize = 0;
+    for (GameObject* p = m_pObjectListHeader.pObjectNext; p != &m_pObjectListTail; p = p->pObjectNext)
+    {
+        ++tHeader.objectCount;
+        if (p->ps)
+            tParticleSize += p->ps->GetStateSize();
+    }
+    LASSERT(tHeader.objectCount == m_ObjectPool.Size());
+    size_t tLaserSize = 0;
+    for (GameObjectBentLaser* p = GameObjectBentLaser::GetFirstInstance(); p; p = p->GetNextInstance())
+    {
+        ++tHeader.laserCount;
+        tLaserSize += sizeof(LaserSnapshotHeader) + p->GetStateSize();
+    }
+
+    try
+    {
+        tSnapshot.data.resize(sizeof(PoolSnapshotHeader) + tHeader.freeCount * sizeof(size_t) +
+            tHeader.objectCount * (sizeof(GameObject) + sizeof(ObjectSnapshotLinks)) + tParticleSize + tLaserSize);
+        tSnapshot.resources.clear();
+
+        // αͷαβ
+        size_t* pLinks = tHeader.listLinks;
+        *pLinks++ = linkToIndex(m_pObjectListHeader.pObjectNext);
+        *pLinks++ = linkToIndex(m_pObjectListTail.pObjectPrev);
+        *pLinks++ = linkToIndex(m_pRenderListHeader.pRenderNext);
+        *pLinks++ = linkToIndex(m_pRenderListTail.pRenderPrev);
+        for (size_t i = 0; i < LGOBJ_GROUPCNT; ++i)
+        {
+            *pLinks++ = linkToIndex(m_pCollisionListHeader[i].pCollisionNext);
+            *pLinks++ = linkToIndex(m_pCollisionListTail[i].pCollisionPrev);
+        }
+        tHeader.bound[0] = m_BoundLeft;
+        tHeader.bound[1] = m_BoundRight;
+        tHeader.bound[2] = m_BoundTop;
+        tHeader.bound[3] = m_BoundBottom;
+
+        fByte* pCursor = tSnapshot.data.data();
+        memcpy(pCursor, &tHeader, sizeof(tHeader));
+        pCursor += sizeof(tHeader);
+        memcpy(pCursor, tFreeIndex.data(), tHeader.freeCount * sizeof(size_t));
+        pCursor += tHeader.freeCount * sizeof(size_t);
+
+        // 󰴶˳дӳ״̬ͬ˳дж֮
+        fByte* pParticleCursor = pCursor + tHeader.objectCount * (sizeof(GameObject) + sizeof(ObjectSnapshotLinks));
+        Resource* pLastRes = nullptr;
+        for (GameObject* p = m_pObjectListHeader.pObjectNext; p != &m_pObjectListTail; p = p->pObjectNext)
+        {
+            ObjectSnapshotLinks tLinks;
+            tLinks.objectPrev = linkToIndex(p->pObjectPrev);
+            tLinks.objectNext = linkToIndex(p->pObjectNext);
+            tLinks.renderPrev = linkToIndex(p->pRenderPrev);
+            tLinks.renderNext = linkToIndex(p->pRenderNext);
+            tLinks.collisionPrev = linkToIndex(p->pCollisionPrev);
+            tLinks.collisionNext = linkToIndex(p->pCollisionNext);
+            memcpy(pCursor, p, sizeof(GameObject));
+            pCursor += sizeof(GameObject);
+            memcpy(pCursor, &tLinks, sizeof(tLinks));
+            pCursor += sizeof(tLinks);
+
+            // ڶͨͬһԴֻԴ仯ʱ
+            if (p->res && p->res != pLastRes)
+            {
+                tSnapshot.resources.push_back(p->res);
+                pLastRes = p->res;
+            }
+            if (p->ps)
+                pParticleCursor += p->ps->SaveState(pParticleCursor);
+        }
+        pCursor = pParticleCursor;
+
+        // ߼ⰴ˳д
+        for (GameObjectBentLaser* p = GameObjectBentLaser::GetFirstInstance(); p; p = p->GetNextInstance())
+        {
+            LaserSnapshotHeader tLaser;
+            tLaser.instanceId = p->GetInstanceId();
+            tLaser.size = p->SaveState(pCursor + sizeof(tLaser));
+            memcpy(pCursor, &tLaser, sizeof(tLaser));
+            pCursor += sizeof(tLaser) + tLaser.size;
+        }
+        LASSERT(pCursor == tSnapshot.data.data() + tSnapshot.data.size());
+    }
+    catch (const bad_alloc&)
+    {
+        LERROR("SaveSnapshot: ڴ治");
+        DropSnapshot(slot);
+        return false;
+    }
+
+    // ʽlua
+    // λеıպã鲿ֱLGOBJ_MAXCNTСʱٷ
+    if (tSnapshot.objectTable == LUA_NOREF)
+    {
+        lua_createtable(L, LGOBJ_MAXCNT, 0);  // t
+        lua_pushvalue(L, -1);  // t t
+        tSnapshot.objectTable = luaL_ref(L, LUA_REGISTRYINDEX);  // t
+    }
+    else
+    {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, tSnapshot.objectTable);  // t
+        lua_pushnil(L);  // t nil
+        while (lua_next(L, -2))  // t k v
+        {
+            lua_pop(L, 1);  // t k
+            lua_pushvalue(L, -1);  // t k k
+            lua_pushnil(L);  // t k k nil
+            lua_rawset(L, -4);  // t k
+        }
+    }
+    GETOBJTABLE;  // t ot
+    for (GameObject* p = m_pObjectListHeader.pObjectNext; p != &m_pObjectListTail; p = p->pObjectNext)
+    {
+        lua_rawgeti(L, -1, p->id + 1);  // t ot t(object)
+        lua_rawseti(L, -3, p->id + 1);  // t ot
+    }
+    lua_pop(L, 2);
+    return true;
+}
+
+bool GameObjectPool::RestoreSnapshot(size_t slot)LNOEXCEPT
+{
+    LASSERT(slot < LGOBJ_SNAPSHOTCNT);
+    Snapshot& tSnapshot = m_Snapshots[slot];
+    if (tSnapshot.data.empty())
+        return false;
+
+    const fByte* pCursor = tSnapshot.data.data();
+    PoolSnapshotHeader tHeader;
+    memcpy(&tHeader, pCursor, sizeof(tHeader));
+    pCursor += sizeof(tHeader);
+    const size_t* pFreeIndex = reinterpret_cast<const size_t*>(pCursor);
+    pCursor += tHeader.freeCount * sizeof(size_t);
+
+    // ڸĶ״̬ǰӳزԤһʧʱָ
+    const fByte* pParticleCursor = pCursor + tHeader.objectCount * (sizeof(GameObject) + sizeof(ObjectSnapshotLinks));
+    vector<pair<ResParticle*, ResParticle::ParticlePool*>> tPools;
+    bool bAllocated = true;
+    try
+    {
+        tPools.reserve(tHeader.objectCount);  // ֤¼ӳʱ׳쳣
+        for (size_t i = 0; i < tHeader.objectCount && bAllocated; ++i)
+        {
+            GameObject tObject;
+            memcpy(&tObject, pCursor + i * (sizeof(GameObject) + sizeof(ObjectSnapshotLinks)), sizeof(GameObject));
+            if (!tObject.res || !tObject.ps)
+                continue;
+
+            LASSERT(tObject.res->GetType() == ResourceType::Particle);
+            size_t tAlive = 0;
+            pParticleCursor += ResParticle::ParticlePool::PeekState(pParticleCursor, tAlive);
+            ResParticle* pParticle = static_cast<ResParticle*>(tObject.res);
+            ResParticle::ParticlePool* pPool = pParticle->AllocInstance();
+            if (pPool)
+            {
+                tPools.emplace_back(pParticle, pPool);
+                bAllocated = pPool->Reserve(tAlive);
+            }
+            else
+                bAllocated = false;
+        }
+    }
+    catch (const bad_alloc&)
+    {
+        bAllocated = false;
+    }
+    if (!bAllocated)
+    {
+        for (auto& i : tPools)
+            i.first->FreeInstance(i.second);
+        LERROR("RestoreSnapshot: ڴ治㣬޷ӳ");
+        return false;
+    }
+
+    clearEvents();
+    m_ParticleUpdateList.clear();
+    m_bParticleUpdatePending = false;
+    m_FreeList.clear();
+
+    // ͷжõԴƳlua
+    GETOBJTABLE;  // ot
+    for (GameObject* p = m_pObjectListHeader.pObjectNext; p != &m_pObjectListTail; p = p->pObjectNext)
+    {
+        lua_pushnil(L);  // ot nil
+        lua_rawseti(L, -2, p->id + 1);  // ot
+        p->ReleaseResource();
+    }
+
+    m_ObjectPool.RestoreFreeIndex(pFreeIndex, tHeader.freeCount);
+
+    // ָ󲢽±껻ָ
+    lua_rawgeti(L, LUA_REGISTRYINDEX, tSnapshot.objectTable);  // ot st
+    pParticleCursor = pCursor + tHeader.objectCount * (sizeof(GameObject) + sizeof(ObjectSnapshotLinks));
+    size_t tPoolIndex = 0;
+    for (size_t i = 0; i < tHeader.objectCount; ++i)
+    {
+        GameObject tObject;
+        ObjectSnapshotLinks tLinks;
+        memcpy(&tObject, pCursor, sizeof(GameObject));
+        pCursor += sizeof(GameObject);
+        memcpy(&tLinks, pCursor, sizeof(tLinks));
+        pCursor += sizeof(tLinks);
+
+        GameObject* p = m_ObjectPool.Data(tObject.id);
+        LASSERT(p);
+        *p = tObject;
+        p->pObjectPrev = indexToLink(tLinks.objectPrev);
+        p->pObjectNext = indexToLink(tLinks.objectNext);
+        p->pRenderPrev = indexToLink(tLinks.renderPrev);
+        p->pRenderNext = indexToLink(tLinks.renderNext);
+        p->pCollisionPrev = indexToLink(tLinks.collisionPrev);
+        p->pCollisionNext = indexToLink(tLinks.collisionNext);
+
+        // ԴɿճУΪòӳ
+        if (p->res)
+        {
+            p->res->AddRef();
+            if (tObject.ps)
+            {
+                LASSERT(p->res->GetType() == ResourceType::Particle);
+                p->ps = tPools[tPoolIndex++].second;
+                pParticleCursor += p->ps->LoadState(pParticleCursor);
+            }
+        }
+
+        lua_rawgeti(L, -1, p->id + 1);  // ot st t(object)
+        lua_rawseti(L, -3, p->id + 1);  // ot st
+    }
+    lua_pop(L, 2);
+    pCursor = pParticleCursor;
+
+    // ָαͷαβ
+    const size_t* pLinks = tHeader.listLinks;
+    m_pObjectListHeader.pObjectNext = indexToLink(*pLinks++);
+    m_pObjectListTail.pObjectPrev = indexToLink(*pLinks++);
+    m_pRenderListHeader.pRenderNext = indexToLink(*pLinks++);
+    m_pRenderListTail.pRenderPrev = indexToLink(*pLinks++);
+    for (size_t i = 0; i < LGOBJ_GROUPCNT; ++i)
+    {
+        m_pCollisionListHeader[i].pCollisionNext = indexToLink(*pLinks++);
+        m_pCollisionListTail[i].pCollisionPrev = indexToLink(*pLinks++);
+    }
+    m_iUid = tHeader.uid;
+    m_BoundLeft = tHeader.bound[0];
+    m_BoundRight = tHeader.bound[1];
+    m_BoundTop = tHeader.bound[2];
+    m_BoundBottom = tHeader.bound[3];
+
+    // ߼ʵУζָ
+    GameObjectBentLaser* pLaser = GameObjectBentLaser::GetFirstInstance();
+    for (size_t i = 0; i < tHeader.laserCount; ++i)
+    {
+        LaserSnapshotHeader tLaser;
+        memcpy(&tLaser, pCursor, sizeof(tLaser));
+        pCursor += sizeof(tLaser);
+        while (pLaser && pLaser->GetInstanceId() < tLaser.instanceId)
+            pLaser = pLaser->GetNextInstance();
+        if (pLaser && pLaser->GetInstanceId() == tLaser.instanceId)
+            pLaser->LoadState(pCursor);
+        pCursor += tLaser.size;
+    }
+    return true;
+}
+
+void GameObjectPool::DropSnapshot(size_t slot)LNOEXCEPT
+{
+    LASSERT(slot < LGOBJ_SNAPSHOTCNT);
+    Snapshot& tSnapshot = m_Snapshots[slot];
+    vector<fByte>().swap(tSnapshot.data);
+    tSnapshot.resources.clear();
+    if (tSnapshot.objectTable != LUA_NOREF)
+    {
+        luaL_unref(L, LUA_REGISTRYINDEX, tSnapshot.objectTable);
+        tSnapshot.objectTable = LUA_NOREF;
+    }
+}
+
 bool GameObjectPool::DoDefaultRender(size_t id)LNOEXCEPT
 {
     GameObject* p = m_ObjectPool.Data(id);
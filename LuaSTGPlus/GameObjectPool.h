@@ -1,8 +1,10 @@
 #pragma once
 #include "Global.h"
 #include "ObjectPool.hpp"
-#include "CirularQueue.hpp"
 #include "ResourceMgr.h"
+#include "GameObjectBentLaser.h"
+
+#include <mutex>
 
 namespace LuaSTGPlus
 {
@@ -107,33 +109,37 @@ namespace LuaSTGPlus
 			}
 		}
 
+		bool ChangeResource(Resource* p);
 		bool ChangeResource(const char* res_name);
 	};
 
-	/// @brief ߼ػʵ
-	class GameObjectBentLaser
+	/// @brief ص֡׶
+	enum class GameObjectPoolPhase
 	{
-	public:
-		static GameObjectBentLaser* AllocInstance();
-		static void FreeInstance(GameObjectBentLaser* p);
-	private:
-		struct LaserNode
-		{
-			fcyVec2 pos;
-			float half_width;
-		};
-	private:
-		CirularQueue<LaserNode, LGOBJ_MAXLASERNODE> m_Queue;
-		float m_fLength = 0.f;  // ¼ⳤ
-	public:
-		bool Update(size_t id, int length, float width)LNOEXCEPT;
-		void Release()LNOEXCEPT;
-		bool Render(const char* tex_name, BlendMode blend, fcyColor c, float tex_left, float tex_top, float tex_width, float tex_height, float scale)LNOEXCEPT;
-		bool CollisionCheck(float x, float y, float rot, float a, float b, bool rect)LNOEXCEPT;
-		bool BoundCheck()LNOEXCEPT;
-	protected:
-		GameObjectBentLaser();
-		~GameObjectBentLaser();
+		Frame = 0,  // ִ֡˶״̬
+		Particle,  // ϵͳ
+		BoundCheck,  // ߽
+		CollisionCheck,  // ײ
+		UpdateXY,  // ƫ
+		AfterFrame,  // ֡ĩն
+		Count
+	};
+
+	/// @brief ͳƺʱĶص
+	enum class GameObjectCallback
+	{
+		Frame = 0,  // ֡
+		Render,  // Ⱦ
+		Colli,  // ײص
+		Count
+	};
+
+	/// @brief Ļصʱͳ
+	struct GameObjectClassStats
+	{
+		std::string name;  // nameֶΣַʱΪĵַ
+		double time[(size_t)GameObjectCallback::Count];  // ۼƺʱ()
+		uint64_t calls[(size_t)GameObjectCallback::Count];  // ۼƵô
 	};
 
 	/// @brief Ϸ
@@ -149,6 +155,94 @@ namespace LuaSTGPlus
 		GameObject m_pRenderListHeader, m_pRenderListTail;
 		GameObject m_pCollisionListHeader[LGOBJ_GROUPCNT], m_pCollisionListTail[LGOBJ_GROUPCNT];
 
+		// ֡ϵͳĶ
+		std::vector<GameObject*> m_ParticleUpdateList;
+
+		// ֡ĩյĶ
+		std::vector<GameObject*> m_FreeList;
+
+		// н׶ռĽ
+		std::mutex m_PhaseResultLock;
+		std::vector<std::pair<GameObject*, GameObject*>> m_PhaseResults;
+		std::vector<GameObject*> m_CollisionListA, m_CollisionListB;
+
+		// ׶κʱ
+		float m_PhaseTimer[(size_t)GameObjectPoolPhase::Count];  // ֡ۼ
+		float m_PhaseTimerLast[(size_t)GameObjectPoolPhase::Count];  // һ֡
+
+		// ȫԤ
+		size_t m_iParticleBudget = 0;  // ޣ0ʾ
+		size_t m_iParticleTotal = 0;  // һθºĴ
+		size_t m_iParticleThrottled = 0;  // һθбƷӳ
+		bool m_bParticleUpdatePending = false;  // DoFrame֮δϵͳ
+
+		/// @brief ĬԻ
+		/// @note defaultɣuserdataʽLGOBJ_CC_DEFAULTУͼ
+		/// @note ڵһδĶʱɲᣬֻclass.default滻Ϊһʱɣ
+		///       ͵޸defaultݲЧ԰汾лһδʱ
+		struct ClassDefault
+		{
+			enum
+			{
+				HasImage = 1 << 0,
+				HasLayer = 1 << 1,
+				HasGroup = 1 << 2,
+				HasA = 1 << 3,
+				HasB = 1 << 4,
+				HasRect = 1 << 5,
+				HasBound = 1 << 6,
+				HasColli = 1 << 7,
+				HasNavi = 1 << 8,
+				HasHide = 1 << 9,
+				HasHScale = 1 << 10,
+				HasVScale = 1 << 11
+			};
+
+			const void* source;  // ɻdefault滻󻺴ʧЧ
+			uint32_t mask;
+			lua_Number layer, a, b, hscale, vscale;
+			lua_Integer group;
+			bool rect, bound, colli, navi, hide;
+			Resource* res;  // ͼԴԴı(˿ڱͬԴ)²
+			fuInt resGeneration;
+
+			const char* GetImageName()const { return reinterpret_cast<const char*>(this + 1); }
+		};
+
+		/// @brief ӳִеĶ¼
+		/// @note iduid¼ɷʱѱյ¼
+		struct DeferredEvent
+		{
+			int callback;  // LGOBJ_CC_DELLGOBJ_CC_KILLLGOBJ_CC_COLLI
+			size_t idA, idB;
+			int64_t uidA, uidB;
+			int args;  // Del/KillӲעеã޸ӲʱΪLUA_NOREF
+		};
+
+		// ¼
+		bool m_bDeferEvents = false;
+		std::vector<DeferredEvent> m_EventQueue;
+		size_t m_iEventCursor = 0;  // һɷ¼
+
+		/// @brief ؿ
+		/// @note ͷб(ָ뻻Ϊ±)ӳ״̬߼״̬δdata
+		struct Snapshot
+		{
+			std::vector<fByte> data;
+			std::vector<fcyRefPointer<Resource>> resources;  // пжõԴ
+			int objectTable = LUA_NOREF;  // ʱluaעеãǿʱպ
+		};
+
+		// ղλ
+		Snapshot m_Snapshots[LGOBJ_SNAPSHOTCNT];
+
+		// ͳƻصʱ
+		bool m_bClassStats = false;
+		std::unordered_map<const void*, GameObjectClassStats> m_ClassStats;  // ַΪ
+		std::vector<int> m_ClassStatsRefs;  // ͳƵעеãֹ౻պַ
+		const void* m_pLastStatsClass = nullptr;  // ڶͬһ࣬һβҵĽ
+		GameObjectClassStats* m_pLastStats = nullptr;
+
 		// ߽
 		lua_Number m_BoundLeft = -100.f;
 		lua_Number m_BoundRight = 100.f;
@@ -156,6 +250,22 @@ namespace LuaSTGPlus
 		lua_Number m_BoundBottom = -100.f;
 	private:
 		GameObject* freeObject(GameObject* p)LNOEXCEPT;
+		void freeObjects()LNOEXCEPT;
+		template <typename Func>
+		void parallelForEachObject(const char* zone, Func f)LNOEXCEPT;
+		GameObjectClassStats* getClassStats(int cls)LNOEXCEPT;
+		void callWithClassStats(GameObjectCallback callback, int cls, int nargs);
+		void pushPhaseResultEvents(int callback)LNOEXCEPT;
+		void applyParticleBudget()LNOEXCEPT;
+		ClassDefault* getClassDefault(lua_State* L, int cls);
+		static void readClassDefault(lua_State* L, int def, ClassDefault& out);
+		static bool sameClassDefault(const ClassDefault& a, const char* aName, const ClassDefault& b, const char* bName)LNOEXCEPT;
+		ClassDefault* buildClassDefault(lua_State* L, int cls, int def);
+		bool applyClassDefault(GameObject* p, ClassDefault* d)LNOEXCEPT;
+		void pushEvent(int callback, GameObject* pA, GameObject* pB, int args);
+		void clearEvents()LNOEXCEPT;
+		size_t linkToIndex(GameObject* p)LNOEXCEPT;
+		GameObject* indexToLink(size_t i)LNOEXCEPT;
 	public:
 		/// @brief ǷΪ߳
 		bool CheckIsMainThread(lua_State* pL)LNOEXCEPT { return pL == L; }
@@ -167,11 +277,37 @@ namespace LuaSTGPlus
 		GameObject* GetPooledObject(size_t i)LNOEXCEPT { return m_ObjectPool.Data(i); }
 
 		/// @brief ִжFrame
+		/// @note  ֻռϵͳĶϵͳUpdateParticlesͳһ
 		void DoFrame()LNOEXCEPT;
 
+		/// @brief иһDoFrameռϵͳ
+		/// @note  Ϊ׶ɽűObjFrame֮áűûеʱһDoFrameAfterFrameն֮ǰ
+		///        ֡غÿDoFrameִֻ֮һ
+		void UpdateParticles()LNOEXCEPT;
+
+		/// @brief ȡȫԤ
+		size_t GetParticleBudget()LNOEXCEPT { return m_iParticleBudget; }
+
+		/// @brief ȫԤ
+		/// @param[in] budget ޣʱȼ͸ӳصķ0ʾ
+		void SetParticleBudget(size_t budget)LNOEXCEPT { m_iParticleBudget = budget; }
+
+		/// @brief ȡһθºĴ
+		size_t GetParticleTotal()LNOEXCEPT { return m_iParticleTotal; }
+
+		/// @brief ȡһθбƷӳ
+		size_t GetParticleThrottledCount()LNOEXCEPT { return m_iParticleThrottled; }
+
 		/// @brief ִжRender
 		void DoRender()LNOEXCEPT;
 
+		/// @brief ʼһ֡Ľ׶μʱ
+		/// @note  ֡ۼƵĺʱתΪһ֡Ľ
+		void BeginPhaseTimer()LNOEXCEPT;
+
+		/// @brief ȡһ֡ĳ׶εۼƺʱ()
+		float GetPhaseTime(GameObjectPoolPhase phase)LNOEXCEPT { return m_PhaseTimerLast[(size_t)phase]; }
+
 		/// @brief ȡ̨߽
 		fcyRect GetBound()LNOEXCEPT
 		{
@@ -188,17 +324,52 @@ namespace LuaSTGPlus
 		}
 
 		/// @brief ִб߽
+		/// @note  ӳɷ¼ʱм
 		void BoundCheck()LNOEXCEPT;
 
 		/// @brief ײ
 		/// @param[in] groupA A
 		/// @param[in] groupB B
+		/// @note  ӳɷ¼ʱм
 		void CollisionCheck(size_t groupA, size_t groupB)LNOEXCEPT;
 
+		/// @brief Ƿӳɷ¼
+		bool IsEventDeferred()LNOEXCEPT { return m_bDeferEvents; }
+
+		/// @brief Ƿӳɷ¼
+		/// @note BoundCheckCollisionCheckDelKillֻ¼¼ûص
+		///       صDispatchEventsAfterFrameа¼˳ִ
+		void SetEventDeferred(bool b)LNOEXCEPT { m_bDeferEvents = b; }
+
+		/// @brief Ƿͳƻصʱ
+		bool IsClassStatsEnabled()LNOEXCEPT { return m_bClassStats; }
+
+		/// @brief Ƿͳƻصʱ
+		/// @note DoFrameDoRenderCollisionCheckԼɷײ¼ʱÿλصʱ
+		///       رʱеͳƱÿλصֻһж
+		void SetClassStatsEnabled(bool b)LNOEXCEPT { m_bClassStats = b; }
+
+		/// @brief ȡĻصʱͳ
+		const std::unordered_map<const void*, GameObjectClassStats>& GetClassStats()LNOEXCEPT { return m_ClassStats; }
+
+		/// @brief صʱͳ
+		/// @note ͳƹԱУڻصе
+		void ResetClassStats()LNOEXCEPT;
+
+		/// @brief ȡɷ¼
+		size_t GetPendingEventCount()LNOEXCEPT { return m_EventQueue.size() - m_iEventCursor; }
+
+		/// @brief ¼˳ִбӳٵ¼ص
+		/// @note صв¼ڱɷһִ
+		/// @return ִеĻص
+		size_t DispatchEvents()LNOEXCEPT;
+
 		/// @brief ¶XYƫ
+		/// @note  ϶ʱи
 		void UpdateXY()LNOEXCEPT;
 
 		/// @brief ֡ĩº
+		/// @note  ɾĶ
 		void AfterFrame()LNOEXCEPT;
 
 		/// @brief ¶
@@ -234,6 +405,24 @@ namespace LuaSTGPlus
 		/// @brief ն
 		void ResetPool()LNOEXCEPT;
 
+		/// @brief ؿ
+		/// @param[in] slot λСLGOBJ_SNAPSHOTCNT
+		/// @note ݡбuid̨߽Լӳ߼״̬
+		///       luaֻãеֶβᱻ档
+		/// @return ڴ治ʱfalse
+		bool SaveSnapshot(size_t slot)LNOEXCEPT;
+
+		/// @brief ָؿ
+		/// @note ɷ¼պѱͷŵ߼޷ָڶصеá
+		/// @return λΪջ޷ӳʱfalseʱرֲ
+		bool RestoreSnapshot(size_t slot)LNOEXCEPT;
+
+		/// @brief ͷſ
+		void DropSnapshot(size_t slot)LNOEXCEPT;
+
+		/// @brief ȡռõֽλΪʱ0
+		size_t GetSnapshotSize(size_t slot)LNOEXCEPT { return m_Snapshots[slot].data.size(); }
+
 		/// @brief ִĬȾ
 		bool DoDefaultRender(size_t id)LNOEXCEPT;
 
@@ -36,76 +36,104 @@ namespace LuaSTGPlus
 
 	inline GameObjectProperty GameObjectPropertyHash(const char* key)
 	{
-		static const char* s_orgKeyList[] =
+		switch (key[0])
 		{
-			"x",
-			"y",
-			"dx",
-			"dy",
-			"rot",
-			"omiga",
-			"timer",
-			"vx",
-			"vy",
-			"ax",
-			"ay",
-			"layer",
-			"group",
-			"hide",
-			"bound",
-			"navi",
-			"colli",
-			"status",
-			"hscale",
-			"vscale",
-			"class",
-			"a",
-			"b",
-			"rect",
-			"img",
-			"ani",
-		};
-		
-		static const unsigned int s_bestIndices[] =
-		{
-			0, 1, 
-		};
-		
-		static const unsigned int s_hashTable1[] =
-		{
-			191, 127, 
-		};
-		
-		static const unsigned int s_hashTable2[] =
-		{
-			239, 14, 
-		};
-		
-		static const unsigned int s_hashTableG[] =
-		{
-			0, 0, 0, 0, 15, 0, 0, 0, 0, 16, 
-			13, 0, 19, 0, 9, 0, 12, 0, 0, 5, 
-			4, 22, 8, 23, 13, 16, 22, 0, 0, 15, 
-			22, 20, 8, 14, 19, 0, 14, 21, 6, 0, 
-			20, 17, 0, 
-		};
-		
-		unsigned int f1 = 0, f2 = 0, len = strlen(key);
-		for (unsigned int i = 0; i < 2; ++i)
-		{
-			unsigned int idx = s_bestIndices[i];
-			if (idx < len)
+		case 'a':
+			switch (key[1])
+			{
+			case '\0':
+				return GameObjectProperty::A;
+			case 'n':
+				return strcmp(key + 2, "i") == 0 ? GameObjectProperty::ANI : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'x':
+				return key[2] == '\0' ? GameObjectProperty::AX : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'y':
+				return key[2] == '\0' ? GameObjectProperty::AY : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 'b':
+			switch (key[1])
+			{
+			case '\0':
+				return GameObjectProperty::B;
+			case 'o':
+				return strcmp(key + 2, "und") == 0 ? GameObjectProperty::BOUND : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 'c':
+			switch (key[1])
+			{
+			case 'l':
+				return strcmp(key + 2, "ass") == 0 ? GameObjectProperty::CLASS : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'o':
+				return strcmp(key + 2, "lli") == 0 ? GameObjectProperty::COLLI : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 'd':
+			switch (key[1])
+			{
+			case 'x':
+				return key[2] == '\0' ? GameObjectProperty::DX : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'y':
+				return key[2] == '\0' ? GameObjectProperty::DY : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 'g':
+			return strcmp(key + 1, "roup") == 0 ? GameObjectProperty::GROUP : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'h':
+			switch (key[1])
+			{
+			case 'i':
+				return strcmp(key + 2, "de") == 0 ? GameObjectProperty::HIDE : GameObjectProperty::_KEY_NOT_FOUND;
+			case 's':
+				return strcmp(key + 2, "cale") == 0 ? GameObjectProperty::HSCALE : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 'i':
+			return strcmp(key + 1, "mg") == 0 ? GameObjectProperty::IMG : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'l':
+			return strcmp(key + 1, "ayer") == 0 ? GameObjectProperty::LAYER : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'n':
+			return strcmp(key + 1, "avi") == 0 ? GameObjectProperty::NAVI : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'o':
+			return strcmp(key + 1, "miga") == 0 ? GameObjectProperty::OMIGA : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'r':
+			switch (key[1])
+			{
+			case 'e':
+				return strcmp(key + 2, "ct") == 0 ? GameObjectProperty::RECT : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'o':
+				return strcmp(key + 2, "t") == 0 ? GameObjectProperty::ROT : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
+			}
+		case 's':
+			return strcmp(key + 1, "tatus") == 0 ? GameObjectProperty::STATUS : GameObjectProperty::_KEY_NOT_FOUND;
+		case 't':
+			return strcmp(key + 1, "imer") == 0 ? GameObjectProperty::TIMER : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'v':
+			switch (key[1])
 			{
-				f1 = (f1 + s_hashTable1[i] * (unsigned int)key[idx]) % 43;
-				f2 = (f2 + s_hashTable2[i] * (unsigned int)key[idx]) % 43;
+			case 's':
+				return strcmp(key + 2, "cale") == 0 ? GameObjectProperty::VSCALE : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'x':
+				return key[2] == '\0' ? GameObjectProperty::VX : GameObjectProperty::_KEY_NOT_FOUND;
+			case 'y':
+				return key[2] == '\0' ? GameObjectProperty::VY : GameObjectProperty::_KEY_NOT_FOUND;
+			default:
+				return GameObjectProperty::_KEY_NOT_FOUND;
 			}
-			else
-				break;
+		case 'x':
+			return key[1] == '\0' ? GameObjectProperty::X : GameObjectProperty::_KEY_NOT_FOUND;
+		case 'y':
+			return key[1] == '\0' ? GameObjectProperty::Y : GameObjectProperty::_KEY_NOT_FOUND;
+		default:
+			return GameObjectProperty::_KEY_NOT_FOUND;
 		}
-		
-		unsigned int hash = (s_hashTableG[f1] + s_hashTableG[f2]) % 26;
-		if (strcmp(s_orgKeyList[hash], key) == 0)
-			return static_cast<GameObjectProperty>(hash);
-		return GameObjectProperty::_KEY_NOT_FOUND;
 	}
 }
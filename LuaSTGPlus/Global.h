@@ -66,16 +66,24 @@
 // Ϣ
 #define LGOBJ_MAXCNT 32768  // 
 #define LGOBJ_MAXLASERNODE 512  // ߼ڵ
+#define LGOBJ_LASERCHUNKSIZE 16  // ߼ײΧзֿС
 #define LGOBJ_DEFAULTGROUP 0  // Ĭ
 #define LGOBJ_GROUPCNT 16  // ײ
+#define LGOBJ_PARALLELMINCNT 1024  // ﵽֵʱĽ׶βִ
+#define LGOBJ_UPDATEGRAIN 512  // дʱÿĶزλ
+#define LGOBJ_COLLIGRAIN 4096  // ײʱÿĶ
+#define LGOBJ_SWEEPRATIO 8  // ֡ĩɾ1/8ʱɨժ
+#define LGOBJ_SNAPSHOTCNT 4  // ؿղλ
 
 // CLASSдŵĻص±
+// 1~6ɽűClass()/InitAllClass룬ֶ(is_classinitdefault)Ϊַ
 #define LGOBJ_CC_INIT 1
 #define LGOBJ_CC_DEL 2
 #define LGOBJ_CC_FRAME 3
 #define LGOBJ_CC_RENDER 4
 #define LGOBJ_CC_COLLI 5
 #define LGOBJ_CC_KILL 6
+#define LGOBJ_CC_DEFAULT 7  // (ʹ)ĬԻ棬űӦʹø±̳꣬ʱҲ޷(水defaultУ)
 
 // ѧ
 #define LRAD2DEGREE (180.0/3.141592653589793) // ȵǶ
@@ -95,6 +103,12 @@
 #endif
 // #define LSHOWFONTBASELINE  // ʾֻ
 #define LPERFORMANCEUPDATETIMER 0.5f  // ˢһμ
+#define LWORKER_MAXCNT 7  // ߳(߳)
+#define LPROFILER_EVENTCNT 65536  // ÿ߳ಶ¼
+#define LPROFILER_SPARESLOTCNT 2  // Ϊ̡߳Ϸѭ̺߳͹߳߳ԤĻ
+#define LPROFILER_MAXSCRIPTDEPTH 256  // űǶ
+#define LSAMPLER_INTERVAL 1000  // luaĬϵĲ(ָ)
+#define LSAMPLER_MAXDEPTH 64  // lua¼ջ
 
 #define LAPP (LuaSTGPlus::AppFrame::GetInstance())
 #define LLOGGER (LuaSTGPlus::LogSystem::GetInstance())
@@ -118,7 +132,13 @@
 #define LASSERT(cond)
 #endif
 
-#define LPARTICLE_MAXCNT 500  // ӳ500
+#define LPARTICLE_MINCNT 16  // ӳ16
+#define LPARTICLE_MAXPOOLEDCNT 2048  // 2048ӳشڴط䣬ӳֱӴӶϷ䣬
+#define LPARTICLE_UPDATEGRAIN 8  // иʱÿӳ
+#define LPARTICLE_BATCHSIZE 256  // ӵύȾ㻺С(1024)
+#if (defined _M_X64) || (defined _M_IX86_FP && _M_IX86_FP >= 1)
+#define LPARTICLE_USESSE  // ʹSSEӣʹñʵ
+#endif
 
 #define LJOYSTICK1_MAPPING_START 0x92
 #define LJOYSTICK1_MAPPING_END (0x92 + 31)
@@ -0,0 +1,281 @@
+﻿#include "InputReplay.h"
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+static const char s_ReplayMagic[4] = { 'L', 'R', 'P', '1' };
+
+InputReplay::InputReplay()
+{
+	::memset(m_KeyState, 0, sizeof(m_KeyState));
+}
+
+void InputReplay::writeVarUInt(fuInt v)
+{
+	while (v >= 0x80)
+	{
+		m_Stream.push_back(static_cast<fByte>(v | 0x80));
+		v >>= 7;
+	}
+	m_Stream.push_back(static_cast<fByte>(v));
+}
+
+bool InputReplay::readVarUInt(fuInt& v)LNOEXCEPT
+{
+	v = 0;
+	for (int tShift = 0; tShift < 35; tShift += 7)
+	{
+		if (m_iReadPos >= m_Stream.size())
+			return false;
+		fByte b = m_Stream[m_iReadPos++];
+		v |= static_cast<fuInt>(b & 0x7F) << tShift;
+		if ((b & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+void InputReplay::writeEvent(EventType t, fuInt payload)
+{
+	writeVarUInt(((m_iFrame - m_iEventFrame) << 2) | t);
+	m_iEventFrame = m_iFrame;
+
+	switch (t)
+	{
+	case EventKeyToggle:
+	case EventLastKey:
+		m_Stream.push_back(static_cast<fByte>(payload));
+		break;
+	case EventSeed:
+		writeVarUInt(payload);
+		break;
+	default:
+		break;
+	}
+}
+
+bool InputReplay::readEvent()LNOEXCEPT
+{
+	fuInt tHeader;
+	if (!readVarUInt(tHeader))
+		return false;
+	m_NextType = static_cast<EventType>(tHeader & 3);
+	m_iNextFrame += tHeader >> 2;
+
+	switch (m_NextType)
+	{
+	case EventKeyToggle:
+	case EventLastKey:
+		if (m_iReadPos >= m_Stream.size())
+			return false;
+		m_iNextPayload = m_Stream[m_iReadPos++];
+		return true;
+	case EventSeed:
+		return readVarUInt(m_iNextPayload);
+	default:
+		m_iNextPayload = 0;
+		return true;
+	}
+}
+
+bool InputReplay::StartRecording(const wchar_t* path)LNOEXCEPT
+{
+	LASSERT(m_Mode == Mode::None);
+
+	try
+	{
+		m_Path = path;
+		m_Stream.clear();
+		m_Stream.reserve(64 * 1024);
+		m_Stream.insert(m_Stream.end(), s_ReplayMagic, s_ReplayMagic + sizeof(s_ReplayMagic));
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("InputReplay: 内存不足");
+		return false;
+	}
+
+	m_iFrame = m_iEventFrame = 0;
+	::memset(m_KeyState, 0, sizeof(m_KeyState));
+	m_LastKey = 0;
+	m_Mode = Mode::Recording;
+	LINFO("InputReplay: 开始录制到'%s'", path);
+	return true;
+}
+
+bool InputReplay::StartPlayback(const wchar_t* path)LNOEXCEPT
+{
+	LASSERT(m_Mode == Mode::None);
+
+	try
+	{
+		fcyRefPointer<fcyFileStream> pFile;
+		pFile.DirectSet(new fcyFileStream(path, false));
+		m_Stream.resize((size_t)pFile->GetLength());
+		if (!m_Stream.empty() && FCYFAILED(pFile->ReadBytes(m_Stream.data(), m_Stream.size(), nullptr)))
+		{
+			LERROR("InputReplay: 读取录像文件'%s'失败", path);
+			return false;
+		}
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("InputReplay: 内存不足");
+		return false;
+	}
+	catch (const fcyException& e)
+	{
+		LERROR("InputReplay: 打开录像文件'%s'失败 (异常信息'%m' 源'%m')", path, e.GetDesc(), e.GetSrc());
+		return false;
+	}
+
+	if (m_Stream.size() < sizeof(s_ReplayMagic) || memcmp(m_Stream.data(), s_ReplayMagic, sizeof(s_ReplayMagic)) != 0)
+	{
+		LERROR("InputReplay: '%s'不是有效的录像文件", path);
+		return false;
+	}
+
+	m_iReadPos = sizeof(s_ReplayMagic);
+	m_iNextFrame = 0;
+	if (!readEvent())
+	{
+		LERROR("InputReplay: 录像文件'%s'已损坏", path);
+		return false;
+	}
+
+	m_Path = path;
+	m_iFrame = 0;
+	::memset(m_KeyState, 0, sizeof(m_KeyState));
+	m_LastKey = 0;
+	m_bSeedMismatch = false;
+	m_Mode = Mode::Playing;
+	LINFO("InputReplay: 开始回放'%s'", path);
+	return true;
+}
+
+void InputReplay::Stop()LNOEXCEPT
+{
+	if (m_Mode == Mode::Recording)
+	{
+		try
+		{
+			writeEvent(EventEnd, 0);
+
+			fcyRefPointer<fcyFileStream> pFile;
+			pFile.DirectSet(new fcyFileStream(m_Path.c_str(), true));
+			if (FCYFAILED(pFile->SetLength(0)) ||
+				FCYFAILED(pFile->WriteBytes(m_Stream.data(), m_Stream.size(), nullptr)))
+			{
+				LERROR("InputReplay: 无法向文件'%s'写出录像", m_Path.c_str());
+			}
+			else
+				LINFO("InputReplay: 录像已保存到'%s' (帧数: %u 大小: %u字节)", m_Path.c_str(), m_iFrame, (fuInt)m_Stream.size());
+		}
+		catch (const bad_alloc&)
+		{
+			LERROR("InputReplay: 内存不足");
+		}
+		catch (const fcyException& e)
+		{
+			LERROR("InputReplay: 保存录像到'%s'失败 (异常信息'%m' 源'%m')", m_Path.c_str(), e.GetDesc(), e.GetSrc());
+		}
+	}
+
+	m_Mode = Mode::None;
+	m_Stream.clear();
+}
+
+void InputReplay::RecordFrame(const fBool keyState[], int lastKey)LNOEXCEPT
+{
+	LASSERT(m_Mode == Mode::Recording);
+
+	++m_iFrame;
+	try
+	{
+		for (int i = 1; i < _countof(m_KeyState); ++i)
+		{
+			if (keyState[i] != m_KeyState[i])
+			{
+				m_KeyState[i] = keyState[i];
+				writeEvent(EventKeyToggle, (fuInt)i);
+			}
+		}
+		if (lastKey != m_LastKey)
+		{
+			m_LastKey = lastKey;
+			writeEvent(EventLastKey, (fuInt)lastKey & 0xFF);
+		}
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("InputReplay: 内存不足，录制已终止");
+		m_Mode = Mode::None;
+	}
+}
+
+bool InputReplay::PlayFrame()LNOEXCEPT
+{
+	LASSERT(m_Mode == Mode::Playing);
+
+	++m_iFrame;
+
+	// 跳过上一帧没有被消耗的种子
+	while (m_iNextFrame < m_iFrame && m_NextType == EventSeed)
+	{
+		if (!m_bSeedMismatch)
+		{
+			LWARNING("InputReplay: 第%u帧的随机数种子没有被使用，回放可能已经不同步", m_iNextFrame);
+			m_bSeedMismatch = true;
+		}
+		if (!readEvent())
+			m_NextType = EventEnd;
+	}
+
+	while (m_iNextFrame == m_iFrame && (m_NextType == EventKeyToggle || m_NextType == EventLastKey))
+	{
+		if (m_NextType == EventKeyToggle)
+			m_KeyState[m_iNextPayload] = !m_KeyState[m_iNextPayload];
+		else
+			m_LastKey = (int)m_iNextPayload;
+		if (!readEvent())
+			m_NextType = EventEnd;
+	}
+
+	if (m_NextType == EventEnd && m_iFrame > m_iNextFrame)
+	{
+		LINFO("InputReplay: 回放结束 (帧数: %u)", m_iNextFrame);
+		return false;
+	}
+	return true;
+}
+
+fuInt InputReplay::FilterSeed(fuInt seed)LNOEXCEPT
+{
+	if (m_Mode == Mode::Recording)
+	{
+		try
+		{
+			writeEvent(EventSeed, seed);
+		}
+		catch (const bad_alloc&)
+		{
+			LERROR("InputReplay: 内存不足，录制已终止");
+			m_Mode = Mode::None;
+		}
+	}
+	else if (m_Mode == Mode::Playing)
+	{
+		if (m_NextType == EventSeed && m_iNextFrame == m_iFrame)
+		{
+			seed = m_iNextPayload;
+			if (!readEvent())
+				m_NextType = EventEnd;
+		}
+		else if (!m_bSeedMismatch)
+		{
+			LWARNING("InputReplay: 第%u帧请求了录像中不存在的随机数种子，回放可能已经不同步", m_iFrame);
+			m_bSeedMismatch = true;
+		}
+	}
+	return seed;
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+#include "Global.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 输入录像
+	/// @note  录制时逐帧比较按键状态，只记录发生变化的按键以及lstg.Rand使用的随机数种子；
+	///        回放时用记录的数据代替窗口消息与输入设备，配合无窗口模式可以不限速地重新模拟。
+	///        数据流格式：文件头"LRP1"，随后是若干事件，每个事件以变长整数(帧差<<2|类型)开头，
+	///        帧差为与上一事件所在帧的差值，类型决定随后的负载。
+	class InputReplay
+	{
+	public:
+		enum class Mode
+		{
+			None,
+			Recording,
+			Playing
+		};
+	private:
+		enum EventType
+		{
+			EventKeyToggle = 0,  // 负载：1字节按键码，按键状态翻转
+			EventLastKey = 1,  // 负载：1字节按键码，最后一次按键变化
+			EventSeed = 2,  // 负载：变长整数，随机数种子
+			EventEnd = 3  // 无负载，所在帧为总帧数
+		};
+	private:
+		Mode m_Mode = Mode::None;
+		std::wstring m_Path;
+		std::vector<fByte> m_Stream;
+
+		fuInt m_iFrame = 0;  // 当前帧，0为初始化阶段
+		fuInt m_iEventFrame = 0;  // 上一事件所在帧
+		fBool m_KeyState[256];
+		int m_LastKey = 0;
+
+		// 回放时预读的下一个事件
+		size_t m_iReadPos = 0;
+		EventType m_NextType = EventEnd;
+		fuInt m_iNextFrame = 0;
+		fuInt m_iNextPayload = 0;
+		bool m_bSeedMismatch = false;
+	private:
+		void writeVarUInt(fuInt v);
+		bool readVarUInt(fuInt& v)LNOEXCEPT;
+		void writeEvent(EventType t, fuInt payload);
+		bool readEvent()LNOEXCEPT;
+	public:
+		Mode GetMode()const LNOEXCEPT { return m_Mode; }
+		bool IsRecording()const LNOEXCEPT { return m_Mode == Mode::Recording; }
+		bool IsPlaying()const LNOEXCEPT { return m_Mode == Mode::Playing; }
+		fuInt GetFrame()const LNOEXCEPT { return m_iFrame; }
+
+		/// @brief 开始录制，数据在Stop时写出到文件
+		bool StartRecording(const wchar_t* path)LNOEXCEPT;
+
+		/// @brief 载入录像并开始回放
+		bool StartPlayback(const wchar_t* path)LNOEXCEPT;
+
+		/// @brief 结束录制或回放，录制时写出文件
+		void Stop()LNOEXCEPT;
+
+		/// @brief 录制一帧的输入
+		/// @param[in] keyState 本帧所有按键的状态
+		/// @param[in] lastKey  本帧的最后一次按键
+		void RecordFrame(const fBool keyState[], int lastKey)LNOEXCEPT;
+
+		/// @brief 回放一帧的输入
+		/// @return 录像已经结束时返回false
+		bool PlayFrame()LNOEXCEPT;
+
+		/// @brief 回放时获取按键状态
+		fBool GetKeyState(int VKCode)const LNOEXCEPT
+		{
+			if (VKCode > 0 && VKCode < _countof(m_KeyState))
+				return m_KeyState[VKCode];
+			return false;
+		}
+
+		/// @brief 回放时获取最后一次按键
+		int GetLastKey()const LNOEXCEPT { return m_LastKey; }
+
+		/// @brief 处理随机数种子
+		/// @note  录制时记录种子并原样返回，回放时返回录像中对应的种子
+		fuInt FilterSeed(fuInt seed)LNOEXCEPT;
+	public:
+		InputReplay();
+	};
+}
@@ -0,0 +1,148 @@
+﻿#include "LuaSampler.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+// 钩子函数不带用户参数，通过该指针找到正在采样的分析器
+static LuaSampler* s_pActiveSampler = nullptr;
+
+LuaSampler::~LuaSampler()
+{
+	// 虚拟机此时可能已被关闭，只解除关联
+	if (s_pActiveSampler == this)
+		s_pActiveSampler = nullptr;
+}
+
+void LuaSampler::hookFunc(lua_State* L, lua_Debug* ar)
+{
+	if (ar->event == LUA_HOOKCOUNT && s_pActiveSampler)
+		s_pActiveSampler->sample(L);
+}
+
+// 写出一个栈帧，分号与换行用于分隔，需要替换掉
+static void AppendFrame(string& out, const char* s)
+{
+	for (; *s; ++s)
+	{
+		char c = *s;
+		out.push_back(c == ';' || c == '\n' || c == '\r' ? '_' : c);
+	}
+}
+
+void LuaSampler::sample(lua_State* L)LNOEXCEPT
+{
+	lua_Debug tInfo;
+	int tDepth = 0;
+	while (tDepth < LSAMPLER_MAXDEPTH && lua_getstack(L, tDepth, &tInfo))
+		++tDepth;
+
+	try
+	{
+		// 从栈底到栈顶依次写出，根帧为引擎回调
+		string tStack;
+		tStack.reserve(256);
+		tStack.push_back('[');
+		tStack.append(m_pContext);
+		tStack.push_back(']');
+		for (int i = tDepth - 1; i >= 0; --i)
+		{
+			lua_getstack(L, i, &tInfo);
+			lua_getinfo(L, "Sn", &tInfo);
+			tStack.push_back(';');
+			if (tInfo.what[0] == 'C')
+			{
+				tStack.append("[C] ");
+				AppendFrame(tStack, tInfo.name ? tInfo.name : "?");
+			}
+			else
+			{
+				AppendFrame(tStack, tInfo.name ? tInfo.name : (tInfo.what[0] == 'm' ? "main" : "?"));
+				tStack.append(" (");
+				AppendFrame(tStack, tInfo.short_src);
+				tStack.append(StringFormat(":%d)", tInfo.linedefined));
+			}
+		}
+		++m_Stacks[tStack];
+		++m_iSampleCount;
+	}
+	catch (const bad_alloc&)
+	{
+		++m_iDroppedCount;
+	}
+}
+
+void LuaSampler::Start(lua_State* L, int interval)LNOEXCEPT
+{
+	if (IsSampling() || s_pActiveSampler)
+		return;
+
+	this->L = L;
+	s_pActiveSampler = this;
+	lua_sethook(L, &hookFunc, LUA_MASKCOUNT, max(interval, 1));
+	LINFO("LuaSampler: 开始采样 (间隔: %d条指令)", max(interval, 1));
+}
+
+void LuaSampler::Stop()LNOEXCEPT
+{
+	if (!IsSampling())
+		return;
+
+	lua_sethook(L, nullptr, 0, 0);
+	L = nullptr;
+	s_pActiveSampler = nullptr;
+	LINFO("LuaSampler: 停止采样 (样本数: %u)", m_iSampleCount);
+}
+
+void LuaSampler::Clear()LNOEXCEPT
+{
+	m_Stacks.clear();
+	m_iSampleCount = 0;
+	m_iDroppedCount = 0;
+}
+
+bool LuaSampler::Save(const std::wstring& path)LNOEXCEPT
+{
+	try
+	{
+		// 按栈排序，使相同脚本的多次输出便于比较
+		vector<const pair<const string, fuInt>*> tSorted;
+		tSorted.reserve(m_Stacks.size());
+		for (auto& i : m_Stacks)
+			tSorted.push_back(&i);
+		sort(tSorted.begin(), tSorted.end(), [](const pair<const string, fuInt>* a, const pair<const string, fuInt>* b) {
+			return a->first < b->first;
+		});
+
+		string tOutput;
+		for (auto i : tSorted)
+		{
+			tOutput.append(i->first);
+			tOutput.append(StringFormat(" %u\n", i->second));
+		}
+
+		fcyRefPointer<fcyFileStream> pFile;
+		pFile.DirectSet(new fcyFileStream(path.c_str(), true));
+		if (FCYFAILED(pFile->SetLength(0)) ||
+			FCYFAILED(pFile->WriteBytes((fcData)tOutput.data(), tOutput.size(), nullptr)))
+		{
+			LERROR("LuaSampler: 无法向文件'%s'写出采样结果", path.c_str());
+			return false;
+		}
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("LuaSampler: 内存不足");
+		return false;
+	}
+	catch (const fcyException& e)
+	{
+		LERROR("LuaSampler: 写出采样结果到'%s'失败 (异常信息'%m' 源'%m')", path.c_str(), e.GetDesc(), e.GetSrc());
+		return false;
+	}
+
+	if (m_iDroppedCount > 0)
+		LWARNING("LuaSampler: 内存不足，丢弃了%u个样本", m_iDroppedCount);
+	LINFO("LuaSampler: 采样结果已写出到'%s' (样本数: %u 调用栈数: %u)", path.c_str(), m_iSampleCount, (fuInt)m_Stacks.size());
+	return true;
+}
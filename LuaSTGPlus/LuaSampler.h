@@ -0,0 +1,69 @@
+﻿#pragma once
+#include "Global.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief lua采样分析器
+	/// @note  采样期间通过计数钩子每执行一定数量的虚拟机指令记录一次lua调用栈，
+	///        按栈聚合后以collapsed stack格式(每行"帧;帧;... 次数")写出，可直接用于生成火焰图。
+	///        每个样本以所处的引擎回调(如FrameFunc、对象帧函数)作为根帧。停止采样时钩子被移除，没有额外开销。
+	class LuaSampler
+	{
+	private:
+		lua_State* L = nullptr;  // 正在采样的虚拟机，未采样时为nullptr
+		const char* m_pContext = "Script";  // 当前的引擎回调
+		std::unordered_map<std::string, fuInt> m_Stacks;  // 调用栈 -> 样本数
+		fuInt m_iSampleCount = 0;
+		fuInt m_iDroppedCount = 0;  // 内存不足而丢弃的样本数
+	private:
+		static void hookFunc(lua_State* L, lua_Debug* ar);
+		void sample(lua_State* L)LNOEXCEPT;
+	public:
+		bool IsSampling()const LNOEXCEPT { return L != nullptr; }
+		fuInt GetSampleCount()const LNOEXCEPT { return m_iSampleCount; }
+
+		/// @brief 设置当前的引擎回调并返回之前的值
+		/// @note  由SamplerContext使用，name须为字符串常量
+		const char* SwapContext(const char* name)LNOEXCEPT
+		{
+			const char* tLast = m_pContext;
+			m_pContext = name;
+			return tLast;
+		}
+
+		/// @brief 开始采样
+		/// @param[in] interval 采样间隔(虚拟机指令数)
+		/// @note  已有的样本会被保留，多次开始与停止之间的样本累加在一起
+		void Start(lua_State* L, int interval)LNOEXCEPT;
+
+		/// @brief 停止采样
+		void Stop()LNOEXCEPT;
+
+		/// @brief 清空样本
+		void Clear()LNOEXCEPT;
+
+		/// @brief 以collapsed stack格式写出样本
+		bool Save(const std::wstring& path)LNOEXCEPT;
+	public:
+		LuaSampler() {}
+		~LuaSampler();
+	};
+
+	/// @brief 在作用域内标记样本所处的引擎回调
+	class SamplerContext
+	{
+	private:
+		LuaSampler& m_Sampler;
+		const char* m_pLast;
+	private:
+		SamplerContext& operator=(const SamplerContext&);
+		SamplerContext(const SamplerContext&);
+	public:
+		SamplerContext(LuaSampler& sampler, const char* name)
+			: m_Sampler(sampler), m_pLast(sampler.SwapContext(name)) {}
+		~SamplerContext()
+		{
+			m_Sampler.SwapContext(m_pLast);
+		}
+	};
+}
@@ -1,9 +1,11 @@
 ﻿#include "LuaWrapper.h"
 #include "AppFrame.h"
+#include "Profiler.h"
 
 #define TYPENAME_COLOR "lstgColor"
 #define TYPENAME_RANDGEN "lstgRand"
 #define TYPENAME_BENTLASER "lstgBentLaserData"
+#define TYPENAME_RESHANDLE "lstgResourceHandle"
 
 #ifdef min
 #undef min
@@ -227,7 +229,7 @@ void RandomizerWrapper::Register(lua_State* L)LNOEXCEPT
 		static int Seed(lua_State* L)LNOEXCEPT
 		{
 			fcyRandomWELL512* p = static_cast<fcyRandomWELL512*>(luaL_checkudata(L, 1, TYPENAME_RANDGEN));
-			p->SetSeed((fuInt)luaL_checknumber(L, 2));
+			p->SetSeed(LAPP.GetInputReplay().FilterSeed((fuInt)luaL_checknumber(L, 2)));
 			return 0;
 		}
 		static int GetSeed(lua_State* L)LNOEXCEPT
@@ -295,6 +297,8 @@ fcyRandomWELL512* RandomizerWrapper::CreateAndPush(lua_State* L)
 {
 	fcyRandomWELL512* p = static_cast<fcyRandomWELL512*>(lua_newuserdata(L, sizeof(fcyRandomWELL512)));
 	new(p) fcyRandomWELL512();  // 构造
+	if (LAPP.GetInputReplay().GetMode() != InputReplay::Mode::None)  // 录像时记录默认种子，回放时使用录像中的种子
+		p->SetSeed(LAPP.GetInputReplay().FilterSeed(p->GetRandSeed()));
 	luaL_getmetatable(L, TYPENAME_RANDGEN);
 	lua_setmetatable(L, -2);
 	return p;
@@ -424,16 +428,122 @@ void BentLaserDataWrapper::Register(lua_State* L)LNOEXCEPT
 	lua_pop(L, 2);
 }
 
-GameObjectBentLaser* BentLaserDataWrapper::CreateAndPush(lua_State* L)
+GameObjectBentLaser* BentLaserDataWrapper::CreateAndPush(lua_State* L, size_t maxNode)
 {
 	Wrapper* p = static_cast<Wrapper*>(lua_newuserdata(L, sizeof(Wrapper)));
-	p->handle = GameObjectBentLaser::AllocInstance();
+	p->handle = GameObjectBentLaser::AllocInstance(maxNode);
 	luaL_getmetatable(L, TYPENAME_BENTLASER);
 	lua_setmetatable(L, -2);
 	return p->handle;
 }
 #pragma endregion
 
+////////////////////////////////////////////////////////////////////////////////
+/// ResourceHandleWrapper
+////////////////////////////////////////////////////////////////////////////////
+#pragma region ResourceHandleWrapper
+void ResourceHandleWrapper::Register(lua_State* L)LNOEXCEPT
+{
+	struct WrapperImplement
+	{
+		static int GetName(lua_State* L)LNOEXCEPT
+		{
+			Wrapper* p = static_cast<Wrapper*>(luaL_checkudata(L, 1, TYPENAME_RESHANDLE));
+			lua_pushstring(L, reinterpret_cast<const char*>(p + 1));
+			return 1;
+		}
+		static int GetType(lua_State* L)LNOEXCEPT
+		{
+			Wrapper* p = static_cast<Wrapper*>(luaL_checkudata(L, 1, TYPENAME_RESHANDLE));
+			lua_pushinteger(L, static_cast<lua_Integer>(p->type));
+			return 1;
+		}
+		static int IsValid(lua_State* L)LNOEXCEPT
+		{
+			Wrapper* p = static_cast<Wrapper*>(luaL_checkudata(L, 1, TYPENAME_RESHANDLE));
+			lua_pushboolean(L, resolve(p) != nullptr);
+			return 1;
+		}
+		static int Meta_ToString(lua_State* L)LNOEXCEPT
+		{
+			Wrapper* p = static_cast<Wrapper*>(luaL_checkudata(L, 1, TYPENAME_RESHANDLE));
+			lua_pushfstring(L, "lstg.ResourceHandle object (%s)", reinterpret_cast<const char*>(p + 1));
+			return 1;
+		}
+	};
+
+	luaL_Reg tMethods[] =
+	{
+		{ "GetName", &WrapperImplement::GetName },
+		{ "GetType", &WrapperImplement::GetType },
+		{ "IsValid", &WrapperImplement::IsValid },
+		{ NULL, NULL }
+	};
+	luaL_Reg tMetaTable[] =
+	{
+		{ "__tostring", &WrapperImplement::Meta_ToString },
+		{ NULL, NULL }
+	};
+
+	luaL_openlib(L, TYPENAME_RESHANDLE, tMethods, 0);  // t
+	luaL_newmetatable(L, TYPENAME_RESHANDLE);  // t mt
+	luaL_openlib(L, 0, tMetaTable, 0);  // t mt
+	lua_pushliteral(L, "__index");  // t mt s
+	lua_pushvalue(L, -3);  // t mt s t
+	lua_rawset(L, -3);  // t mt (mt["__index"] = t)
+	lua_pushliteral(L, "__metatable");  // t mt s
+	lua_pushvalue(L, -3);  // t mt s t
+	lua_rawset(L, -3);  // t mt (mt["__metatable"] = t)  保护metatable不被修改
+	lua_pop(L, 2);
+}
+
+Resource* ResourceHandleWrapper::resolve(Wrapper* p)LNOEXCEPT
+{
+	// 资源代数未变时缓存的指针仍由资源池持有，否则按名称重新查找
+	// 查找失败时总是重试，以便资源被重新加载后句柄恢复可用
+	if (!p->handle || p->generation != LRES.GetResourceGeneration())
+	{
+		p->handle = LRES.FindResource(p->type, reinterpret_cast<const char*>(p + 1));
+		p->generation = LRES.GetResourceGeneration();
+	}
+	return p->handle;
+}
+
+Resource* ResourceHandleWrapper::CreateAndPush(lua_State* L, ResourceType t, const char* name)
+{
+	Resource* pRes = LRES.FindResource(t, name);
+	if (!pRes)
+		return nullptr;
+
+	size_t tLen = strlen(name);
+	Wrapper* p = static_cast<Wrapper*>(lua_newuserdata(L, sizeof(Wrapper) + tLen + 1));
+	p->type = t;
+	p->generation = LRES.GetResourceGeneration();
+	p->handle = pRes;
+	memcpy(p + 1, name, tLen + 1);
+	luaL_getmetatable(L, TYPENAME_RESHANDLE);
+	lua_setmetatable(L, -2);
+	return pRes;
+}
+
+Resource* ResourceHandleWrapper::CheckResource(lua_State* L, int idx, ResourceType t)
+{
+	Wrapper* p = static_cast<Wrapper*>(luaL_checkudata(L, idx, TYPENAME_RESHANDLE));
+	if (p->type != t)
+	{
+		luaL_error(L, "invalid resource type of handle '%s'.", reinterpret_cast<const char*>(p + 1));
+		return nullptr;
+	}
+	Resource* pRes = resolve(p);
+	if (!pRes)
+	{
+		luaL_error(L, "resource '%s' referenced by handle was removed.", reinterpret_cast<const char*>(p + 1));
+		return nullptr;
+	}
+	return pRes;
+}
+#pragma endregion
+
 ////////////////////////////////////////////////////////////////////////////////
 /// BuiltInFunctionWrapper
 ////////////////////////////////////////////////////////////////////////////////
@@ -492,6 +602,11 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			LAPP.SetTitle(luaL_checkstring(L, 1));
 			return 0;
 		}
+		static int SetWorkerCount(lua_State* L)LNOEXCEPT
+		{
+			LAPP.SetWorkerCount(luaL_checkinteger(L, 1));
+			return 0;
+		}
 		static int SystemLog(lua_State* L)LNOEXCEPT
 		{
 			LINFO("脚本日志：%m", luaL_checkstring(L, 1));
@@ -575,6 +690,12 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			LPOOL.DoFrame();
 			return 0;
 		}
+		static int UpdateParticles(lua_State* L)LNOEXCEPT
+		{
+			LPOOL.CheckIsMainThread(L);
+			LPOOL.UpdateParticles();
+			return 0;
+		}
 		static int ObjRender(lua_State* L)LNOEXCEPT
 		{
 			LPOOL.CheckIsMainThread(L);
@@ -603,6 +724,17 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			LPOOL.CollisionCheck(luaL_checkinteger(L, 1), luaL_checkinteger(L, 2));
 			return 0;
 		}
+		static int SetEventDeferred(lua_State* L)LNOEXCEPT
+		{
+			LPOOL.SetEventDeferred(lua_toboolean(L, 1) == 0 ? false : true);
+			return 0;
+		}
+		static int DispatchEvents(lua_State* L)LNOEXCEPT
+		{
+			LPOOL.CheckIsMainThread(L);
+			lua_pushinteger(L, (lua_Integer)LPOOL.DispatchEvents());
+			return 1;
+		}
 		static int UpdateXY(lua_State* L)LNOEXCEPT
 		{
 			LPOOL.CheckIsMainThread(L);
@@ -743,6 +875,32 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			LPOOL.ResetPool();
 			return 0;
 		}
+		static int SavePoolState(lua_State* L)LNOEXCEPT
+		{
+			lua_Integer slot = luaL_checkinteger(L, 1);
+			if (slot < 1 || slot > LGOBJ_SNAPSHOTCNT)
+				return luaL_error(L, "invalid argument #1 for 'SavePoolState', slot must be in range [1, %d].", LGOBJ_SNAPSHOTCNT);
+			if (!LPOOL.SaveSnapshot((size_t)slot - 1))
+				return luaL_error(L, "can't save pool state, out of memory.");
+			lua_pushinteger(L, (lua_Integer)LPOOL.GetSnapshotSize((size_t)slot - 1));
+			return 1;
+		}
+		static int LoadPoolState(lua_State* L)LNOEXCEPT
+		{
+			lua_Integer slot = luaL_checkinteger(L, 1);
+			if (slot < 1 || slot > LGOBJ_SNAPSHOTCNT)
+				return luaL_error(L, "invalid argument #1 for 'LoadPoolState', slot must be in range [1, %d].", LGOBJ_SNAPSHOTCNT);
+			lua_pushboolean(L, LPOOL.RestoreSnapshot((size_t)slot - 1));
+			return 1;
+		}
+		static int ClearPoolState(lua_State* L)LNOEXCEPT
+		{
+			lua_Integer slot = luaL_checkinteger(L, 1);
+			if (slot < 1 || slot > LGOBJ_SNAPSHOTCNT)
+				return luaL_error(L, "invalid argument #1 for 'ClearPoolState', slot must be in range [1, %d].", LGOBJ_SNAPSHOTCNT);
+			LPOOL.DropSnapshot((size_t)slot - 1);
+			return 0;
+		}
 		static int DefaultRenderFunc(lua_State* L)LNOEXCEPT
 		{
 			if (!lua_istable(L, 1))
@@ -792,6 +950,231 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{
 			return LPOOL.ParticleSetEmission(L);
 		}
+		static int SetParticleBudget(lua_State* L)LNOEXCEPT
+		{
+			lua_Integer budget = luaL_checkinteger(L, 1);
+			if (budget < 0)
+				return luaL_error(L, "invalid argument #1 for 'SetParticleBudget', budget must be non-negative.");
+			LPOOL.SetParticleBudget((size_t)budget);
+			return 0;
+		}
+		static int GetParticleBudget(lua_State* L)LNOEXCEPT
+		{
+			lua_pushinteger(L, (lua_Integer)LPOOL.GetParticleBudget());
+			lua_pushinteger(L, (lua_Integer)LPOOL.GetParticleTotal());
+			lua_pushinteger(L, (lua_Integer)LPOOL.GetParticleThrottledCount());
+			return 3;
+		}
+		static int GetPhaseTimings(lua_State* L)LNOEXCEPT
+		{
+			static const char* s_PhaseNames[] =
+			{
+				"frame",
+				"particle",
+				"boundcheck",
+				"collisioncheck",
+				"updatexy",
+				"afterframe"
+			};
+			static_assert(sizeof(s_PhaseNames) / sizeof(s_PhaseNames[0]) == (size_t)GameObjectPoolPhase::Count, "phase name mismatch.");
+
+			lua_createtable(L, 0, (int)GameObjectPoolPhase::Count);  // t
+			for (size_t i = 0; i < (size_t)GameObjectPoolPhase::Count; ++i)
+			{
+				lua_pushnumber(L, LPOOL.GetPhaseTime((GameObjectPoolPhase)i));  // t n
+				lua_setfield(L, -2, s_PhaseNames[i]);  // t
+			}
+			return 1;
+		}
+		static int SetClassStatsEnabled(lua_State* L)LNOEXCEPT
+		{
+			LPOOL.SetClassStatsEnabled(lua_toboolean(L, 1) == 0 ? false : true);
+			return 0;
+		}
+		static int GetClassStats(lua_State* L)LNOEXCEPT
+		{
+			static const char* s_TimeNames[] = { "frame", "render", "colli" };
+			static const char* s_CallNames[] = { "frame_calls", "render_calls", "colli_calls" };
+			static_assert(sizeof(s_TimeNames) / sizeof(s_TimeNames[0]) == (size_t)GameObjectCallback::Count, "callback name mismatch.");
+
+			// 同名的类合并统计
+			lua_newtable(L);  // t
+			for (auto& i : LPOOL.GetClassStats())
+			{
+				const GameObjectClassStats& tStats = i.second;
+				lua_getfield(L, -1, tStats.name.c_str());  // t t(class)|nil
+				if (lua_isnil(L, -1))
+				{
+					lua_pop(L, 1);  // t
+					lua_createtable(L, 0, 2 * (int)GameObjectCallback::Count);  // t t(class)
+					lua_pushvalue(L, -1);  // t t(class) t(class)
+					lua_setfield(L, -3, tStats.name.c_str());  // t t(class)
+				}
+				for (size_t j = 0; j < (size_t)GameObjectCallback::Count; ++j)
+				{
+					lua_getfield(L, -1, s_TimeNames[j]);  // t t(class) n
+					lua_Number tTime = lua_tonumber(L, -1) + tStats.time[j];
+					lua_pop(L, 1);  // t t(class)
+					lua_pushnumber(L, tTime);  // t t(class) n
+					lua_setfield(L, -2, s_TimeNames[j]);  // t t(class)
+					lua_getfield(L, -1, s_CallNames[j]);  // t t(class) n
+					lua_Number tCalls = lua_tonumber(L, -1) + (lua_Number)tStats.calls[j];
+					lua_pop(L, 1);  // t t(class)
+					lua_pushnumber(L, tCalls);  // t t(class) n
+					lua_setfield(L, -2, s_CallNames[j]);  // t t(class)
+				}
+				lua_pop(L, 1);  // t
+			}
+			if (lua_toboolean(L, 1))
+				LPOOL.ResetClassStats();
+			return 1;
+		}
+		static int GetRenderStats(lua_State* L)LNOEXCEPT
+		{
+			const RenderStats& tStats = LAPP.GetRenderStats();
+			lua_createtable(L, 0, 10);  // t
+			lua_pushinteger(L, (lua_Integer)tStats.drawCalls);  // t n
+			lua_setfield(L, -2, "draw_calls");  // t
+			lua_pushinteger(L, (lua_Integer)tStats.sprites);
+			lua_setfield(L, -2, "sprites");
+			lua_pushinteger(L, (lua_Integer)tStats.quads);
+			lua_setfield(L, -2, "quads");
+			lua_pushinteger(L, (lua_Integer)tStats.vertices);
+			lua_setfield(L, -2, "vertices");
+			lua_pushinteger(L, (lua_Integer)tStats.glyphs);
+			lua_setfield(L, -2, "glyphs");
+			lua_pushinteger(L, (lua_Integer)tStats.particles);
+			lua_setfield(L, -2, "particles");
+			lua_pushinteger(L, (lua_Integer)tStats.blendChanges);
+			lua_setfield(L, -2, "blend_changes");
+			lua_pushinteger(L, (lua_Integer)tStats.renderTargetPushes);
+			lua_setfield(L, -2, "rt_pushes");
+			lua_pushinteger(L, (lua_Integer)tStats.renderTargetPops);
+			lua_setfield(L, -2, "rt_pops");
+			lua_pushinteger(L, (lua_Integer)tStats.postEffects);
+			lua_setfield(L, -2, "post_effects");
+			return 1;
+		}
+		static int GetFrameStats(lua_State* L)LNOEXCEPT
+		{
+			static const char* s_HistogramNames[] = { "update", "render", "total" };
+
+			const FrameStats& tStats = LAPP.GetFrameStats();
+			const FrameTimeHistogram* tHistograms[] = { &tStats.update, &tStats.render, &tStats.total };
+			lua_createtable(L, 0, 3);  // t
+			for (size_t i = 0; i < 3; ++i)
+			{
+				const FrameTimeHistogram& h = *tHistograms[i];
+				lua_createtable(L, 0, 7);  // t t(histogram)
+				lua_pushinteger(L, (lua_Integer)h.GetCount());  // t t(histogram) n
+				lua_setfield(L, -2, "count");  // t t(histogram)
+				lua_pushnumber(L, h.GetMin());
+				lua_setfield(L, -2, "min");
+				lua_pushnumber(L, h.GetPercentile(50.));
+				lua_setfield(L, -2, "p50");
+				lua_pushnumber(L, h.GetPercentile(95.));
+				lua_setfield(L, -2, "p95");
+				lua_pushnumber(L, h.GetPercentile(99.));
+				lua_setfield(L, -2, "p99");
+				lua_pushnumber(L, h.GetMax());
+				lua_setfield(L, -2, "max");
+				lua_pushinteger(L, (lua_Integer)h.GetOverBudgetCount());
+				lua_setfield(L, -2, "over_budget");
+				lua_setfield(L, -2, s_HistogramNames[i]);  // t
+			}
+			if (lua_toboolean(L, 1))
+				LAPP.ResetFrameStats();
+			return 1;
+		}
+		static int BenchmarkScene(lua_State* L)LNOEXCEPT
+		{
+			const char* name = luaL_checkstring(L, 1);
+			BenchmarkReport& tReport = LAPP.GetBenchmarkReport();
+			if (tReport.IsEnabled())
+			{
+				try
+				{
+					tReport.BeginScene(name);
+				}
+				catch (const bad_alloc&)
+				{
+					return luaL_error(L, "can't begin benchmark scene, out of memory.");
+				}
+			}
+			lua_pushboolean(L, tReport.IsEnabled());
+			return 1;
+		}
+		static int ProfileBegin(lua_State* L)LNOEXCEPT
+		{
+			const char* name = luaL_checkstring(L, 1);
+			try
+			{
+				LPROFILER.BeginScriptZone(name);
+			}
+			catch (const bad_alloc&)
+			{
+				return luaL_error(L, "can't begin profile zone, out of memory.");
+			}
+			return 0;
+		}
+		static int ProfileEnd(lua_State* L)LNOEXCEPT
+		{
+			LPROFILER.EndScriptZone();
+			return 0;
+		}
+		static int ProfileCapture(lua_State* L)LNOEXCEPT
+		{
+			const char* path = luaL_checkstring(L, 1);
+			int frames = luaL_optinteger(L, 2, 60);
+			if (frames <= 0)
+				return luaL_error(L, "invalid frame count.");
+
+			wstring tPath;
+			try
+			{
+				tPath = fcyStringHelper::MultiByteToWideChar(path, CP_UTF8);
+			}
+			catch (const bad_alloc&)
+			{
+				return luaL_error(L, "can't begin profile capture, out of memory.");
+			}
+			lua_pushboolean(L, LPROFILER.BeginCapture(tPath, (fuInt)frames));
+			return 1;
+		}
+		static int StartSampling(lua_State* L)LNOEXCEPT
+		{
+			int interval = luaL_optinteger(L, 1, LSAMPLER_INTERVAL);
+			if (interval <= 0)
+				return luaL_error(L, "invalid sampling interval.");
+			// 钩子设置在主线程上，协程结束后不会失效
+			LAPP.GetLuaSampler().Start(LAPP.GetLuaEngine(), interval);
+			return 0;
+		}
+		static int StopSampling(lua_State* L)LNOEXCEPT
+		{
+			LuaSampler& tSampler = LAPP.GetLuaSampler();
+			tSampler.Stop();
+			if (lua_isnoneornil(L, 1))
+			{
+				lua_pushboolean(L, true);
+				return 1;
+			}
+
+			const char* path = luaL_checkstring(L, 1);
+			wstring tPath;
+			try
+			{
+				tPath = fcyStringHelper::MultiByteToWideChar(path, CP_UTF8);
+			}
+			catch (const bad_alloc&)
+			{
+				return luaL_error(L, "can't save samples, out of memory.");
+			}
+			bool tRet = tSampler.Save(tPath);
+			tSampler.Clear();
+			lua_pushboolean(L, tRet);
+			return 1;
+		}
 
 		// 资源控制函数
 		static int SetResourceStatus(lua_State* L)LNOEXCEPT
@@ -1096,6 +1479,14 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			LRES.GetResourcePool(ResourcePoolType::Stage)->ExportResourceList(L, tResourceType);
 			return 2;
 		}
+		static int GetResourceHandle(lua_State* L)LNOEXCEPT
+		{
+			ResourceType tResourceType = static_cast<ResourceType>(luaL_checkint(L, 1));
+			const char* tResourceName = luaL_checkstring(L, 2);
+			if (!ResourceHandleWrapper::CreateAndPush(L, tResourceType, tResourceName))
+				return luaL_error(L, "resource '%s' not found.", tResourceName);
+			return 1;
+		}
 		static int SetImageScale(lua_State* L)LNOEXCEPT
 		{
 			float x = static_cast<float>(luaL_checknumber(L, 1));
@@ -1111,6 +1502,8 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 				return luaL_error(L, "image '%s' not found.", luaL_checkstring(L, 1));
 
 			p->SetBlendMode(TranslateBlendMode(L, 2));
+			if (LAPP.IsHeadless())  // 无窗口模式下没有精灵对象
+				return 0;
 			if (lua_gettop(L) == 3)
 				p->GetSprite()->SetColor(*static_cast<fcyColor*>(luaL_checkudata(L, 3, TYPENAME_COLOR)));
 			else if (lua_gettop(L) == 6)
@@ -1146,6 +1539,8 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 				return luaL_error(L, "animation '%s' not found.", luaL_checkstring(L, 1));
 
 			p->SetBlendMode(TranslateBlendMode(L, 2));
+			if (LAPP.IsHeadless())  // 无窗口模式下没有精灵对象
+				return 0;
 			if (lua_gettop(L) == 3)
 			{
 				fcyColor c = *static_cast<fcyColor*>(luaL_checkudata(L, 3, TYPENAME_COLOR));
@@ -1170,6 +1565,8 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			ResSprite* p = LRES.FindSprite(luaL_checkstring(L, 1));
 			if (!p)
 				return luaL_error(L, "image '%s' not found.", luaL_checkstring(L, 1));
+			if (LAPP.IsHeadless())  // 无窗口模式下没有精灵对象
+				return 0;
 			p->GetSprite()->SetHotSpot(fcyVec2(
 				static_cast<float>(luaL_checknumber(L, 2) + p->GetSprite()->GetTexRect().a.x),
 				static_cast<float>(luaL_checknumber(L, 3) + p->GetSprite()->GetTexRect().a.y)));
@@ -1180,6 +1577,8 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			ResAnimation* p = LRES.FindAnimation(luaL_checkstring(L, 1));
 			if (!p)
 				return luaL_error(L, "animation '%s' not found.", luaL_checkstring(L, 1));
+			if (LAPP.IsHeadless())  // 无窗口模式下没有精灵对象
+				return 0;
 			for (size_t i = 0; i < p->GetCount(); ++i)
 			{
 				p->GetSprite(i)->SetHotSpot(fcyVec2(
@@ -1252,54 +1651,54 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		}
 		static int Render(lua_State* L)LNOEXCEPT
 		{
-			if (!LAPP.Render(
-				luaL_checkstring(L, 1),
-				static_cast<float>(luaL_checknumber(L, 2)),
-				static_cast<float>(luaL_checknumber(L, 3)),
-				static_cast<float>(luaL_optnumber(L, 4, 0.) * LDEGREE2RAD),
-				static_cast<float>(luaL_optnumber(L, 5, 1.) * LRES.GetGlobalImageScaleFactor()),
-				static_cast<float>(luaL_optnumber(L, 6, luaL_optnumber(L, 5, 1.)) * LRES.GetGlobalImageScaleFactor()),
-				static_cast<float>(luaL_optnumber(L, 7, 0.5))
-			))
+			float x = static_cast<float>(luaL_checknumber(L, 2));
+			float y = static_cast<float>(luaL_checknumber(L, 3));
+			float rot = static_cast<float>(luaL_optnumber(L, 4, 0.) * LDEGREE2RAD);
+			float hscale = static_cast<float>(luaL_optnumber(L, 5, 1.) * LRES.GetGlobalImageScaleFactor());
+			float vscale = static_cast<float>(luaL_optnumber(L, 6, luaL_optnumber(L, 5, 1.)) * LRES.GetGlobalImageScaleFactor());
+			float z = static_cast<float>(luaL_optnumber(L, 7, 0.5));
+
+			if (lua_isuserdata(L, 1))  // 资源句柄，省去按名称查找
 			{
-				return luaL_error(L, "can't render '%m'", luaL_checkstring(L, 1));
+				ResSprite* p = static_cast<ResSprite*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::Sprite));
+				if (!LAPP.Render(p, x, y, rot, hscale, vscale, z))
+					return luaL_error(L, "can't render '%s'", p->GetResName().c_str());
 			}
+			else if (!LAPP.Render(luaL_checkstring(L, 1), x, y, rot, hscale, vscale, z))
+				return luaL_error(L, "can't render '%m'", luaL_checkstring(L, 1));
 			return 0;
 		}
 		static int RenderRect(lua_State* L)LNOEXCEPT
 		{
-			if (!LAPP.RenderRect(
-				luaL_checkstring(L, 1),
-				static_cast<float>(luaL_checknumber(L, 2)),
-				static_cast<float>(luaL_checknumber(L, 5)),
-				static_cast<float>(luaL_checknumber(L, 3)),
-				static_cast<float>(luaL_checknumber(L, 4))
-			))
+			float x1 = static_cast<float>(luaL_checknumber(L, 2));
+			float y1 = static_cast<float>(luaL_checknumber(L, 5));
+			float x2 = static_cast<float>(luaL_checknumber(L, 3));
+			float y2 = static_cast<float>(luaL_checknumber(L, 4));
+
+			if (lua_isuserdata(L, 1))
 			{
-				return luaL_error(L, "can't render '%m'", luaL_checkstring(L, 1));
+				ResSprite* p = static_cast<ResSprite*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::Sprite));
+				if (!LAPP.RenderRect(p, x1, y1, x2, y2))
+					return luaL_error(L, "can't render '%s'", p->GetResName().c_str());
 			}
+			else if (!LAPP.RenderRect(luaL_checkstring(L, 1), x1, y1, x2, y2))
+				return luaL_error(L, "can't render '%m'", luaL_checkstring(L, 1));
 			return 0;
 		}
 		static int Render4V(lua_State* L)LNOEXCEPT
 		{
-			if (!LAPP.Render4V(
-				luaL_checkstring(L, 1),
-				static_cast<float>(luaL_checknumber(L, 2)),
-				static_cast<float>(luaL_checknumber(L, 3)),
-				static_cast<float>(luaL_checknumber(L, 4)),
-				static_cast<float>(luaL_checknumber(L, 5)),
-				static_cast<float>(luaL_checknumber(L, 6)),
-				static_cast<float>(luaL_checknumber(L, 7)),
-				static_cast<float>(luaL_checknumber(L, 8)),
-				static_cast<float>(luaL_checknumber(L, 9)),
-				static_cast<float>(luaL_checknumber(L, 10)),
-				static_cast<float>(luaL_checknumber(L, 11)),
-				static_cast<float>(luaL_checknumber(L, 12)),
-				static_cast<float>(luaL_checknumber(L, 13))
-			))
+			float v[12];
+			for (int i = 0; i < 12; ++i)
+				v[i] = static_cast<float>(luaL_checknumber(L, 2 + i));
+
+			if (lua_isuserdata(L, 1))
 			{
-				return luaL_error(L, "can't render '%m'.", luaL_checkstring(L, 1));
+				ResSprite* p = static_cast<ResSprite*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::Sprite));
+				if (!LAPP.Render4V(p, v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10], v[11]))
+					return luaL_error(L, "can't render '%s'.", p->GetResName().c_str());
 			}
+			else if (!LAPP.Render4V(luaL_checkstring(L, 1), v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10], v[11]))
+				return luaL_error(L, "can't render '%m'.", luaL_checkstring(L, 1));
 			return 0;
 		}
 		static int RenderText(lua_State* L)LNOEXCEPT
@@ -1308,23 +1707,32 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 			ResFont::FontAlignVertical valign = ResFont::FontAlignVertical::Middle;
 			if (lua_gettop(L) == 6)
 				TranslateAlignMode(L, 6, halign, valign);
-			if (!LAPP.RenderText(
-				luaL_checkstring(L, 1),
-				luaL_checkstring(L, 2),
-				(float)luaL_checknumber(L, 3),
-				(float)luaL_checknumber(L, 4),
-				(float)(luaL_optnumber(L, 5, 1.0) * LRES.GetGlobalImageScaleFactor()),
-				halign,
-				valign
-				))
+			const char* str = luaL_checkstring(L, 2);
+			float x = (float)luaL_checknumber(L, 3);
+			float y = (float)luaL_checknumber(L, 4);
+			float scale = (float)(luaL_optnumber(L, 5, 1.0) * LRES.GetGlobalImageScaleFactor());
+
+			if (lua_isuserdata(L, 1))
 			{
+				ResFont* p = static_cast<ResFont*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::SpriteFont));
+				if (!LAPP.RenderText(p, str, x, y, scale, halign, valign))
+					return luaL_error(L, "can't draw text '%s'.", p->GetResName().c_str());
+			}
+			else if (!LAPP.RenderText(luaL_checkstring(L, 1), str, x, y, scale, halign, valign))
 				return luaL_error(L, "can't draw text '%m'.", luaL_checkstring(L, 1));
-			}	
 			return 0;
 		}
 		static int RenderTexture(lua_State* L)LNOEXCEPT
 		{
-			const char* tex_name = luaL_checkstring(L, 1);
+			ResTexture* tex = nullptr;
+			const char* tex_name = nullptr;
+			if (lua_isuserdata(L, 1))
+			{
+				tex = static_cast<ResTexture*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::Texture));
+				tex_name = tex->GetResName().c_str();
+			}
+			else
+				tex_name = luaL_checkstring(L, 1);
 			BlendMode blend = TranslateBlendMode(L, 2);
 			f2dGraphics2DVertex vertex[4];
 
@@ -1357,26 +1765,29 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 				lua_pop(L, 6);
 			}
 
-			if (!LAPP.RenderTexture(tex_name, blend, vertex))
+			if (!(tex ? LAPP.RenderTexture(tex, blend, vertex) : LAPP.RenderTexture(tex_name, blend, vertex)))
 				return luaL_error(L, "can't render texture '%s'.", tex_name);
 			return 0;
 		}
 		static int RenderTTF(lua_State* L)LNOEXCEPT
 		{
-			if (!LAPP.RenderTTF(
-				luaL_checkstring(L, 1),
-				luaL_checkstring(L, 2),
-				(float)luaL_checknumber(L, 3),
-				(float)luaL_checknumber(L, 4),
-				(float)luaL_checknumber(L, 5),
-				(float)luaL_checknumber(L, 6),
-				LRES.GetGlobalImageScaleFactor() * (float)luaL_optnumber(L, 9, 1.0),
-				luaL_checkinteger(L, 7),
-				*static_cast<fcyColor*>(luaL_checkudata(L, 8, TYPENAME_COLOR))
-			))
+			const char* str = luaL_checkstring(L, 2);
+			float left = (float)luaL_checknumber(L, 3);
+			float right = (float)luaL_checknumber(L, 4);
+			float bottom = (float)luaL_checknumber(L, 5);
+			float top = (float)luaL_checknumber(L, 6);
+			float scale = LRES.GetGlobalImageScaleFactor() * (float)luaL_optnumber(L, 9, 1.0);
+			int format = (int)luaL_checkinteger(L, 7);
+			fcyColor c = *static_cast<fcyColor*>(luaL_checkudata(L, 8, TYPENAME_COLOR));
+
+			if (lua_isuserdata(L, 1))
 			{
+				ResFont* p = static_cast<ResFont*>(ResourceHandleWrapper::CheckResource(L, 1, ResourceType::TrueTypeFont));
+				if (!LAPP.RenderTTF(p, str, left, right, bottom, top, scale, format, c))
+					return luaL_error(L, "can't render font '%s'.", p->GetResName().c_str());
+			}
+			else if (!LAPP.RenderTTF(luaL_checkstring(L, 1), str, left, right, bottom, top, scale, format, c))
 				return luaL_error(L, "can't render font '%s'.", luaL_checkstring(L, 1));
-			}	
 			return 0;
 		}
 		static int RegTTF(lua_State* L)LNOEXCEPT
@@ -1781,6 +2192,14 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{
 			return LPOOL.GetObjectTable(L);
 		}
+		static int GetParticleMemoryStat(lua_State* L)LNOEXCEPT
+		{
+			lua_pushinteger(L, (lua_Integer)ResParticle::GetMemoryUsage());
+			lua_pushinteger(L, (lua_Integer)ResParticle::GetMemoryPeak());
+			if (lua_toboolean(L, 1))
+				ResParticle::ResetMemoryPeak();
+			return 2;
+		}
 
 		// 对象构造函数
 		static int NewColor(lua_State* L)LNOEXCEPT
@@ -1807,7 +2226,11 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		}
 		static int BentLaserData(lua_State* L)LNOEXCEPT
 		{
-			BentLaserDataWrapper::CreateAndPush(L);
+			// 可选参数指定最大节点数，较短的激光可以占用更小的节点存储
+			lua_Integer maxNode = luaL_optinteger(L, 1, LGOBJ_MAXLASERNODE);
+			if (maxNode <= 1 || maxNode > LGOBJ_MAXLASERNODE)
+				return luaL_error(L, "invalid argument #1 for 'BentLaserData', max node count must be in range [2, %d].", LGOBJ_MAXLASERNODE);
+			BentLaserDataWrapper::CreateAndPush(L, (size_t)maxNode);
 			return 1;
 		}
 	};
@@ -1823,6 +2246,7 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "ChangeVideoMode", &WrapperImplement::ChangeVideoMode },
 		{ "SetSplash", &WrapperImplement::SetSplash },
 		{ "SetTitle", &WrapperImplement::SetTitle },
+		{ "SetWorkerCount", &WrapperImplement::SetWorkerCount },
 		{ "SystemLog", &WrapperImplement::SystemLog },
 		{ "Print", &WrapperImplement::Print },
 		{ "LoadPack", &WrapperImplement::LoadPack },
@@ -1834,11 +2258,14 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "GetnObj", &WrapperImplement::GetnObj },
 		{ "UpdateObjList", &WrapperImplement::UpdateObjList },
 		{ "ObjFrame", &WrapperImplement::ObjFrame },
+		{ "UpdateParticles", &WrapperImplement::UpdateParticles },
 		{ "ObjRender", &WrapperImplement::ObjRender },
 		{ "BoundCheck", &WrapperImplement::BoundCheck },
 		{ "SetBound", &WrapperImplement::SetBound },
 		{ "BoxCheck", &WrapperImplement::BoxCheck },
 		{ "CollisionCheck", &WrapperImplement::CollisionCheck },
+		{ "SetEventDeferred", &WrapperImplement::SetEventDeferred },
+		{ "DispatchEvents", &WrapperImplement::DispatchEvents },
 		{ "UpdateXY", &WrapperImplement::UpdateXY },
 		{ "AfterFrame", &WrapperImplement::AfterFrame },
 		{ "New", &WrapperImplement::New },
@@ -1851,6 +2278,9 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "SetV", &WrapperImplement::SetV },
 		{ "SetImgState", &WrapperImplement::SetImgState },
 		{ "ResetPool", &WrapperImplement::ResetPool },
+		{ "SavePoolState", &WrapperImplement::SavePoolState },
+		{ "LoadPoolState", &WrapperImplement::LoadPoolState },
+		{ "ClearPoolState", &WrapperImplement::ClearPoolState },
 		{ "DefaultRenderFunc", &WrapperImplement::DefaultRenderFunc },
 		{ "NextObject", &WrapperImplement::NextObject },
 		{ "ObjList", &WrapperImplement::ObjList },
@@ -1861,6 +2291,19 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "ParticleGetn", &WrapperImplement::ParticleGetn },
 		{ "ParticleGetEmission", &WrapperImplement::ParticleGetEmission },
 		{ "ParticleSetEmission", &WrapperImplement::ParticleSetEmission },
+		{ "SetParticleBudget", &WrapperImplement::SetParticleBudget },
+		{ "GetParticleBudget", &WrapperImplement::GetParticleBudget },
+		{ "GetPhaseTimings", &WrapperImplement::GetPhaseTimings },
+		{ "SetClassStatsEnabled", &WrapperImplement::SetClassStatsEnabled },
+		{ "GetClassStats", &WrapperImplement::GetClassStats },
+		{ "GetRenderStats", &WrapperImplement::GetRenderStats },
+		{ "GetFrameStats", &WrapperImplement::GetFrameStats },
+		{ "BenchmarkScene", &WrapperImplement::BenchmarkScene },
+		{ "ProfileBegin", &WrapperImplement::ProfileBegin },
+		{ "ProfileEnd", &WrapperImplement::ProfileEnd },
+		{ "ProfileCapture", &WrapperImplement::ProfileCapture },
+		{ "StartSampling", &WrapperImplement::StartSampling },
+		{ "StopSampling", &WrapperImplement::StopSampling },
 		// 资源控制函数
 		{ "SetResourceStatus", &WrapperImplement::SetResourceStatus },
 		{ "LoadTexture", &WrapperImplement::LoadTexture },
@@ -1879,6 +2322,7 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "RemoveResource", &WrapperImplement::RemoveResource },
 		{ "CheckRes", &WrapperImplement::CheckRes },
 		{ "EnumRes", &WrapperImplement::EnumRes },
+		{ "GetResourceHandle", &WrapperImplement::GetResourceHandle },
 		{ "SetImageScale", &WrapperImplement::SetImageScale },
 		{ "SetImageState", &WrapperImplement::SetImageState },
 		{ "SetFontState", &WrapperImplement::SetFontState },
@@ -1937,6 +2381,7 @@ void BuiltInFunctionWrapper::Register(lua_State* L)LNOEXCEPT
 		{ "Execute", &WrapperImplement::Execute },
 		// 调试函数
 		{ "ObjTable", &WrapperImplement::ObjTable },
+		{ "GetParticleMemoryStat", &WrapperImplement::GetParticleMemoryStat },
 		// 对象构造函数
 		{ "Color", &WrapperImplement::NewColor },
 		{ "Rand", &WrapperImplement::NewRand },
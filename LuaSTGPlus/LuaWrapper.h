@@ -39,7 +39,36 @@ namespace LuaSTGPlus
 		/// @brief luaעװ
 		static void Register(lua_State* L)LNOEXCEPT;
 		/// @brief һ߼ಢջ
-		static GameObjectBentLaser* CreateAndPush(lua_State* L);
+		/// @param[in] maxNode ڵ
+		static GameObjectBentLaser* CreateAndPush(lua_State* L, size_t maxNode = LGOBJ_MAXLASERNODE);
+	};
+
+	class Resource;
+	enum class ResourceType;
+
+	/// @brief Դװ
+	/// @note Դָ룬Դı²ңԴ
+	class ResourceHandleWrapper
+	{
+	private:
+		struct Wrapper
+		{
+			ResourceType type;
+			fuInt generation;
+			Resource* handle;
+			// Դ
+		};
+	private:
+		static Resource* resolve(Wrapper* p)LNOEXCEPT;
+	public:
+		/// @brief luaעװ
+		static void Register(lua_State* L)LNOEXCEPT;
+		/// @brief һԴջ
+		/// @return ԴʱnullptrҲκֵ
+		static Resource* CreateAndPush(lua_State* L, ResourceType t, const char* name);
+		/// @brief ӾȡԴ
+		/// @note ͲԴѱƳʱlua
+		static Resource* CheckResource(lua_State* L, int idx, ResourceType t);
 	};
 
 	/// @brief ڽװ
@@ -23,7 +23,8 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 	// ʼ
 	if (!LAPP.Init())
 	{
-		MessageBox(0, StringFormat(INIT_FAILED_DESC, LLOGFILE).c_str(), L"LuaSTGPlusʼʧ", MB_ICONERROR | MB_OK);
+		if (!LAPP.IsHeadless())
+			MessageBox(0, StringFormat(INIT_FAILED_DESC, LLOGFILE).c_str(), L"LuaSTGPlusʼʧ", MB_ICONERROR | MB_OK);
 		return -1;
 	}
 
@@ -32,5 +33,5 @@ int WINAPI WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 
 	// 
 	LAPP.Shutdown();
-	return 0;
+	return LAPP.GetExitCode();
 }
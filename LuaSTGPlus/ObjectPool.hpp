@@ -51,6 +51,20 @@ namespace LuaSTGPlus
 		{
 			return m_DataBuffer.size() - m_FreeIndex.size();
 		}
+		/// @brief ȡпռ
+		const std::vector<size_t>& GetFreeIndex()const
+		{
+			return m_FreeIndex;
+		}
+		/// @brief пռָ״̬
+		/// @note  ڱеĿռΪѷ䣬ݲ޸
+		void RestoreFreeIndex(const size_t* index, size_t count)
+		{
+			m_FreeIndex.assign(index, index + count);
+			m_DataUsed.fill(true);
+			for (size_t i = 0; i < count; ++i)
+				m_DataUsed[index[i]] = false;
+		}
 		/// @brief նزж
 		void Clear()
 		{
@@ -0,0 +1,115 @@
+﻿#pragma once
+#include "Global.h"
+#include "ResourceMgr.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 粒子四边形生成器
+	/// @note  由绑定精灵的参数直接生成顶点，结果同对每个粒子设置精灵颜色后调用f2dSprite::Draw2，
+	///        与逐个绘制的差分测试见RenderTest
+	class ParticleQuadBuilder
+	{
+	private:
+		fcyVec2 m_Corner[4];  // 以热点为原点、已乘以渲染缩放的四边形(左上、右上、右下、左下)，与f2dSprite的顶点布局一致
+		fcyVec2 m_UV[4];  // 规范化的纹理坐标
+		float m_fZ;
+		fcyColor m_OrgColor;  // 精灵原有的颜色
+		bool m_bAlphaOnly;  // 是否只取粒子颜色的alpha，rgb沿用精灵原有的颜色
+	public:
+		/// @brief 生成第i个粒子的4个顶点
+		void Build(const ResParticle::ParticleStorage& d, size_t i, f2dGraphics2DVertex* out)const LNOEXCEPT
+		{
+			fuInt tColor;
+			if (m_bAlphaOnly)
+				tColor = fcyColor((int)(d.colColor[3][i] * 255), m_OrgColor.r, m_OrgColor.g, m_OrgColor.b).argb;
+			else
+				tColor = fcyColor(d.colColor[3][i], d.colColor[0][i], d.colColor[1][i], d.colColor[2][i]).argb;
+
+			float tSin = sin(d.fSpin[i]);
+			float tCos = cos(d.fSpin[i]);
+			float tScale = d.fSize[i];
+			for (int k = 0; k < 4; ++k)
+			{
+				float x = m_Corner[k].x * tScale;
+				float y = m_Corner[k].y * tScale;
+				out[k].x = x * tCos - y * tSin + d.vecLocationX[i];
+				out[k].y = x * tSin + y * tCos + d.vecLocationY[i];
+				out[k].z = m_fZ;
+				out[k].color = tColor;
+				out[k].u = m_UV[k].x;
+				out[k].v = m_UV[k].y;
+			}
+		}
+	public:
+		/// @param[in] texRect 精灵在纹理上的区域(纹素)
+		/// @param[in] hotSpot 精灵热点，相对texRect左上角
+		/// @param[in] alphaOnly 粒子颜色的r小于0时为true
+		ParticleQuadBuilder(const fcyRect& texRect, fcyVec2 hotSpot, float texWidth, float texHeight, float z,
+			fcyColor orgColor, bool alphaOnly, float scaleX, float scaleY)
+			: m_fZ(z), m_OrgColor(orgColor), m_bAlphaOnly(alphaOnly)
+		{
+			float tLeft = -hotSpot.x;
+			float tRight = texRect.GetWidth() - hotSpot.x;
+			float tTop = hotSpot.y;
+			float tBottom = hotSpot.y - texRect.GetHeight();
+			m_Corner[0].Set(tLeft * scaleX, tTop * scaleY);
+			m_Corner[1].Set(tRight * scaleX, tTop * scaleY);
+			m_Corner[2].Set(tRight * scaleX, tBottom * scaleY);
+			m_Corner[3].Set(tLeft * scaleX, tBottom * scaleY);
+
+			fcyRect tUV(texRect.a.x / texWidth, texRect.a.y / texHeight, texRect.b.x / texWidth, texRect.b.y / texHeight);
+			m_UV[0].Set(tUV.a.x, tUV.a.y);
+			m_UV[1].Set(tUV.b.x, tUV.a.y);
+			m_UV[2].Set(tUV.b.x, tUV.b.y);
+			m_UV[3].Set(tUV.a.x, tUV.b.y);
+		}
+	};
+
+	/// @brief 所有粒子池共享的索引缓冲，每个粒子对应一个四边形
+	inline const fuShort* GetParticleIndexBuffer()LNOEXCEPT
+	{
+		struct IndexBuffer
+		{
+			fuShort Data[LPARTICLE_BATCHSIZE * 6];
+
+			IndexBuffer()
+			{
+				for (fuShort i = 0; i < LPARTICLE_BATCHSIZE; ++i)
+				{
+					fuShort* p = &Data[i * 6];
+					p[0] = i * 4;
+					p[1] = i * 4 + 1;
+					p[2] = i * 4 + 2;
+					p[3] = i * 4;
+					p[4] = i * 4 + 2;
+					p[5] = i * 4 + 3;
+				}
+			}
+		};
+		static const IndexBuffer s_IndexBuffer;
+		return s_IndexBuffer.Data;
+	}
+
+	/// @brief 按批生成前count个粒子的顶点并提交，单批粒子数受渲染器顶点缓冲大小限制
+	/// @param[in] submit 形如bool(const f2dGraphics2DVertex* vertex, fuInt vertCount, const fuShort* index, fuInt indexCount)，返回false时中止
+	/// @return 所有批次都提交成功时返回true
+	template <typename Submit>
+	bool SubmitParticleBatches(const ParticleQuadBuilder& builder, const ResParticle::ParticleStorage& d, size_t count, Submit submit)
+	{
+		static f2dGraphics2DVertex s_ParticleVertex[LPARTICLE_BATCHSIZE * 4];
+		const fuShort* pIndex = GetParticleIndexBuffer();
+
+		size_t tBatchCount = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			builder.Build(d, i, &s_ParticleVertex[tBatchCount * 4]);
+			if (++tBatchCount == LPARTICLE_BATCHSIZE || i + 1 == count)
+			{
+				if (!submit(s_ParticleVertex, (fuInt)(tBatchCount * 4), pIndex, (fuInt)(tBatchCount * 6)))
+					return false;
+				tBatchCount = 0;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,269 @@
+﻿#include "Profiler.h"
+#include "Utility.h"
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+// 当前线程的缓冲区槽位，-1表示尚未分配，-2表示槽位已用尽
+static __declspec(thread) int s_iThreadSlot = -1;
+
+Profiler& Profiler::GetInstance()
+{
+	static Profiler s_Instance;
+	return s_Instance;
+}
+
+Profiler::Profiler()
+	: m_bCapturing(false), m_iThreadCount(0), m_bThreadRefused(false)
+{
+	LARGE_INTEGER tFreq;
+	QueryPerformanceFrequency(&tFreq);
+	m_iFrequency = tFreq.QuadPart;
+}
+
+int64_t Profiler::Now()LNOEXCEPT
+{
+	LARGE_INTEGER tCounter;
+	QueryPerformanceCounter(&tCounter);
+	return tCounter.QuadPart;
+}
+
+void Profiler::RegisterThread(const char* name)LNOEXCEPT
+{
+	if (s_iThreadSlot != -1)
+		return;
+
+	int tSlot = m_iThreadCount.fetch_add(1);
+	if (tSlot < (int)_countof(m_Buffers))
+	{
+		s_iThreadSlot = tSlot;
+		m_Buffers[tSlot].name = name;
+	}
+	else
+	{
+		s_iThreadSlot = -2;
+		if (!m_bThreadRefused.exchange(true))
+			LWARNING("Profiler: 线程缓冲区已用尽，线程'%m'上的区域将不被记录", name);
+	}
+}
+
+Profiler::ThreadBuffer* Profiler::getThreadBuffer()LNOEXCEPT
+{
+	if (s_iThreadSlot == -1)
+		RegisterThread("Thread");
+	if (s_iThreadSlot < 0)
+		return nullptr;
+
+	ThreadBuffer* p = &m_Buffers[s_iThreadSlot];
+	if (!p->events)
+	{
+		try
+		{
+			p->events.reset(new Event[LPROFILER_EVENTCNT]);
+		}
+		catch (const bad_alloc&)
+		{
+			return nullptr;
+		}
+	}
+	return p;
+}
+
+void Profiler::Record(const char* name, int64_t begin, int64_t end)LNOEXCEPT
+{
+	if (!IsCapturing())
+		return;
+
+	ThreadBuffer* p = getThreadBuffer();
+	if (!p)
+		return;
+	if (p->count >= LPROFILER_EVENTCNT)
+	{
+		++p->dropped;
+		return;
+	}
+	Event& e = p->events[p->count++];
+	e.name = name;
+	e.begin = begin;
+	e.end = end;
+}
+
+bool Profiler::BeginCapture(const wstring& path, fuInt frames)LNOEXCEPT
+{
+	if (IsCapturing() || m_bCapturePending)
+		return false;
+
+	try
+	{
+		m_Path = path;
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("Profiler: 内存不足");
+		return false;
+	}
+	m_iFramesLeft = max(frames, 1U);
+	m_bCapturePending = true;
+	return true;
+}
+
+void Profiler::FrameMark()LNOEXCEPT
+{
+	int64_t tNow = Now();
+
+	if (IsCapturing())
+	{
+		Record("Frame", m_iFrameBegin, tNow);
+		m_iFrameBegin = tNow;
+		if (--m_iFramesLeft == 0)
+			EndCapture();
+	}
+	else if (m_bCapturePending)
+	{
+		// 捕获开始前各线程都不会写入缓冲区，可以直接清空
+		for (ThreadBuffer& b : m_Buffers)
+		{
+			b.count = 0;
+			b.dropped = 0;
+		}
+		m_bCapturePending = false;
+		m_iCaptureBegin = m_iFrameBegin = tNow;
+		m_bCapturing.store(true);
+		LINFO("Profiler: 开始捕获%u帧", m_iFramesLeft);
+	}
+}
+
+void Profiler::EndCapture()LNOEXCEPT
+{
+	if (!IsCapturing())
+	{
+		m_bCapturePending = false;
+		return;
+	}
+
+	// 帧边界上工作线程没有任务在执行，停止后缓冲区不再被写入
+	m_bCapturing.store(false);
+	save();
+
+	// 仍未结束的区域保留嵌套关系，但不再记录
+	for (ScriptZone& z : m_ScriptZoneStack)
+		z.name = nullptr;
+	m_ScriptZoneNames.clear();
+}
+
+void Profiler::BeginScriptZone(const char* name)
+{
+	if (m_ScriptZoneStack.size() >= LPROFILER_MAXSCRIPTDEPTH)
+	{
+		++m_iScriptZoneOverflow;
+		return;
+	}
+
+	ScriptZone tZone = { nullptr, 0 };
+	if (IsCapturing())
+	{
+		tZone.name = m_ScriptZoneNames.insert(name).first->c_str();
+		tZone.begin = Now();
+	}
+	m_ScriptZoneStack.push_back(tZone);
+}
+
+void Profiler::EndScriptZone()LNOEXCEPT
+{
+	if (m_iScriptZoneOverflow > 0)
+	{
+		--m_iScriptZoneOverflow;
+		return;
+	}
+	if (m_ScriptZoneStack.empty())
+		return;
+
+	ScriptZone tZone = m_ScriptZoneStack.back();
+	m_ScriptZoneStack.pop_back();
+	if (tZone.name && IsCapturing())
+		Record(tZone.name, tZone.begin, Now());
+}
+
+// 写出JSON字符串，转义引号、反斜杠与控制字符
+static void AppendJsonString(string& out, const char* s)
+{
+	out.push_back('"');
+	for (; *s; ++s)
+	{
+		char c = *s;
+		if (c == '"' || c == '\\')
+		{
+			out.push_back('\\');
+			out.push_back(c);
+		}
+		else if ((unsigned char)c < 0x20)
+			out.push_back(' ');
+		else
+			out.push_back(c);
+	}
+	out.push_back('"');
+}
+
+bool Profiler::save()LNOEXCEPT
+{
+	size_t tEventCount = 0, tDropped = 0;
+	try
+	{
+		string tJson;
+		tJson.reserve(1024 * 1024);
+		tJson.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+		bool tFirst = true;
+		double tScale = 1000000. / (double)m_iFrequency;  // 转换为微秒
+		int tThreadCount = min(m_iThreadCount.load(), (int)_countof(m_Buffers));
+		for (int i = 0; i < tThreadCount; ++i)
+		{
+			const ThreadBuffer& b = m_Buffers[i];
+
+			// 线程名
+			tJson.append(tFirst ? "\n" : ",\n");
+			tFirst = false;
+			tJson.append(StringFormat("{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", i));
+			AppendJsonString(tJson, b.name ? b.name : "Thread");
+			tJson.append("}}");
+
+			for (size_t j = 0; j < b.count; ++j)
+			{
+				const Event& e = b.events[j];
+				tJson.append(",\n{\"ph\":\"X\",\"pid\":1,\"tid\":");
+				tJson.append(to_string(i));
+				tJson.append(",\"name\":");
+				AppendJsonString(tJson, e.name);
+				tJson.append(StringFormat(",\"ts\":%f,\"dur\":%f}",
+					(double)(e.begin - m_iCaptureBegin) * tScale, (double)(e.end - e.begin) * tScale));
+			}
+			tEventCount += b.count;
+			tDropped += b.dropped;
+		}
+		tJson.append("\n]}\n");
+
+		fcyRefPointer<fcyFileStream> pFile;
+		pFile.DirectSet(new fcyFileStream(m_Path.c_str(), true));
+		if (FCYFAILED(pFile->SetLength(0)) ||
+			FCYFAILED(pFile->WriteBytes((fcData)tJson.data(), tJson.size(), nullptr)))
+		{
+			LERROR("Profiler: 无法向文件'%s'写出捕获结果", m_Path.c_str());
+			return false;
+		}
+	}
+	catch (const bad_alloc&)
+	{
+		LERROR("Profiler: 内存不足");
+		return false;
+	}
+	catch (const fcyException& e)
+	{
+		LERROR("Profiler: 写出捕获结果到'%s'失败 (异常信息'%m' 源'%m')", m_Path.c_str(), e.GetDesc(), e.GetSrc());
+		return false;
+	}
+
+	if (tDropped > 0)
+		LWARNING("Profiler: 缓冲区已满，丢弃了%u个事件", (fuInt)tDropped);
+	LINFO("Profiler: 捕获结果已写出到'%s' (事件数: %u)", m_Path.c_str(), (fuInt)tEventCount);
+	return true;
+}
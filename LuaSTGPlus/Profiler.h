@@ -0,0 +1,137 @@
+﻿#pragma once
+#include "Global.h"
+
+#include <atomic>
+
+#define LPROFILER (LuaSTGPlus::Profiler::GetInstance())
+
+#define LPROFILE_CONCAT_(a, b) a ## b
+#define LPROFILE_CONCAT(a, b) LPROFILE_CONCAT_(a, b)
+
+/// @brief 在当前作用域上定义一个分析区域，name须为字符串常量
+#define LPROFILE_ZONE(name) LuaSTGPlus::ProfileZone LPROFILE_CONCAT(tProfileZone, __LINE__)(name)
+
+namespace LuaSTGPlus
+{
+	/// @brief 帧分析器
+	/// @note  捕获期间各线程把区域事件写入自己的缓冲区，写入时不加锁。
+	///        捕获指定帧数后由主线程在帧边界上导出为Chrome trace格式的JSON文件(chrome://tracing)。
+	///        下文的主线程均指执行OnUpdate/OnRender的游戏循环线程，多线程窗口模式下它不是调用AppFrame::Init的线程。
+	class Profiler
+	{
+	public:
+		/// @brief 获取分析器实例
+		static LNOINLINE Profiler& GetInstance();
+	private:
+		/// @brief 区域事件
+		struct Event
+		{
+			const char* name;
+			int64_t begin;
+			int64_t end;
+		};
+
+		/// @brief 线程的事件缓冲区，只由所属线程写入
+		struct ThreadBuffer
+		{
+			const char* name = nullptr;
+			std::unique_ptr<Event[]> events;
+			size_t count = 0;
+			size_t dropped = 0;  // 缓冲区已满而丢弃的事件数
+		};
+
+		/// @brief 脚本区域
+		struct ScriptZone
+		{
+			const char* name;  // 未在捕获期间开始的区域为nullptr，结束时不记录
+			int64_t begin;
+		};
+	private:
+		std::atomic<bool> m_bCapturing;
+		std::atomic<int> m_iThreadCount;
+		std::atomic<bool> m_bThreadRefused;  // 是否已有线程因槽位用尽而不被记录
+		// 主线程、游戏循环线程(多线程窗口模式下由fancy2d创建)、工作线程以及若干预留槽位，用尽后的线程不做记录
+		ThreadBuffer m_Buffers[LWORKER_MAXCNT + 2 + LPROFILER_SPARESLOTCNT];
+		int64_t m_iFrequency = 1;
+		int64_t m_iCaptureBegin = 0;
+		int64_t m_iFrameBegin = 0;
+
+		// 捕获设置，只由主线程访问
+		bool m_bCapturePending = false;  // 在下一个帧边界开始捕获
+		std::wstring m_Path;
+		fuInt m_iFramesLeft = 0;
+
+		// 脚本区域，只在主线程使用
+		// 捕获与否都维护嵌套关系，保证捕获开始前打开的区域在结束时不会与其他区域错配
+		std::vector<ScriptZone> m_ScriptZoneStack;
+		size_t m_iScriptZoneOverflow = 0;  // 超出最大嵌套深度而未入栈的区域数
+		std::set<std::string> m_ScriptZoneNames;  // 脚本区域名称，保证其在导出前有效
+	private:
+		ThreadBuffer* getThreadBuffer()LNOEXCEPT;
+		bool save()LNOEXCEPT;
+	public:
+		/// @brief 是否正在捕获
+		bool IsCapturing()const LNOEXCEPT { return m_bCapturing.load(std::memory_order_relaxed); }
+
+		/// @brief 获取当前时间戳
+		static int64_t Now()LNOEXCEPT;
+
+		/// @brief 为当前线程分配缓冲区并登记名称
+		/// @param[in] name 线程名，须为字符串常量
+		/// @note  已登记的线程保持原有的名称，因此可以在每帧调用。
+		///        槽位用尽时该线程的事件不被记录，只在第一次发生时给出警告
+		void RegisterThread(const char* name)LNOEXCEPT;
+
+		/// @brief 请求捕获
+		/// @param[in] path   导出的文件路径
+		/// @param[in] frames 捕获的帧数
+		/// @note  只能在主线程调用，捕获从下一帧开始。正在捕获时返回false
+		bool BeginCapture(const std::wstring& path, fuInt frames)LNOEXCEPT;
+
+		/// @brief 标记帧边界
+		/// @note  由主线程在每帧开始时调用，开始或结束捕获只发生在帧边界上
+		void FrameMark()LNOEXCEPT;
+
+		/// @brief 立即结束捕获并导出已捕获的部分
+		/// @note  只能在主线程且没有并行任务时调用，未在捕获时忽略
+		void EndCapture()LNOEXCEPT;
+
+		/// @brief 记录一个区域
+		void Record(const char* name, int64_t begin, int64_t end)LNOEXCEPT;
+
+		/// @brief 开始脚本区域
+		/// @note  未在捕获时也会记下嵌套关系
+		void BeginScriptZone(const char* name);
+
+		/// @brief 结束最近的脚本区域
+		/// @note  没有打开的区域时忽略，捕获开始前打开的区域不做记录
+		void EndScriptZone()LNOEXCEPT;
+	protected:
+		Profiler& operator=(const Profiler&);
+		Profiler(const Profiler&);
+	public:
+		Profiler();
+	};
+
+	/// @brief 分析区域
+	/// @note  未在捕获时只检查一次标记
+	class ProfileZone
+	{
+	private:
+		const char* m_Name;
+		int64_t m_iBegin;
+	private:
+		ProfileZone& operator=(const ProfileZone&);
+		ProfileZone(const ProfileZone&);
+	public:
+		ProfileZone(const char* name)
+			: m_Name(name), m_iBegin(LPROFILER.IsCapturing() ? Profiler::Now() : 0)
+		{
+		}
+		~ProfileZone()
+		{
+			if (m_iBegin != 0)
+				LPROFILER.Record(m_Name, m_iBegin, Profiler::Now());
+		}
+	};
+}
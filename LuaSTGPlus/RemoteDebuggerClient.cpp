@@ -1,4 +1,5 @@
 #include "RemoteDebuggerClient.h"
+#include "AppFrame.h"
 
 using namespace std;
 using namespace Bencode;
@@ -94,4 +95,92 @@ void RemoteDebuggerClient::SendResourceClearedHint(ResourcePoolType PoolType)
 	sendUdpMessage(UdpMessageType::ResourceCleared, tMessage);
 }
 
+void RemoteDebuggerClient::SendClassStats(const std::unordered_map<const void*, GameObjectClassStats>& Stats)
+{
+	// ֻܺʱߵɸ࣬ⳬUDPݱĴС
+	static const size_t s_MaxClassCount = 128;
+
+	vector<const GameObjectClassStats*> tSorted;
+	tSorted.reserve(Stats.size());
+	for (auto& i : Stats)
+		tSorted.push_back(&i.second);
+	auto tTotalTime = [](const GameObjectClassStats* p) {
+		double tTotal = 0.;
+		for (double t : p->time)
+			tTotal += t;
+		return tTotal;
+	};
+	sort(tSorted.begin(), tSorted.end(), [&](const GameObjectClassStats* a, const GameObjectClassStats* b) {
+		return tTotalTime(a) > tTotalTime(b);
+	});
+	if (tSorted.size() > s_MaxClassCount)
+		tSorted.resize(s_MaxClassCount);
+
+	// ʱ΢ΪλΪʼͳۼֵ
+	auto tToInt = [](double v) {
+		return make_shared<Value>(static_cast<IntType>(min(v, (double)INT32_MAX)));
+	};
+	shared_ptr<Value> tClasses = make_shared<Value>(ValueType::List);
+	for (const GameObjectClassStats* p : tSorted)
+	{
+		shared_ptr<Value> tClass = make_shared<Value>(ValueType::Dictionary);
+		tClass->VDict["name"] = make_shared<Value>(p->name);
+		tClass->VDict["frametime"] = tToInt(p->time[(size_t)GameObjectCallback::Frame] * 1000. * 1000.);
+		tClass->VDict["framecalls"] = tToInt((double)p->calls[(size_t)GameObjectCallback::Frame]);
+		tClass->VDict["rendertime"] = tToInt(p->time[(size_t)GameObjectCallback::Render] * 1000. * 1000.);
+		tClass->VDict["rendercalls"] = tToInt((double)p->calls[(size_t)GameObjectCallback::Render]);
+		tClass->VDict["collitime"] = tToInt(p->time[(size_t)GameObjectCallback::Colli] * 1000. * 1000.);
+		tClass->VDict["collicalls"] = tToInt((double)p->calls[(size_t)GameObjectCallback::Colli]);
+		tClasses->VList.push_back(tClass);
+	}
+
+	shared_ptr<Value> tMessage = make_shared<Value>(ValueType::Dictionary);
+	tMessage->VDict["classes"] = tClasses;
+
+	sendUdpMessage(UdpMessageType::ClassStats, tMessage);
+}
+
+void RemoteDebuggerClient::SendRenderStats(const RenderStats& Stats)
+{
+	shared_ptr<Value> tMessage = make_shared<Value>(ValueType::Dictionary);
+	tMessage->VDict["drawcalls"] = make_shared<Value>(static_cast<int>(Stats.drawCalls));
+	tMessage->VDict["sprites"] = make_shared<Value>(static_cast<int>(Stats.sprites));
+	tMessage->VDict["quads"] = make_shared<Value>(static_cast<int>(Stats.quads));
+	tMessage->VDict["vertices"] = make_shared<Value>(static_cast<int>(Stats.vertices));
+	tMessage->VDict["glyphs"] = make_shared<Value>(static_cast<int>(Stats.glyphs));
+	tMessage->VDict["particles"] = make_shared<Value>(static_cast<int>(Stats.particles));
+	tMessage->VDict["blendchanges"] = make_shared<Value>(static_cast<int>(Stats.blendChanges));
+	tMessage->VDict["rtpushes"] = make_shared<Value>(static_cast<int>(Stats.renderTargetPushes));
+	tMessage->VDict["rtpops"] = make_shared<Value>(static_cast<int>(Stats.renderTargetPops));
+	tMessage->VDict["posteffects"] = make_shared<Value>(static_cast<int>(Stats.postEffects));
+
+	sendUdpMessage(UdpMessageType::RenderStats, tMessage);
+}
+
+void RemoteDebuggerClient::SendFrameStats(const FrameStats& Stats)
+{
+	// ʱ΢ΪλΪʱڵͳ
+	auto tHistogram = [](const FrameTimeHistogram& h) {
+		auto tToInt = [](double v) {
+			return make_shared<Value>(static_cast<IntType>(min(v * 1000. * 1000., (double)INT32_MAX)));
+		};
+		shared_ptr<Value> tRet = make_shared<Value>(ValueType::Dictionary);
+		tRet->VDict["count"] = make_shared<Value>(static_cast<int>(h.GetCount()));
+		tRet->VDict["min"] = tToInt(h.GetMin());
+		tRet->VDict["p50"] = tToInt(h.GetPercentile(50.));
+		tRet->VDict["p95"] = tToInt(h.GetPercentile(95.));
+		tRet->VDict["p99"] = tToInt(h.GetPercentile(99.));
+		tRet->VDict["max"] = tToInt(h.GetMax());
+		tRet->VDict["overbudget"] = make_shared<Value>(static_cast<int>(h.GetOverBudgetCount()));
+		return tRet;
+	};
+
+	shared_ptr<Value> tMessage = make_shared<Value>(ValueType::Dictionary);
+	tMessage->VDict["update"] = tHistogram(Stats.update);
+	tMessage->VDict["render"] = tHistogram(Stats.render);
+	tMessage->VDict["total"] = tHistogram(Stats.total);
+
+	sendUdpMessage(UdpMessageType::FrameStats, tMessage);
+}
+
 #endif
@@ -1,10 +1,14 @@
 #pragma once
 #include "Global.h"
 #include "ResourceMgr.h"
+#include "GameObjectPool.h"
 #include "Bencode.h"
 
 namespace LuaSTGPlus
 {
+	struct RenderStats;
+	struct FrameStats;
+
 	/// @brief Զ˵ͻ
 	class RemoteDebuggerClient
 	{
@@ -14,7 +18,10 @@ namespace LuaSTGPlus
 			PerformanceUpdate = 1,
 			ResourceLoaded = 2,
 			ResourceRemoved = 3,
-			ResourceCleared = 4
+			ResourceCleared = 4,
+			ClassStats = 5,
+			RenderStats = 6,
+			FrameStats = 7
 		};
 	private:
 		SOCKET S;
@@ -29,6 +36,9 @@ namespace LuaSTGPlus
 		void SendResourceLoadedHint(ResourceType Type, ResourcePoolType PoolType, const char* Name, const wchar_t* Path, float LoadingTime);
 		void SendResourceRemovedHint(ResourceType Type, ResourcePoolType PoolType, const char* Name);
 		void SendResourceClearedHint(ResourcePoolType PoolType);
+		void SendClassStats(const std::unordered_map<const void*, GameObjectClassStats>& Stats);
+		void SendRenderStats(const RenderStats& Stats);
+		void SendFrameStats(const FrameStats& Stats);
 	protected:
 		RemoteDebuggerClient& operator=(const RemoteDebuggerClient&);
 		RemoteDebuggerClient(const RemoteDebuggerClient&);
@@ -1,10 +1,16 @@
 #include "ResourceMgr.h"
+#include "ParticleBatch.h"
 #include "AppFrame.h"
+#include "Profiler.h"
 
 #include "Utility.h"
 
 #include <iowin32.h>
 
+#ifdef LPARTICLE_USESSE
+#include <xmmintrin.h>
+#endif
+
 #ifdef max
 #undef max
 #endif
@@ -27,6 +33,8 @@ using namespace LuaSTGPlus;
 #endif
 
 fcyMemPool<sizeof(ResParticle::ParticlePool)> ResParticle::s_MemoryPool(512);  // Ԥ512
+size_t ResParticle::s_iMemoryUsage = 0;
+size_t ResParticle::s_iMemoryPeak = 0;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// ResAnimation
@@ -35,7 +43,7 @@ ResAnimation::ResAnimation(const char* name, fcyRefPointer<ResTexture> tex, floa
 	int n, int m, int intv, double a, double b, bool rect)
 	: Resource(ResourceType::Animation, name), m_Interval(intv), m_HalfSizeX(a), m_HalfSizeY(b), m_bRectangle(rect)
 {
-	LASSERT(LAPP.GetRenderer());
+	LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 	// ָ
 	for (int j = 0; j < m; ++j)  // 
@@ -43,14 +51,17 @@ ResAnimation::ResAnimation(const char* name, fcyRefPointer<ResTexture> tex, floa
 		for (int i = 0; i < n; ++i)  // 
 		{
 			fcyRefPointer<f2dSprite> t;
-			if (FCYFAILED(LAPP.GetRenderer()->CreateSprite2D(tex->GetTexture(), fcyRect(
-				x + w * i, y + h * j, x + w * (i + 1), y + h * (j + 1)
-				), &t)))
+			if (!LAPP.IsHeadless())  // ޴ģʽֻ֡
 			{
-				throw fcyException("ResAnimation::ResAnimation", "CreateSprite2D failed.");
+				if (FCYFAILED(LAPP.GetRenderer()->CreateSprite2D(tex->GetTexture(), fcyRect(
+					x + w * i, y + h * j, x + w * (i + 1), y + h * (j + 1)
+					), &t)))
+				{
+					throw fcyException("ResAnimation::ResAnimation", "CreateSprite2D failed.");
+				}
+				t->SetZ(0.5f);
+				t->SetColor(0xFFFFFFFF);
 			}
-			t->SetZ(0.5f);
-			t->SetColor(0xFFFFFFFF);
 			m_ImageSequences.push_back(t);
 		}
 	}
@@ -59,126 +70,436 @@ ResAnimation::ResAnimation(const char* name, fcyRefPointer<ResTexture> tex, floa
 ////////////////////////////////////////////////////////////////////////////////
 /// ResParticle
 ////////////////////////////////////////////////////////////////////////////////
+// ݰּ䣬LPARTICLE_MAXPOOLEDCNTķֱּӴӶϷ
+#define LPARTICLE_STORAGESIZE(cap) ((cap) * sizeof(float) * ResParticle::ParticleStorage::FieldCount)
+
+static_assert(LPARTICLE_MINCNT == 16 && LPARTICLE_MAXPOOLEDCNT == 2048, "size classes of particle storage need to be updated.");
+static fcyMemPool<LPARTICLE_STORAGESIZE(16)> s_ParticleStoragePool16(256);
+static fcyMemPool<LPARTICLE_STORAGESIZE(32)> s_ParticleStoragePool32(256);
+static fcyMemPool<LPARTICLE_STORAGESIZE(64)> s_ParticleStoragePool64(128);
+static fcyMemPool<LPARTICLE_STORAGESIZE(128)> s_ParticleStoragePool128(128);
+static fcyMemPool<LPARTICLE_STORAGESIZE(256)> s_ParticleStoragePool256(64);
+static fcyMemPool<LPARTICLE_STORAGESIZE(512)> s_ParticleStoragePool512(64);
+static fcyMemPool<LPARTICLE_STORAGESIZE(1024)> s_ParticleStoragePool1024(16);
+static fcyMemPool<LPARTICLE_STORAGESIZE(2048)> s_ParticleStoragePool2048(8);
+
+static void* AllocParticleStorage(size_t capacity)
+{
+	switch (capacity)
+	{
+	case 16:
+		return s_ParticleStoragePool16.Alloc();
+	case 32:
+		return s_ParticleStoragePool32.Alloc();
+	case 64:
+		return s_ParticleStoragePool64.Alloc();
+	case 128:
+		return s_ParticleStoragePool128.Alloc();
+	case 256:
+		return s_ParticleStoragePool256.Alloc();
+	case 512:
+		return s_ParticleStoragePool512.Alloc();
+	case 1024:
+		return s_ParticleStoragePool1024.Alloc();
+	case 2048:
+		return s_ParticleStoragePool2048.Alloc();
+	default:
+		LASSERT(capacity > LPARTICLE_MAXPOOLEDCNT);
+		return malloc(LPARTICLE_STORAGESIZE(capacity));
+	}
+}
+
+static void FreeParticleStorage(void* p, size_t capacity)
+{
+	switch (capacity)
+	{
+	case 16:
+		s_ParticleStoragePool16.Free(p);
+		break;
+	case 32:
+		s_ParticleStoragePool32.Free(p);
+		break;
+	case 64:
+		s_ParticleStoragePool64.Free(p);
+		break;
+	case 128:
+		s_ParticleStoragePool128.Free(p);
+		break;
+	case 256:
+		s_ParticleStoragePool256.Free(p);
+		break;
+	case 512:
+		s_ParticleStoragePool512.Free(p);
+		break;
+	case 1024:
+		s_ParticleStoragePool1024.Free(p);
+		break;
+	case 2048:
+		s_ParticleStoragePool2048.Free(p);
+		break;
+	default:
+		LASSERT(capacity > LPARTICLE_MAXPOOLEDCNT);
+		free(p);
+		break;
+	}
+}
+
+size_t ResParticle::NextPoolCapacity(size_t capacity, float count)LNOEXCEPT
+{
+	// ʼΪ2ݣcount(inf)ʱͣڴ洢ּֽϣɷʧܱ
+	static const size_t s_CapacityLimit = (size_t)-1 / LPARTICLE_STORAGESIZE(1);
+	while (capacity <= s_CapacityLimit / 2 && (float)capacity < count)
+		capacity <<= 1;
+	return capacity;
+}
+
+size_t ResParticle::EstimatePoolCapacity(const ParticleInfo& pinfo, float emission)LNOEXCEPT
+{
+	// ܶȺڹͬʱһ֡ķ
+	float tLifeMax = max(pinfo.fParticleLifeMin, pinfo.fParticleLifeMax);
+	float tEstimate = max(emission, 0.f) * (max(tLifeMax, 0.f) + 1.f / 60.f) + 1.f;
+	return NextPoolCapacity(LPARTICLE_MINCNT, tEstimate);
+}
+
 ResParticle::ResParticle(const char* name, const ParticleInfo& pinfo, fcyRefPointer<f2dSprite> sprite, BlendMode bld, double a, double b, bool rect)
 	: Resource(ResourceType::Particle, name), m_ParticleInfo(pinfo), m_BindedSprite(sprite), m_BlendMode(bld), m_HalfSizeX(a), m_HalfSizeY(b), m_bRectangle(rect)
 {
+	m_iPoolCapacity = EstimatePoolCapacity(pinfo, (float)pinfo.nEmission);
 }
 
 ResParticle::ParticlePool* ResParticle::AllocInstance()LNOEXCEPT
 {
-	//  棺Ǳbad_alloc´ʱ账
-	ParticlePool* pRet = new(s_MemoryPool.Alloc()) ParticlePool(this);
+	void* pStorage = nullptr;
+	void* pMemory = nullptr;
+	try
+	{
+		pStorage = AllocParticleStorage(m_iPoolCapacity);
+		if (pStorage)
+			pMemory = s_MemoryPool.Alloc();
+	}
+	catch (const bad_alloc&)
+	{
+	}
+	if (!pMemory)
+	{
+		if (pStorage)
+			FreeParticleStorage(pStorage, m_iPoolCapacity);
+		return nullptr;
+	}
+
+	ParticlePool* pRet = new(pMemory) ParticlePool(this, m_iPoolCapacity, pStorage);
 	pRet->SetBlendMode(m_BlendMode);
+
+	s_iMemoryUsage += sizeof(ParticlePool) + LPARTICLE_STORAGESIZE(m_iPoolCapacity);
+	s_iMemoryPeak = max(s_iMemoryPeak, s_iMemoryUsage);
 	return pRet;
 }
 
 void ResParticle::FreeInstance(ResParticle::ParticlePool* p)LNOEXCEPT
 {
+	void* pStorage = p->m_pStorage;
+	size_t tCapacity = p->GetCapacity();
 	p->~ParticlePool();
+	FreeParticleStorage(pStorage, tCapacity);
 	s_MemoryPool.Free(p);
+
+	s_iMemoryUsage -= sizeof(ParticlePool) + LPARTICLE_STORAGESIZE(tCapacity);
 }
 
-ResParticle::ParticlePool::ParticlePool(fcyRefPointer<ResParticle> ref)
-	: m_pInstance(ref), m_fEmission((float)ref->GetParticleInfo().nEmission) {}
+ResParticle::ParticlePool::ParticlePool(fcyRefPointer<ResParticle> ref, size_t capacity, void* storage)
+	: m_pInstance(ref), m_fEmission((float)ref->GetParticleInfo().nEmission), m_iCapacity(capacity), m_pStorage(storage)
+{
+	bindStorage();
+}
 
-void ResParticle::ParticlePool::Update(float delta)
+void ResParticle::ParticlePool::bindStorage()LNOEXCEPT
 {
-	static fcyRandomWELL512 s_ParticleRandomizer;
+	// ִ洢ֶΪ
+	float* p = static_cast<float*>(m_pStorage);
+	float** tFields[ParticleStorage::FieldCount] =
+	{
+		&m_Particles.vecLocationX, &m_Particles.vecLocationY, &m_Particles.vecVelocityX, &m_Particles.vecVelocityY,
+		&m_Particles.fGravity, &m_Particles.fRadialAccel, &m_Particles.fTangentialAccel,
+		&m_Particles.fSpin, &m_Particles.fSpinDelta,
+		&m_Particles.fSize, &m_Particles.fSizeDelta,
+		&m_Particles.colColor[0], &m_Particles.colColor[1], &m_Particles.colColor[2], &m_Particles.colColor[3],
+		&m_Particles.colColorDelta[0], &m_Particles.colColorDelta[1], &m_Particles.colColorDelta[2], &m_Particles.colColorDelta[3],
+		&m_Particles.fAge, &m_Particles.fTerminalAge
+	};
+	for (size_t i = 0; i < ParticleStorage::FieldCount; ++i)
+		*tFields[i] = p + i * m_iCapacity;
+}
 
-	const ParticleInfo& pInfo = m_pInstance->GetParticleInfo();
+bool ResParticle::ParticlePool::Reserve(size_t count)LNOEXCEPT
+{
+	if (count <= m_iCapacity)
+		return true;
 
-	if (m_iStatus == Status::Alive)
+	// countһּ
+	size_t tCapacity = NextPoolCapacity(m_iCapacity, (float)count);
+	if (tCapacity < count)
+		return false;
+
+	void* pStorage = nullptr;
+	try
 	{
-		m_fAge += delta;
-		if (m_fAge >= pInfo.fLifetime && pInfo.fLifetime >= 0.f)
-			m_iStatus = Status::Sleep;
+		pStorage = AllocParticleStorage(tCapacity);
+	}
+	catch (const bad_alloc&)
+	{
+	}
+	if (!pStorage)
+	{
+		LERROR("ParticlePool::Reserve: ڴ治㣬޷ϵͳ'%m'ݵ%u",
+			m_pInstance->GetResName().c_str(), (fuInt)tCapacity);
+		return false;
 	}
 
-	// 
-	size_t i = 0;
-	while (i < m_iAlive)
+	// ֶΰƴ
+	float* pDest = static_cast<float*>(pStorage);
+	const float* pSrc = static_cast<const float*>(m_pStorage);
+	for (size_t i = 0; i < ParticleStorage::FieldCount; ++i)
+		memcpy(pDest + i * tCapacity, pSrc + i * m_iCapacity, m_iAlive * sizeof(float));
+	FreeParticleStorage(m_pStorage, m_iCapacity);
+
+	ResParticle::s_iMemoryUsage += LPARTICLE_STORAGESIZE(tCapacity) - LPARTICLE_STORAGESIZE(m_iCapacity);
+	ResParticle::s_iMemoryPeak = max(ResParticle::s_iMemoryPeak, ResParticle::s_iMemoryUsage);
+
+	m_pStorage = pStorage;
+	m_iCapacity = tCapacity;
+	bindStorage();
+	return count <= m_iCapacity;
+}
+
+void ResParticle::ParticlePool::ReserveForUpdate(float delta)LNOEXCEPT
+{
+	if (m_iStatus != Status::Alive)
+		return;
+
+	// δƳ֡ӣԤ
+	float fParticlesNeeded = m_fEmission * m_fEmissionScale * delta + m_fEmissionResidue;
+	size_t tRequired = m_iAlive + (size_t)fParticlesNeeded;
+	if (tRequired <= m_iCapacity || Reserve(tRequired))
+		return;
+	if (!m_bCapacityWarned)
 	{
-		ParticleInstance& tInst = m_ParticlePool[i];
-		tInst.fAge += delta;
-		if (tInst.fAge >= tInst.fTerminalAge)
-		{
-			--m_iAlive;
-			if (m_iAlive > i + 1)
-				memcpy(&tInst, &m_ParticlePool[m_iAlive], sizeof(ParticleInstance));
+		LWARNING("ParticlePool: ϵͳ'%m'޷ݣͣ%uӲᱻ",
+			m_pInstance->GetResName().c_str(), (fuInt)m_iCapacity);
+		m_bCapacityWarned = true;
+	}
+}
+
+void ResParticle::ParticlePool::SetEmission(float e)LNOEXCEPT
+{
+	m_fEmission = e;
+
+	// ܶʱµĹֵ
+	Reserve(ResParticle::EstimatePoolCapacity(m_pInstance->GetParticleInfo(), e));
+}
+
+void ResParticle::ParticlePool::copyParticle(size_t dest, size_t src)LNOEXCEPT
+{
+	ParticleStorage& d = m_Particles;
+	d.vecLocationX[dest] = d.vecLocationX[src];
+	d.vecLocationY[dest] = d.vecLocationY[src];
+	d.vecVelocityX[dest] = d.vecVelocityX[src];
+	d.vecVelocityY[dest] = d.vecVelocityY[src];
+	d.fGravity[dest] = d.fGravity[src];
+	d.fRadialAccel[dest] = d.fRadialAccel[src];
+	d.fTangentialAccel[dest] = d.fTangentialAccel[src];
+	d.fSpin[dest] = d.fSpin[src];
+	d.fSpinDelta[dest] = d.fSpinDelta[src];
+	d.fSize[dest] = d.fSize[src];
+	d.fSizeDelta[dest] = d.fSizeDelta[src];
+	for (int k = 0; k < 4; ++k)
+	{
+		d.colColor[k][dest] = d.colColor[k][src];
+		d.colColorDelta[k][dest] = d.colColorDelta[k][src];
+	}
+	d.fAge[dest] = d.fAge[src];
+	d.fTerminalAge[dest] = d.fTerminalAge[src];
+}
+
+void ResParticle::ParticlePool::removeDeadParticles()LNOEXCEPT
+{
+	// ִӵ˳ǰ
+	const float* tAge = m_Particles.fAge;
+	const float* tTerminalAge = m_Particles.fTerminalAge;
+	size_t j = 0;
+	for (size_t i = 0; i < m_iAlive; ++i)
+	{
+		if (tAge[i] >= tTerminalAge[i])
 			continue;
-		}
+		if (i != j)
+			copyParticle(j, i);
+		++j;
+	}
+	m_iAlive = j;
+}
+
+void ResParticle::ParticlePool::emitParticle(size_t i, fcyRandomWELL512& rand)LNOEXCEPT
+{
+	const ParticleInfo& pInfo = m_pInstance->GetParticleInfo();
+	ParticleStorage& d = m_Particles;
+
+	d.fAge[i] = 0.0f;
+	d.fTerminalAge[i] = rand.GetRandFloat(pInfo.fParticleLifeMin, pInfo.fParticleLifeMax);
+
+	fcyVec2 tLocation = m_vPrevCenter + (m_vCenter - m_vPrevCenter) * rand.GetRandFloat(0.0f, 1.0f);
+	tLocation.x += rand.GetRandFloat(-2.0f, 2.0f);
+	tLocation.y += rand.GetRandFloat(-2.0f, 2.0f);
+	d.vecLocationX[i] = tLocation.x;
+	d.vecLocationY[i] = tLocation.y;
+
+	float ang = /* pInfo.fDirection */ (m_fRotation - (float)LPI_HALF) - (float)LPI_HALF + rand.GetRandFloat(0, pInfo.fSpread) - pInfo.fSpread / 2.0f;
+	float tSpeed = rand.GetRandFloat(pInfo.fSpeedMin, pInfo.fSpeedMax);
+	d.vecVelocityX[i] = cos(ang) * tSpeed;
+	d.vecVelocityY[i] = sin(ang) * tSpeed;
+
+	d.fGravity[i] = rand.GetRandFloat(pInfo.fGravityMin, pInfo.fGravityMax);
+	d.fRadialAccel[i] = rand.GetRandFloat(pInfo.fRadialAccelMin, pInfo.fRadialAccelMax);
+	d.fTangentialAccel[i] = rand.GetRandFloat(pInfo.fTangentialAccelMin, pInfo.fTangentialAccelMax);
 
+	d.fSize[i] = rand.GetRandFloat(pInfo.fSizeStart, pInfo.fSizeStart + (pInfo.fSizeEnd - pInfo.fSizeStart) * pInfo.fSizeVar);
+	d.fSizeDelta[i] = (pInfo.fSizeEnd - d.fSize[i]) / d.fTerminalAge[i];
+
+	d.fSpin[i] = /* pInfo.fSpinStart */ m_fRotation + rand.GetRandFloat(0, pInfo.fSpinEnd) - pInfo.fSpinEnd / 2.0f;
+	d.fSpinDelta[i] = pInfo.fSpinVar;
+
+	d.colColor[0][i] = rand.GetRandFloat(pInfo.colColorStart[0], pInfo.colColorStart[0] + (pInfo.colColorEnd[0] - pInfo.colColorStart[0])*pInfo.fColorVar);
+	d.colColor[1][i] = rand.GetRandFloat(pInfo.colColorStart[1], pInfo.colColorStart[1] + (pInfo.colColorEnd[1] - pInfo.colColorStart[1])*pInfo.fColorVar);
+	d.colColor[2][i] = rand.GetRandFloat(pInfo.colColorStart[2], pInfo.colColorStart[2] + (pInfo.colColorEnd[2] - pInfo.colColorStart[2])*pInfo.fColorVar);
+	d.colColor[3][i] = rand.GetRandFloat(pInfo.colColorStart[3], pInfo.colColorStart[3] + (pInfo.colColorEnd[3] - pInfo.colColorStart[3])*pInfo.fAlphaVar);
+
+	for (int k = 0; k < 4; ++k)
+		d.colColorDelta[k][i] = (pInfo.colColorEnd[k] - d.colColor[k][i]) / d.fTerminalAge[i];
+}
+
+void ResParticle::ParticlePool::updateParticles(size_t begin, size_t end, float delta)LNOEXCEPT
+{
+	ParticleStorage& d = m_Particles;
+	for (size_t i = begin; i < end; ++i)
+	{
 		// ߼ٶȺٶ
-		fcyVec2 vecAccel = (tInst.vecLocation - m_vCenter).GetNormalize();
-		fcyVec2 vecAccel2 = vecAccel;
-		vecAccel *= tInst.fRadialAccel;
-		// vecAccel2.Rotate(M_PI_2);
-		std::swap(vecAccel2.x, vecAccel2.y);
-		vecAccel2.x = -vecAccel2.x;
-		vecAccel2 *= tInst.fTangentialAccel;
+		float tDirX = d.vecLocationX[i] - m_vCenter.x;
+		float tDirY = d.vecLocationY[i] - m_vCenter.y;
+		float tLen = sqrt(tDirX * tDirX + tDirY * tDirY);
+		float tInvLen = tLen > 0.f ? 1.f / tLen : 0.f;
+		tDirX *= tInvLen;
+		tDirY *= tInvLen;
+
+		// Ϊ(dirX, dirY)Ϊת90ȼ(-dirY, dirX)
+		float tAccelX = tDirX * d.fRadialAccel[i] - tDirY * d.fTangentialAccel[i];
+		float tAccelY = tDirY * d.fRadialAccel[i] + tDirX * d.fTangentialAccel[i];
 
 		// ٶ
-		tInst.vecVelocity += (vecAccel + vecAccel2) * delta;
-		tInst.vecVelocity.y += tInst.fGravity * delta;
+		d.vecVelocityX[i] += tAccelX * delta;
+		d.vecVelocityY[i] += tAccelY * delta;
+		d.vecVelocityY[i] += d.fGravity[i] * delta;
 
 		// λ
-		tInst.vecLocation += tInst.vecVelocity * delta;
+		d.vecLocationX[i] += d.vecVelocityX[i] * delta;
+		d.vecLocationY[i] += d.vecVelocityY[i] * delta;
 
 		// ʹС
-		tInst.fSpin += tInst.fSpinDelta * delta;
-		tInst.fSize += tInst.fSizeDelta * delta;
-		tInst.colColor[0] += tInst.colColorDelta[0] * delta;
-		tInst.colColor[1] += tInst.colColorDelta[1] * delta;
-		tInst.colColor[2] += tInst.colColorDelta[2] * delta;
-		tInst.colColor[3] += tInst.colColorDelta[3] * delta;
-		
-		++i;
+		d.fSpin[i] += d.fSpinDelta[i] * delta;
+		d.fSize[i] += d.fSizeDelta[i] * delta;
+		d.colColor[0][i] += d.colColorDelta[0][i] * delta;
+		d.colColor[1][i] += d.colColorDelta[1][i] * delta;
+		d.colColor[2][i] += d.colColorDelta[2][i] * delta;
+		d.colColor[3][i] += d.colColorDelta[3][i] * delta;
 	}
+}
 
-	// µ
-	if (m_iStatus == Status::Alive)
+#ifdef LPARTICLE_USESSE
+void ResParticle::ParticlePool::updateParticlesSSE(size_t count, float delta)LNOEXCEPT
+{
+	// һδ4ӣ˳updateParticlesһ
+	ParticleStorage& d = m_Particles;
+	const __m128 tDelta = _mm_set1_ps(delta);
+	const __m128 tCenterX = _mm_set1_ps(m_vCenter.x);
+	const __m128 tCenterY = _mm_set1_ps(m_vCenter.y);
+	const __m128 tZero = _mm_setzero_ps();
+	const __m128 tOne = _mm_set1_ps(1.f);
+
+	for (size_t i = 0; i < count; i += 4)
 	{
-		float fParticlesNeeded = m_fEmission * delta + m_fEmissionResidue;
-		fuInt nParticlesCreated = (fuInt)fParticlesNeeded;
-		m_fEmissionResidue = fParticlesNeeded - (float)nParticlesCreated;
+		__m128 tLocX = _mm_loadu_ps(&d.vecLocationX[i]);
+		__m128 tLocY = _mm_loadu_ps(&d.vecLocationY[i]);
 
-		for (fuInt i = 0; i < nParticlesCreated; ++i)
-		{
-			if (m_iAlive >= m_ParticlePool.size())
-				break;
+		// ߼ٶȺٶ
+		__m128 tDirX = _mm_sub_ps(tLocX, tCenterX);
+		__m128 tDirY = _mm_sub_ps(tLocY, tCenterY);
+		__m128 tLen = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(tDirX, tDirX), _mm_mul_ps(tDirY, tDirY)));
+		__m128 tInvLen = _mm_and_ps(_mm_cmpgt_ps(tLen, tZero), _mm_div_ps(tOne, tLen));  // Ϊ0ʱȡ0
+		tDirX = _mm_mul_ps(tDirX, tInvLen);
+		tDirY = _mm_mul_ps(tDirY, tInvLen);
+
+		__m128 tRadial = _mm_loadu_ps(&d.fRadialAccel[i]);
+		__m128 tTangential = _mm_loadu_ps(&d.fTangentialAccel[i]);
+		__m128 tAccelX = _mm_sub_ps(_mm_mul_ps(tDirX, tRadial), _mm_mul_ps(tDirY, tTangential));
+		__m128 tAccelY = _mm_add_ps(_mm_mul_ps(tDirY, tRadial), _mm_mul_ps(tDirX, tTangential));
 
-			ParticleInstance& tInst = m_ParticlePool[m_iAlive++];
-			tInst.fAge = 0.0f;
-			tInst.fTerminalAge = s_ParticleRandomizer.GetRandFloat(pInfo.fParticleLifeMin, pInfo.fParticleLifeMax);
+		// ٶ
+		__m128 tVelX = _mm_add_ps(_mm_loadu_ps(&d.vecVelocityX[i]), _mm_mul_ps(tAccelX, tDelta));
+		__m128 tVelY = _mm_add_ps(_mm_loadu_ps(&d.vecVelocityY[i]), _mm_mul_ps(tAccelY, tDelta));
+		tVelY = _mm_add_ps(tVelY, _mm_mul_ps(_mm_loadu_ps(&d.fGravity[i]), tDelta));
+		_mm_storeu_ps(&d.vecVelocityX[i], tVelX);
+		_mm_storeu_ps(&d.vecVelocityY[i], tVelY);
 
-			tInst.vecLocation = m_vPrevCenter + (m_vCenter - m_vPrevCenter) * s_ParticleRandomizer.GetRandFloat(0.0f, 1.0f);
-			tInst.vecLocation.x += s_ParticleRandomizer.GetRandFloat(-2.0f, 2.0f);
-			tInst.vecLocation.y += s_ParticleRandomizer.GetRandFloat(-2.0f, 2.0f);
+		// λ
+		_mm_storeu_ps(&d.vecLocationX[i], _mm_add_ps(tLocX, _mm_mul_ps(tVelX, tDelta)));
+		_mm_storeu_ps(&d.vecLocationY[i], _mm_add_ps(tLocY, _mm_mul_ps(tVelY, tDelta)));
 
-			float ang = /* pInfo.fDirection */ (m_fRotation - (float)LPI_HALF) - (float)LPI_HALF + s_ParticleRandomizer.GetRandFloat(0, pInfo.fSpread) - pInfo.fSpread / 2.0f;
-			tInst.vecVelocity.x = cos(ang);
-			tInst.vecVelocity.y = sin(ang);
-			tInst.vecVelocity *= s_ParticleRandomizer.GetRandFloat(pInfo.fSpeedMin, pInfo.fSpeedMax);
+		// ʹС
+		_mm_storeu_ps(&d.fSpin[i], _mm_add_ps(_mm_loadu_ps(&d.fSpin[i]), _mm_mul_ps(_mm_loadu_ps(&d.fSpinDelta[i]), tDelta)));
+		_mm_storeu_ps(&d.fSize[i], _mm_add_ps(_mm_loadu_ps(&d.fSize[i]), _mm_mul_ps(_mm_loadu_ps(&d.fSizeDelta[i]), tDelta)));
+		for (int k = 0; k < 4; ++k)
+		{
+			_mm_storeu_ps(&d.colColor[k][i],
+				_mm_add_ps(_mm_loadu_ps(&d.colColor[k][i]), _mm_mul_ps(_mm_loadu_ps(&d.colColorDelta[k][i]), tDelta)));
+		}
+	}
+}
+#endif
 
-			tInst.fGravity = s_ParticleRandomizer.GetRandFloat(pInfo.fGravityMin, pInfo.fGravityMax);
-			tInst.fRadialAccel = s_ParticleRandomizer.GetRandFloat(pInfo.fRadialAccelMin, pInfo.fRadialAccelMax);
-			tInst.fTangentialAccel = s_ParticleRandomizer.GetRandFloat(pInfo.fTangentialAccelMin, pInfo.fTangentialAccelMax);
+void ResParticle::ParticlePool::Update(float delta)
+{
+	const ParticleInfo& pInfo = m_pInstance->GetParticleInfo();
 
-			tInst.fSize = s_ParticleRandomizer.GetRandFloat(pInfo.fSizeStart, pInfo.fSizeStart + (pInfo.fSizeEnd - pInfo.fSizeStart) * pInfo.fSizeVar);
-			tInst.fSizeDelta = (pInfo.fSizeEnd - tInst.fSize) / tInst.fTerminalAge;
+	if (m_iStatus == Status::Alive)
+	{
+		m_fAge += delta;
+		if (m_fAge >= pInfo.fLifetime && pInfo.fLifetime >= 0.f)
+			m_iStatus = Status::Sleep;
+	}
 
-			tInst.fSpin = /* pInfo.fSpinStart */ m_fRotation + s_ParticleRandomizer.GetRandFloat(0, pInfo.fSpinEnd) - pInfo.fSpinEnd / 2.0f;
-			tInst.fSpinDelta = pInfo.fSpinVar;
+	// ´ʱ䲢Ƴ
+	for (size_t i = 0; i < m_iAlive; ++i)
+		m_Particles.fAge[i] += delta;
+	removeDeadParticles();
 
-			tInst.colColor[0] = s_ParticleRandomizer.GetRandFloat(pInfo.colColorStart[0], pInfo.colColorStart[0] + (pInfo.colColorEnd[0] - pInfo.colColorStart[0])*pInfo.fColorVar);
-			tInst.colColor[1] = s_ParticleRandomizer.GetRandFloat(pInfo.colColorStart[1], pInfo.colColorStart[1] + (pInfo.colColorEnd[1] - pInfo.colColorStart[1])*pInfo.fColorVar);
-			tInst.colColor[2] = s_ParticleRandomizer.GetRandFloat(pInfo.colColorStart[2], pInfo.colColorStart[2] + (pInfo.colColorEnd[2] - pInfo.colColorStart[2])*pInfo.fColorVar);
-			tInst.colColor[3] = s_ParticleRandomizer.GetRandFloat(pInfo.colColorStart[3], pInfo.colColorStart[3] + (pInfo.colColorEnd[3] - pInfo.colColorStart[3])*pInfo.fAlphaVar);
+	// 
+#ifdef LPARTICLE_USESSE
+	size_t tVectorized = m_iAlive & ~(size_t)3;
+	updateParticlesSSE(tVectorized, delta);
+	updateParticles(tVectorized, m_iAlive, delta);
+#else
+	updateParticles(0, m_iAlive, delta);
+#endif
 
-			tInst.colColorDelta[0] = (pInfo.colColorEnd[0] - tInst.colColor[0]) / tInst.fTerminalAge;
-			tInst.colColorDelta[1] = (pInfo.colColorEnd[1] - tInst.colColor[1]) / tInst.fTerminalAge;
-			tInst.colColorDelta[2] = (pInfo.colColorEnd[2] - tInst.colColor[2]) / tInst.fTerminalAge;
-			tInst.colColorDelta[3] = (pInfo.colColorEnd[3] - tInst.colColor[3]) / tInst.fTerminalAge;
+	// µ
+	if (m_iStatus == Status::Alive)
+	{
+		float fParticlesNeeded = m_fEmission * m_fEmissionScale * delta + m_fEmissionResidue;
+		fuInt nParticlesCreated = (fuInt)fParticlesNeeded;
+		m_fEmissionResidue = fParticlesNeeded - (float)nParticlesCreated;
+
+		for (fuInt i = 0; i < nParticlesCreated; ++i)
+		{
+			if (m_iAlive >= m_iCapacity)
+				break;
+			emitParticle(m_iAlive++, m_Random);
 		}
 	}
 
@@ -187,27 +508,110 @@ void ResParticle::ParticlePool::Update(float delta)
 
 void ResParticle::ParticlePool::Render(f2dGraphics2D* graph, float scaleX, float scaleY)
 {
+	if (m_iAlive == 0)
+		return;
+
+	// ֱɾɶ㣬޸Ĺɫ
 	f2dSprite* p = m_pInstance->GetBindedSprite();
-	const ParticleInfo& pInfo = m_pInstance->GetParticleInfo();
-	fcyColor tOrgColor = p->GetColor(0U);
+	f2dTexture2D* pTex = p->GetTexture();
+	ParticleQuadBuilder tBuilder(p->GetTexRect(), p->GetHotSpot(), (float)pTex->GetWidth(), (float)pTex->GetHeight(), p->GetZ(),
+		p->GetColor(0U), m_pInstance->GetParticleInfo().colColorStart[0] < 0, scaleX, scaleY);
 
-	for (size_t i = 0; i < m_iAlive; ++i)
-	{
-		ParticleInstance& pInst = m_ParticlePool[i];
-		
-		if (pInfo.colColorStart[0] < 0)  // r < 0
-			p->SetColor(fcyColor(
-				(int)(pInst.colColor[3] * 255),
-				tOrgColor.r,
-				tOrgColor.g,
-				tOrgColor.b
-			));
-		else
-			p->SetColor(fcyColor(pInst.colColor[3], pInst.colColor[0], pInst.colColor[1], pInst.colColor[2]));
-		p->Draw2(graph, fcyVec2(pInst.vecLocation.x, pInst.vecLocation.y), fcyVec2(scaleX * pInst.fSize, scaleY * pInst.fSize), pInst.fSpin, false);
-	}
+	// ύ
+	SubmitParticleBatches(tBuilder, m_Particles, m_iAlive, [&](const f2dGraphics2DVertex* vertex, fuInt vertCount, const fuShort* index, fuInt indexCount) -> bool {
+		if (FCYFAILED(graph->DrawRaw(pTex, vertCount, indexCount, vertex, index, false)))
+		{
+			LERROR("ParticlePool::Render: ύʧ (f2dGraphics2D::DrawRaw failed)");
+			return false;
+		}
+		return true;
+	});
+}
+
+// ӳر״̬ͷǸֶдӵ
+struct ParticlePoolState
+{
+	BlendMode blend;
+	ResParticle::ParticlePool::Status status;
+	fcyVec2 center;
+	fcyVec2 prevCenter;
+	float rotation;
+	size_t alive;
+	float age;
+	float emission;
+	float emissionScale;
+	float emissionResidue;
+	fByte random[sizeof(fcyRandomWELL512)];
+};
+
+size_t ResParticle::ParticlePool::PeekState(const fByte* src, size_t& alive)LNOEXCEPT
+{
+	ParticlePoolState tState;
+	memcpy(&tState, src, sizeof(tState));
+	alive = tState.alive;
+	return sizeof(ParticlePoolState) + tState.alive * ParticleStorage::FieldCount * sizeof(float);
+}
+
+size_t ResParticle::ParticlePool::GetStateSize()const LNOEXCEPT
+{
+	return sizeof(ParticlePoolState) + m_iAlive * ParticleStorage::FieldCount * sizeof(float);
+}
 
-	p->SetColor(tOrgColor);
+size_t ResParticle::ParticlePool::SaveState(fByte* dest)const LNOEXCEPT
+{
+	ParticlePoolState tState;
+	tState.blend = m_BlendMode;
+	tState.status = m_iStatus;
+	tState.center = m_vCenter;
+	tState.prevCenter = m_vPrevCenter;
+	tState.rotation = m_fRotation;
+	tState.alive = m_iAlive;
+	tState.age = m_fAge;
+	tState.emission = m_fEmission;
+	tState.emissionScale = m_fEmissionScale;
+	tState.emissionResidue = m_fEmissionResidue;
+	memcpy(tState.random, &m_Random, sizeof(fcyRandomWELL512));
+	memcpy(dest, &tState, sizeof(tState));
+
+	// ֶڴ洢Ϊ
+	fByte* p = dest + sizeof(tState);
+	const float* tField = static_cast<const float*>(m_pStorage);
+	for (size_t i = 0; i < ParticleStorage::FieldCount; ++i)
+	{
+		memcpy(p, tField, m_iAlive * sizeof(float));
+		p += m_iAlive * sizeof(float);
+		tField += m_iCapacity;
+	}
+	return p - dest;
+}
+
+size_t ResParticle::ParticlePool::LoadState(const fByte* src)LNOEXCEPT
+{
+	ParticlePoolState tState;
+	memcpy(&tState, src, sizeof(tState));
+	if (!Reserve(tState.alive))
+		return 0;
+	m_BlendMode = tState.blend;
+	m_iStatus = tState.status;
+	m_vCenter = tState.center;
+	m_vPrevCenter = tState.prevCenter;
+	m_fRotation = tState.rotation;
+	m_iAlive = tState.alive;
+	m_fAge = tState.age;
+	m_fEmission = tState.emission;
+	m_fEmissionScale = tState.emissionScale;
+	m_fEmissionResidue = tState.emissionResidue;
+	memcpy(&m_Random, tState.random, sizeof(fcyRandomWELL512));
+
+	const fByte* p = src + sizeof(tState);
+	float* tField = static_cast<float*>(m_pStorage);
+	for (size_t i = 0; i < ParticleStorage::FieldCount; ++i)
+	{
+		memcpy(tField, p, m_iAlive * sizeof(float));
+		p += m_iAlive * sizeof(float);
+		tField += m_iCapacity;
+	}
+	return p - src;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -420,6 +824,10 @@ ResMusic::BGMWrapper::BGMWrapper(fcyRefPointer<f2dSoundDecoder> pOrg, fDouble Lo
 ResFX::ResFX(const char* name, fcyRefPointer<f2dEffect> shader)
 	: Resource(ResourceType::FX, name), m_pShader(shader)
 {
+	// ޴ģʽûshaderҲûпɰ󶨵ı
+	if (!m_pShader)
+		return;
+
 	// ɨеıע
 	for (fuInt i = 0; i < m_pShader->GetParamCount(); ++i)
 	{
@@ -543,12 +951,46 @@ void ResourcePool::Clear()LNOEXCEPT
 	m_SpriteFontPool.clear();
 	m_TTFFontPool.clear();
 	m_FXPool.clear();
+	m_ImageIndex.clear();
+	m_pMgr->InvalidateResourceCache();
 
 #if (defined LDEVVERSION) || (defined LDEBUG)
 	LAPP.SendResourceClearedHint(m_iType);
 #endif
 }
 
+void ResourcePool::updateImageIndex(const char* name)
+{
+	// ͼ񡢶ӵ˳ѡȡͬԴ
+	Resource* tRes = nullptr;
+	auto tSprite = m_SpritePool.find(name);
+	if (tSprite != m_SpritePool.end())
+		tRes = tSprite->second;
+	else
+	{
+		auto tAnimation = m_AnimationPool.find(name);
+		if (tAnimation != m_AnimationPool.end())
+			tRes = tAnimation->second;
+		else
+		{
+			auto tParticle = m_ParticlePool.find(name);
+			if (tParticle != m_ParticlePool.end())
+				tRes = tParticle->second;
+		}
+	}
+
+	auto i = m_ImageIndex.find(name);
+	if (i != m_ImageIndex.end())
+	{
+		if (tRes)
+			i->second = tRes;
+		else
+			m_ImageIndex.erase(i);
+	}
+	else if (tRes)
+		m_ImageIndex.emplace(name, tRes);
+}
+
 void ResourcePool::RemoveResource(ResourceType t, const char* name)LNOEXCEPT
 {
 	switch (t)
@@ -558,9 +1000,11 @@ void ResourcePool::RemoveResource(ResourceType t, const char* name)LNOEXCEPT
 		break;
 	case ResourceType::Sprite:
 		removeResource(m_SpritePool, name);
+		updateImageIndex(name);
 		break;
 	case ResourceType::Animation:
 		removeResource(m_AnimationPool, name);
+		updateImageIndex(name);
 		break;
 	case ResourceType::Music:
 		removeResource(m_MusicPool, name);
@@ -570,6 +1014,7 @@ void ResourcePool::RemoveResource(ResourceType t, const char* name)LNOEXCEPT
 		break;
 	case ResourceType::Particle:
 		removeResource(m_ParticlePool, name);
+		updateImageIndex(name);
 		break;
 	case ResourceType::SpriteFont:
 		removeResource(m_SpriteFontPool, name);
@@ -583,6 +1028,7 @@ void ResourcePool::RemoveResource(ResourceType t, const char* name)LNOEXCEPT
 	default:
 		return;
 	}
+	m_pMgr->InvalidateResourceCache();
 
 #if (defined LDEVVERSION) || (defined LDEBUG)
 	LAPP.SendResourceRemovedHint(t, m_iType, name);
@@ -674,12 +1120,13 @@ void ResourcePool::ExportResourceList(lua_State* L, ResourceType t)const LNOEXCE
 
 bool ResourcePool::LoadTexture(const char* name, const std::wstring& path, bool mipmaps)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadTexture");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderDev());
+		LASSERT(LAPP.GetRenderDev() || LAPP.IsHeadless());
 
 		if (m_TexturePool.find(name) != m_TexturePool.end())
 		{
@@ -691,8 +1138,9 @@ bool ResourcePool::LoadTexture(const char* name, const std::wstring& path, bool
 		if (!m_pMgr->LoadFile(path.c_str(), tDataBuf))
 			return false;
 
+		// ޴ģʽֻļ
 		fcyRefPointer<f2dTexture2D> tTexture;
-		if (FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
+		if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
 		{
 			LERROR("LoadTexture: ļ'%s''%m'ʧ", path.c_str(), name);
 			return false;
@@ -703,6 +1151,7 @@ bool ResourcePool::LoadTexture(const char* name, const std::wstring& path, bool
 			fcyRefPointer<ResTexture> tRes;
 			tRes.DirectSet(new ResTexture(name, tTexture));
 			m_TexturePool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -740,7 +1189,7 @@ bool ResourcePool::LoadImage(const char* name, const char* texname,
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderer());
+		LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 		if (m_SpritePool.find(name) != m_SpritePool.end())
 		{
@@ -757,7 +1206,7 @@ bool ResourcePool::LoadImage(const char* name, const char* texname,
 
 		fcyRefPointer<f2dSprite> pSprite;
 		fcyRect tRect((float)x, (float)y, (float)(x + w), (float)(y + h));
-		if (FCYFAILED(LAPP.GetRenderer()->CreateSprite2D(pTex->GetTexture(), tRect, &pSprite)))
+		if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderer()->CreateSprite2D(pTex->GetTexture(), tRect, &pSprite)))
 		{
 			LERROR("LoadImage: ޷'%m'ͼ'%m' (CreateSprite2D failed)", texname, name);
 			return false;
@@ -768,6 +1217,8 @@ bool ResourcePool::LoadImage(const char* name, const char* texname,
 			fcyRefPointer<ResSprite> tRes;
 			tRes.DirectSet(new ResSprite(name, pSprite, a, b, rect));
 			m_SpritePool.emplace(name, tRes);
+			updateImageIndex(name);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -810,6 +1261,8 @@ bool ResourcePool::LoadAnimation(const char* name, const char* texname,
 			fcyRefPointer<ResAnimation> tRes;
 			tRes.DirectSet(new ResAnimation(name, pTex, (float)x, (float)y, (float)w, (float)h, n, m, intv, a, b, rect));
 			m_AnimationPool.emplace(name, tRes);
+			updateImageIndex(name);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const fcyException&)
 		{
@@ -833,12 +1286,13 @@ bool ResourcePool::LoadAnimation(const char* name, const char* texname,
 
 bool ResourcePool::LoadMusic(const char* name, const std::wstring& path, double start, double end)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadMusic");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetSoundSys());
+		LASSERT(LAPP.GetSoundSys() || LAPP.IsHeadless());
 
 		fcyRefPointer<fcyMemStream> tDataBuf;
 		if (!m_pMgr->LoadFile(path.c_str(), tDataBuf))
@@ -846,30 +1300,34 @@ bool ResourcePool::LoadMusic(const char* name, const std::wstring& path, double
 
 		try
 		{
-			fcyRefPointer<f2dSoundDecoder> tDecoder;
-			if (FCYFAILED(LAPP.GetSoundSys()->CreateOGGVorbisDecoder(tDataBuf, &tDecoder)))
+			fcyRefPointer<f2dSoundBuffer> tBuffer;
+			if (!LAPP.IsHeadless())  // ޴ģʽ²
 			{
-				tDataBuf->SetPosition(FCYSEEKORIGIN_BEG, 0);
-				if (FCYFAILED(LAPP.GetSoundSys()->CreateWaveDecoder(tDataBuf, &tDecoder)))
+				fcyRefPointer<f2dSoundDecoder> tDecoder;
+				if (FCYFAILED(LAPP.GetSoundSys()->CreateOGGVorbisDecoder(tDataBuf, &tDecoder)))
 				{
-					LERROR("LoadMusic: ޷ļ'%s'", path.c_str());
-					return false;
+					tDataBuf->SetPosition(FCYSEEKORIGIN_BEG, 0);
+					if (FCYFAILED(LAPP.GetSoundSys()->CreateWaveDecoder(tDataBuf, &tDecoder)))
+					{
+						LERROR("LoadMusic: ޷ļ'%s'", path.c_str());
+						return false;
+					}
 				}
-			}
 
-			fcyRefPointer<ResMusic::BGMWrapper> tWrapperedBuffer;
-			tWrapperedBuffer.DirectSet(new ResMusic::BGMWrapper(tDecoder, start, end));
+				fcyRefPointer<ResMusic::BGMWrapper> tWrapperedBuffer;
+				tWrapperedBuffer.DirectSet(new ResMusic::BGMWrapper(tDecoder, start, end));
 
-			fcyRefPointer<f2dSoundBuffer> tBuffer;
-			if (FCYFAILED(LAPP.GetSoundSys()->CreateDynamicBuffer(tWrapperedBuffer, LSOUNDGLOBALFOCUS, &tBuffer)))
-			{
-				LERROR("LoadMusic: ޷Ƶļ'%s' (f2dSoundSys::CreateDynamicBuffer failed.)", path.c_str());
-				return false;
+				if (FCYFAILED(LAPP.GetSoundSys()->CreateDynamicBuffer(tWrapperedBuffer, LSOUNDGLOBALFOCUS, &tBuffer)))
+				{
+					LERROR("LoadMusic: ޷Ƶļ'%s' (f2dSoundSys::CreateDynamicBuffer failed.)", path.c_str());
+					return false;
+				}
 			}
 
 			fcyRefPointer<ResMusic> tRes;
 			tRes.DirectSet(new ResMusic(name, tBuffer));
 			m_MusicPool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const fcyException& e)
 		{
@@ -906,12 +1364,13 @@ LNOINLINE bool ResourcePool::LoadMusic(const char* name, const char* path, doubl
 
 bool ResourcePool::LoadSound(const char* name, const std::wstring& path)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadSound");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetSoundSys());
+		LASSERT(LAPP.GetSoundSys() || LAPP.IsHeadless());
 
 		fcyRefPointer<fcyMemStream> tDataBuf;
 		if (!m_pMgr->LoadFile(path.c_str(), tDataBuf))
@@ -919,27 +1378,31 @@ bool ResourcePool::LoadSound(const char* name, const std::wstring& path)LNOEXCEP
 
 		try
 		{
-			fcyRefPointer<f2dSoundDecoder> tDecoder;
-			if (FCYFAILED(LAPP.GetSoundSys()->CreateWaveDecoder(tDataBuf, &tDecoder)))
+			fcyRefPointer<f2dSoundBuffer> tBuffer;
+			if (!LAPP.IsHeadless())  // ޴ģʽ²
 			{
-				tDataBuf->SetPosition(FCYSEEKORIGIN_BEG, 0);
-				if (FCYFAILED(LAPP.GetSoundSys()->CreateOGGVorbisDecoder(tDataBuf, &tDecoder)))
+				fcyRefPointer<f2dSoundDecoder> tDecoder;
+				if (FCYFAILED(LAPP.GetSoundSys()->CreateWaveDecoder(tDataBuf, &tDecoder)))
 				{
-					LERROR("LoadSound: ޷ļ'%s'", path.c_str());
-					return false;
+					tDataBuf->SetPosition(FCYSEEKORIGIN_BEG, 0);
+					if (FCYFAILED(LAPP.GetSoundSys()->CreateOGGVorbisDecoder(tDataBuf, &tDecoder)))
+					{
+						LERROR("LoadSound: ޷ļ'%s'", path.c_str());
+						return false;
+					}
 				}
-			}
 
-			fcyRefPointer<f2dSoundBuffer> tBuffer;
-			if (FCYFAILED(LAPP.GetSoundSys()->CreateStaticBuffer(tDecoder, LSOUNDGLOBALFOCUS, &tBuffer)))
-			{
-				LERROR("LoadSound: ޷Ƶļ'%s' (f2dSoundSys::CreateStaticBuffer failed.)", path.c_str());
-				return false;
+				if (FCYFAILED(LAPP.GetSoundSys()->CreateStaticBuffer(tDecoder, LSOUNDGLOBALFOCUS, &tBuffer)))
+				{
+					LERROR("LoadSound: ޷Ƶļ'%s' (f2dSoundSys::CreateStaticBuffer failed.)", path.c_str());
+					return false;
+				}
 			}
 
 			fcyRefPointer<ResSound> tRes;
 			tRes.DirectSet(new ResSound(name, tBuffer));
 			m_SoundSpritePool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const fcyException& e)
 		{
@@ -976,12 +1439,13 @@ LNOINLINE bool ResourcePool::LoadSound(const char* name, const char* path)LNOEXC
 
 bool ResourcePool::LoadParticle(const char* name, const std::wstring& path, const char* img_name, double a, double b, bool rect)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadParticle");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderer());
+		LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 		if (m_ParticlePool.find(name) != m_ParticlePool.end())
 		{
@@ -996,7 +1460,7 @@ bool ResourcePool::LoadParticle(const char* name, const std::wstring& path, cons
 			LWARNING("LoadParticle: '%m'ʧ, ޷ҵ'%m'", name, img_name);
 			return false;
 		}
-		else
+		else if (!LAPP.IsHeadless())
 		{
 			// ¡һ
 			if (FCYFAILED(LAPP.GetRenderer()->CreateSprite2D(pSprite->GetSprite()->GetTexture(), pSprite->GetSprite()->GetTexRect(), pSprite->GetSprite()->GetHotSpot(), &pClone)))
@@ -1045,6 +1509,8 @@ bool ResourcePool::LoadParticle(const char* name, const std::wstring& path, cons
 			fcyRefPointer<ResParticle> tRes;
 			tRes.DirectSet(new ResParticle(name, tInfo, pClone, tBlendInfo, a, b, rect));
 			m_ParticlePool.emplace(name, tRes);
+			updateImageIndex(name);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -1075,12 +1541,13 @@ LNOINLINE bool ResourcePool::LoadParticle(const char* name, const char* path, co
 
 bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, bool mipmaps)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadSpriteFont");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderer());
+		LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 		if (m_SpriteFontPool.find(name) != m_SpriteFontPool.end())
 		{
@@ -1141,7 +1608,7 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, bo
 		}
 
 		fcyRefPointer<f2dTexture2D> tTexture;
-		if (FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
+		if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
 		{
 			LERROR("LoadFont: ļ'%s''%m'ʧ", tOutputTextureName.c_str(), name);
 			return false;
@@ -1151,11 +1618,13 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, bo
 		try
 		{
 			fcyRefPointer<f2dFontProvider> tFontProvider;
-			tFontProvider.DirectSet(new ResFont::HGEFont(std::move(tOutputCharset), tTexture));
+			if (!LAPP.IsHeadless())
+				tFontProvider.DirectSet(new ResFont::HGEFont(std::move(tOutputCharset), tTexture));
 
 			fcyRefPointer<ResFont> tRes;
 			tRes.DirectSet(new ResFont(name, tFontProvider));
 			m_SpriteFontPool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -1173,12 +1642,13 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, bo
 
 bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, const std::wstring& tex_path, bool mipmaps)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadSpriteFont");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderer());
+		LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 		if (m_SpriteFontPool.find(name) != m_SpriteFontPool.end())
 		{
@@ -1223,7 +1693,7 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, co
 		}
 
 		fcyRefPointer<f2dTexture2D> tTexture;
-		if (FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
+		if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderDev()->CreateTextureFromMemory((fcData)tDataBuf->GetInternalBuffer(), tDataBuf->GetLength(), 0, 0, false, mipmaps, &tTexture)))
 		{
 			LERROR("LoadFont: ļ'%s''%m'ʧ", tex_path.c_str(), name);
 			return false;
@@ -1233,7 +1703,7 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, co
 		try
 		{
 			fcyRefPointer<f2dFontProvider> tFontProvider;
-			if (FCYFAILED(LAPP.GetRenderer()->CreateFontFromTex(tFileData.c_str(), tTexture, &tFontProvider)))
+			if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderer()->CreateFontFromTex(tFileData.c_str(), tTexture, &tFontProvider)))
 			{
 				LERROR("LoadFont: ļ'%s'ʧ", path.c_str());
 				return false;
@@ -1242,6 +1712,7 @@ bool ResourcePool::LoadSpriteFont(const char* name, const std::wstring& path, co
 			fcyRefPointer<ResFont> tRes;
 			tRes.DirectSet(new ResFont(name, tFontProvider));
 			m_SpriteFontPool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -1285,12 +1756,13 @@ LNOINLINE bool ResourcePool::LoadSpriteFont(const char* name, const char* path,
 
 bool ResourcePool::LoadTTFFont(const char* name, const std::wstring& path, float width, float height)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadTTFFont");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderer());
+		LASSERT(LAPP.GetRenderer() || LAPP.IsHeadless());
 
 		if (m_TTFFontPool.find(name) != m_TTFFontPool.end())
 		{
@@ -1305,7 +1777,7 @@ bool ResourcePool::LoadTTFFont(const char* name, const std::wstring& path, float
 		if (!m_pMgr->LoadFile(path.c_str(), tDataBuf))
 		{
 			LINFO("LoadTTFFont: ޷·'%s'ϼ壬ϵͳԴϵͳ", path.c_str());
-			if (FCYFAILED(LAPP.GetRenderer()->CreateSystemFont(path.c_str(), 0, fcyVec2(width, height), F2DFONTFLAG_NONE, &tFontProvider)))
+			if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderer()->CreateSystemFont(path.c_str(), 0, fcyVec2(width, height), F2DFONTFLAG_NONE, &tFontProvider)))
 			{
 				LERROR("LoadTTFFont: ʧܣ޷·'%s'ϼ", path.c_str());
 				return false;
@@ -1315,7 +1787,7 @@ bool ResourcePool::LoadTTFFont(const char* name, const std::wstring& path, float
 		// 
 		try
 		{
-			if (!tFontProvider)
+			if (!tFontProvider && !LAPP.IsHeadless())
 			{
 				if (FCYFAILED(LAPP.GetRenderer()->CreateFontFromFile(tDataBuf, 0, fcyVec2(width, height), F2DFONTFLAG_NONE, &tFontProvider)))
 				{
@@ -1328,6 +1800,7 @@ bool ResourcePool::LoadTTFFont(const char* name, const std::wstring& path, float
 			tRes.DirectSet(new ResFont(name, tFontProvider));
 			tRes->SetBlendMode(BlendMode::AddAlpha);
 			m_TTFFontPool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -1358,12 +1831,13 @@ LNOINLINE bool ResourcePool::LoadTTFFont(const char* name, const char* path, flo
 
 bool ResourcePool::LoadFX(const char* name, const std::wstring& path)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadFX");
 	LDEBUG_RESOURCETIMER;
 
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderDev());
+		LASSERT(LAPP.GetRenderDev() || LAPP.IsHeadless());
 
 		if (m_FXPool.find(name) != m_FXPool.end())
 		{
@@ -1379,7 +1853,7 @@ bool ResourcePool::LoadFX(const char* name, const std::wstring& path)LNOEXCEPT
 		try
 		{
 			fcyRefPointer<f2dEffect> tEffect;
-			if (FCYFAILED(LAPP.GetRenderDev()->CreateEffect(tDataBuf, false, &tEffect)))
+			if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderDev()->CreateEffect(tDataBuf, false, &tEffect)))
 			{
 				LERROR("LoadFX: shaderļ'%s'ʧ (lasterr=%m)", path.c_str(), LAPP.GetEngine()->GetLastErrDesc());
 				return false;
@@ -1388,6 +1862,7 @@ bool ResourcePool::LoadFX(const char* name, const std::wstring& path)LNOEXCEPT
 			fcyRefPointer<ResFX> tRes;
 			tRes.DirectSet(new ResFX(name, tEffect));
 			m_FXPool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const fcyException& e)
 		{
@@ -1428,7 +1903,7 @@ LNOINLINE bool ResourcePool::CreateRenderTarget(const char* name)LNOEXCEPT
 	{
 		LDEBUG_RESOURCESCOPE;
 
-		LASSERT(LAPP.GetRenderDev());
+		LASSERT(LAPP.GetRenderDev() || LAPP.IsHeadless());
 
 		if (m_TexturePool.find(name) != m_TexturePool.end())
 		{
@@ -1437,7 +1912,7 @@ LNOINLINE bool ResourcePool::CreateRenderTarget(const char* name)LNOEXCEPT
 		}
 
 		fcyRefPointer<f2dTexture2D> tTexture;
-		if (FCYFAILED(LAPP.GetRenderDev()->CreateRenderTarget(LAPP.GetRenderDev()->GetBufferWidth(),
+		if (!LAPP.IsHeadless() && FCYFAILED(LAPP.GetRenderDev()->CreateRenderTarget(LAPP.GetRenderDev()->GetBufferWidth(),
 			LAPP.GetRenderDev()->GetBufferHeight(), true, &tTexture)))
 		{
 			LERROR("CreateRenderTarget: ȾĿ'%m'ʧ", name);
@@ -1447,8 +1922,9 @@ LNOINLINE bool ResourcePool::CreateRenderTarget(const char* name)LNOEXCEPT
 		try
 		{
 			fcyRefPointer<ResTexture> tRes;
-			tRes.DirectSet(new ResTexture(name, tTexture));
+			tRes.DirectSet(new ResTexture(name, tTexture, true));
 			m_TexturePool.emplace(name, tRes);
+			m_pMgr->InvalidateResourceCache();
 		}
 		catch (const bad_alloc&)
 		{
@@ -1596,6 +2072,8 @@ void ResourceMgr::ClearAllResource()LNOEXCEPT
 
 bool ResourceMgr::LoadPack(const wchar_t* path, const char* passwd)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadPack");
+
 	try
 	{
 		wstring tPath = path;
@@ -1674,6 +2152,8 @@ LNOINLINE void ResourceMgr::UnloadPack(const char* path)LNOEXCEPT
 
 LNOINLINE bool ResourceMgr::LoadFile(const wchar_t* path, fcyRefPointer<fcyMemStream>& outBuf)LNOEXCEPT
 {
+	LPROFILE_ZONE("LoadFile");
+
 	// ԴӸԴ
 	for (auto& i : m_ResPackList)
 	{
@@ -74,13 +74,14 @@ namespace LuaSTGPlus
 		public Resource
 	{
 	private:
-		fcyRefPointer<f2dTexture2D> m_Texture;
+		fcyRefPointer<f2dTexture2D> m_Texture;  // 无窗口模式下为空
+		bool m_bRenderTarget;
 	public:
 		f2dTexture2D* GetTexture() { return m_Texture; }
-		bool IsRenderTarget() { return m_Texture->IsRenderTarget(); }
+		bool IsRenderTarget() { return m_bRenderTarget; }
 	public:
-		ResTexture(const char* name, fcyRefPointer<f2dTexture2D> tex)
-			: Resource(ResourceType::Texture, name), m_Texture(tex) {}
+		ResTexture(const char* name, fcyRefPointer<f2dTexture2D> tex, bool rt = false)
+			: Resource(ResourceType::Texture, name), m_Texture(tex), m_bRenderTarget(tex ? tex->IsRenderTarget() : rt) {}
 	};
 
 	/// @brief 图像资源
@@ -88,7 +89,7 @@ namespace LuaSTGPlus
 		public Resource
 	{
 	private:
-		fcyRefPointer<f2dSprite> m_Sprite;
+		fcyRefPointer<f2dSprite> m_Sprite;  // 无窗口模式下为空
 		BlendMode m_BlendMode = BlendMode::MulAlpha;
 		double m_HalfSizeX = 0.;
 		double m_HalfSizeY = 0.;
@@ -104,7 +105,8 @@ namespace LuaSTGPlus
 		ResSprite(const char* name, fcyRefPointer<f2dSprite> sprite, double hx, double hy, bool rect)
 			: Resource(ResourceType::Sprite, name), m_Sprite(sprite), m_HalfSizeX(hx), m_HalfSizeY(hy), m_bRectangle(rect)
 		{
-			m_Sprite->SetColor(0xFFFFFFFF);  // 适应乘法
+			if (m_Sprite)
+				m_Sprite->SetColor(0xFFFFFFFF);  // 适应乘法
 		}
 	};
 
@@ -113,7 +115,7 @@ namespace LuaSTGPlus
 		public Resource
 	{
 	private:
-		std::vector<fcyRefPointer<f2dSprite>> m_ImageSequences;
+		std::vector<fcyRefPointer<f2dSprite>> m_ImageSequences;  // 无窗口模式下元素为空
 		fuInt m_Interval = 1;
 		BlendMode m_BlendMode = BlendMode::MulAlpha;
 		double m_HalfSizeX = 0.;
@@ -182,27 +184,34 @@ namespace LuaSTGPlus
 			float fColorVar;  // 颜色抖动值
 			float fAlphaVar;  // alpha抖动值
 		};
-		/// @brief 粒子实例
-		struct ParticleInstance
+		/// @brief 粒子实例存储
+		/// @note  以SoA形式存放，每个字段为一个连续数组，便于向量化更新。
+		///        所有数组由按容量分级分配的同一块内存划分而来。
+		struct ParticleStorage
 		{
-			fcyVec2 vecLocation;  // 位置
-			fcyVec2 vecVelocity;  // 速度
+			float* vecLocationX;  // 位置
+			float* vecLocationY;
+			float* vecVelocityX;  // 速度
+			float* vecVelocityY;
 
-			float fGravity;  // 重力
-			float fRadialAccel;  // 线加速度
-			float fTangentialAccel;  // 角加速度
+			float* fGravity;  // 重力
+			float* fRadialAccel;  // 线加速度
+			float* fTangentialAccel;  // 角加速度
 
-			float fSpin;  // 自旋
-			float fSpinDelta;  // 自旋增量
+			float* fSpin;  // 自旋
+			float* fSpinDelta;  // 自旋增量
 
-			float fSize;  // 大小
-			float fSizeDelta;  // 大小增量
+			float* fSize;  // 大小
+			float* fSizeDelta;  // 大小增量
 
-			float colColor[4];  // 颜色
-			float colColorDelta[4];  // 颜色增量
+			float* colColor[4];  // 颜色
+			float* colColorDelta[4];  // 颜色增量
 
-			float fAge;  // 当前存活时间
-			float fTerminalAge;  // 终止时间
+			float* fAge;  // 当前存活时间
+			float* fTerminalAge;  // 终止时间
+
+			/// @brief 字段(数组)个数
+			static const size_t FieldCount = 21;
 		};
 		/// @brief 粒子池
 		class ParticlePool
@@ -225,14 +234,32 @@ namespace LuaSTGPlus
 			size_t m_iAlive = 0;  // 存活数
 			float m_fAge = 0.f;  // 已存活时间
 			float m_fEmission = 0.f;  // 每秒发射数
+			float m_fEmissionScale = 1.f;  // 发射数缩放，由全局粒子预算控制
 			float m_fEmissionResidue = 0.f;  // 不足的粒子数
-			std::array<ParticleInstance, LPARTICLE_MAXCNT> m_ParticlePool;
+			fcyRandomWELL512 m_Random;  // 粒子池独立的随机数发生器，保证结果与更新顺序无关
+			size_t m_iCapacity = 0;  // 最大粒子数，随发射需要扩大
+			bool m_bCapacityWarned = false;  // 是否已警告过扩容失败
+			void* m_pStorage = nullptr;  // 粒子数据所在的内存块
+			ParticleStorage m_Particles;  // 粒子数据
+		private:
+			void bindStorage()LNOEXCEPT;
+			void copyParticle(size_t dest, size_t src)LNOEXCEPT;
+			void removeDeadParticles()LNOEXCEPT;
+			void emitParticle(size_t i, fcyRandomWELL512& rand)LNOEXCEPT;
+			void updateParticles(size_t begin, size_t end, float delta)LNOEXCEPT;
+#ifdef LPARTICLE_USESSE
+			void updateParticlesSSE(size_t count, float delta)LNOEXCEPT;
+#endif
 		public:
 			size_t GetAliveCount()const LNOEXCEPT { return m_iAlive; }
+			size_t GetCapacity()const LNOEXCEPT { return m_iCapacity; }
 			BlendMode GetBlendMode()const LNOEXCEPT { return m_BlendMode; }
 			void SetBlendMode(BlendMode m)LNOEXCEPT { m_BlendMode = m; }
 			float GetEmission()const LNOEXCEPT { return m_fEmission; }
-			void SetEmission(float e)LNOEXCEPT { m_fEmission = e; }
+			/// @brief 设置发射密度，估算的同时存活粒子数超出容量时扩容
+			void SetEmission(float e)LNOEXCEPT;
+			float GetEmissionScale()const LNOEXCEPT { return m_fEmissionScale; }
+			void SetEmissionScale(float s)LNOEXCEPT { m_fEmissionScale = s; }
 			bool IsActived()const LNOEXCEPT { return m_iStatus == Status::Alive; }
 			void SetActive()LNOEXCEPT
 			{
@@ -252,13 +279,44 @@ namespace LuaSTGPlus
 				m_vCenter = pos;
 			}
 			void SetRotation(float r)LNOEXCEPT { m_fRotation = r; }
+			void SetSeed(fuInt seed)LNOEXCEPT { m_Random.SetSeed(seed); }
+
+			/// @brief 扩容到至少可容纳count个粒子
+			/// @note  容量取下一个容量分级，不设上限，存活的粒子会被搬移
+			/// @return 扩容后能否容纳count个粒子
+			bool Reserve(size_t count)LNOEXCEPT;
+			/// @brief 为下一次Update预留发射新粒子所需的容量
+			/// @note  Update可能在工作线程上并行执行而不能分配内存，须在此之前于主线程调用
+			void ReserveForUpdate(float delta)LNOEXCEPT;
 			void Update(float delta);
 			void Render(f2dGraphics2D* graph, float scaleX, float scaleY);
+
+			/// @brief 获取保存状态所需的字节数
+			size_t GetStateSize()const LNOEXCEPT;
+			/// @brief 读取SaveState保存的状态中的存活粒子数
+			/// @return 保存的状态所占的字节数
+			static size_t PeekState(const fByte* src, size_t& alive)LNOEXCEPT;
+			/// @brief 保存状态，只写出存活的粒子
+			/// @return 写出的字节数
+			size_t SaveState(fByte* dest)const LNOEXCEPT;
+			/// @brief 载入SaveState保存的状态，粒子池须由同一粒子资源创建
+			/// @return 读入的字节数，无法容纳保存的粒子时返回0
+			size_t LoadState(const fByte* src)LNOEXCEPT;
 		public:
-			ParticlePool(fcyRefPointer<ResParticle> ref);
+			ParticlePool(fcyRefPointer<ResParticle> ref, size_t capacity, void* storage);
 		};
 	private:
 		static fcyMemPool<sizeof(ParticlePool)> s_MemoryPool;
+		static size_t s_iMemoryUsage;  // 粒子池占用的内存
+		static size_t s_iMemoryPeak;  // 粒子池占用内存的峰值
+	public:
+		/// @brief 获取所有粒子池当前占用的内存(字节)
+		static size_t GetMemoryUsage()LNOEXCEPT { return s_iMemoryUsage; }
+		/// @brief 获取所有粒子池占用内存的峰值(字节)
+		static size_t GetMemoryPeak()LNOEXCEPT { return s_iMemoryPeak; }
+		/// @brief 将峰值重置为当前占用
+		static void ResetMemoryPeak()LNOEXCEPT { s_iMemoryPeak = s_iMemoryUsage; }
+	private:
 
 		fcyRefPointer<f2dSprite> m_BindedSprite;
 		BlendMode m_BlendMode = BlendMode::MulAlpha;
@@ -266,12 +324,20 @@ namespace LuaSTGPlus
 		double m_HalfSizeX = 0.;
 		double m_HalfSizeY = 0.;
 		bool m_bRectangle = false;
+		size_t m_iPoolCapacity = LPARTICLE_MINCNT;  // 粒子池的初始容量，由发射密度和粒子生命期估算
 	public:
+		/// @brief 从capacity起按2的幂扩大，返回不小于count的最小容量分级
+		static size_t NextPoolCapacity(size_t capacity, float count)LNOEXCEPT;
+		/// @brief 按发射密度估算粒子池所需的容量分级
+		static size_t EstimatePoolCapacity(const ParticleInfo& pinfo, float emission)LNOEXCEPT;
+
+		/// @brief 创建粒子池，内存不足时返回nullptr
 		ParticlePool* AllocInstance()LNOEXCEPT;
 		void FreeInstance(ParticlePool* p)LNOEXCEPT;
 
 		f2dSprite* GetBindedSprite()LNOEXCEPT { return m_BindedSprite; }
 		const ParticleInfo& GetParticleInfo()const LNOEXCEPT { return m_ParticleInfo; }
+		size_t GetPoolCapacity()const LNOEXCEPT { return m_iPoolCapacity; }
 		double GetHalfSizeX()const LNOEXCEPT { return m_HalfSizeX; }
 		double GetHalfSizeY()const LNOEXCEPT { return m_HalfSizeY; }
 		bool IsRectangle()const LNOEXCEPT { return m_bRectangle; }
@@ -335,10 +401,12 @@ namespace LuaSTGPlus
 		public Resource
 	{
 	private:
-		fcyRefPointer<f2dSoundBuffer> m_pBuffer;
+		fcyRefPointer<f2dSoundBuffer> m_pBuffer;  // 无窗口模式下为空
 	public:
 		void Play(float vol, float pan)
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Stop();
 
 			float nv = VolumeFix(vol);
@@ -352,27 +420,33 @@ namespace LuaSTGPlus
 
 		void Resume()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Play();
 		}
 
 		void Pause()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Pause();
 		}
 
 		void Stop()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Stop();
 		}
 
 		bool IsPlaying()
 		{
-			return m_pBuffer->IsPlaying();
+			return m_pBuffer && m_pBuffer->IsPlaying();
 		}
 
 		bool IsStopped()
 		{
-			return !IsPlaying() && m_pBuffer->GetTime() == 0.;
+			return !IsPlaying() && (!m_pBuffer || m_pBuffer->GetTime() == 0.);
 		}
 	public:
 		ResSound(const char* name, fcyRefPointer<f2dSoundBuffer> buffer)
@@ -417,10 +491,12 @@ namespace LuaSTGPlus
 			BGMWrapper(fcyRefPointer<f2dSoundDecoder> pOrg, fDouble LoopStart, fDouble LoopEnd);
 		};
 	private:
-		fcyRefPointer<f2dSoundBuffer> m_pBuffer;
+		fcyRefPointer<f2dSoundBuffer> m_pBuffer;  // 无窗口模式下为空
 	public:
 		void Play(float vol, double position)
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Stop();
 			m_pBuffer->SetTime(position);
 
@@ -433,31 +509,39 @@ namespace LuaSTGPlus
 		
 		void Stop()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Stop();
 		}
 		
 		void Pause()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Pause();
 		}
 		
 		void Resume()
 		{
+			if (!m_pBuffer)
+				return;
 			m_pBuffer->Play();
 		}
 
 		bool IsPlaying()
 		{
-			return m_pBuffer->IsPlaying();
+			return m_pBuffer && m_pBuffer->IsPlaying();
 		}
 
 		bool IsStopped()
 		{
-			return !IsPlaying() && m_pBuffer->GetTime() == 0.;
+			return !IsPlaying() && (!m_pBuffer || m_pBuffer->GetTime() == 0.);
 		}
 
 		void SetVolume(float v)
 		{
+			if (!m_pBuffer)
+				return;
 			float nv = VolumeFix(v);
 			if (m_pBuffer->GetVolume() != nv)
 				m_pBuffer->SetVolume(nv);
@@ -511,7 +595,14 @@ namespace LuaSTGPlus
 		Dictionary<fcyRefPointer<ResFont>> m_SpriteFontPool;
 		Dictionary<fcyRefPointer<ResFont>> m_TTFFontPool;
 		Dictionary<fcyRefPointer<ResFX>> m_FXPool;
+
+		// 可作为对象图像的资源（图像、动画、粒子）的名称索引，同名时只记录优先级最高者
+		Dictionary<Resource*> m_ImageIndex;
 	private:
+		/// @brief 重新计算某个名称在图像索引中的条目
+		/// @note 加载或移除图像、动画、粒子后调用
+		void updateImageIndex(const char* name);
+
 		const wchar_t* getResourcePoolTypeName()
 		{
 			switch (m_iType)
@@ -724,6 +815,17 @@ namespace LuaSTGPlus
 			else
 				return i->second;
 		}
+
+		/// @brief 获取可作为对象图像的资源
+		/// @note 同名时图像优先于动画，动画优先于粒子
+		Resource* GetImageResource(const char* name)LNOEXCEPT
+		{
+			auto i = m_ImageIndex.find(name);
+			if (i == m_ImageIndex.end())
+				return nullptr;
+			else
+				return i->second;
+		}
 	private:
 		ResourcePool& operator=(const ResourcePool&);
 		ResourcePool(const ResourcePool&);
@@ -774,6 +876,8 @@ namespace LuaSTGPlus
 		ResourcePoolType m_ActivedPool = ResourcePoolType::Global;
 		ResourcePool m_GlobalResourcePool;
 		ResourcePool m_StageResourcePool;
+
+		fuInt m_iResourceGeneration = 0;
 	public:
 		float GetGlobalImageScaleFactor()const LNOEXCEPT{ return m_GlobalImageScaleFactor; }
 		void SetGlobalImageScaleFactor(float s)LNOEXCEPT{ m_GlobalImageScaleFactor = s; }
@@ -782,6 +886,14 @@ namespace LuaSTGPlus
 		float GetGlobalMusicVolume()const LNOEXCEPT{ return m_GlobalMusicVolume; }
 		void SetGlobalMusicVolume(float s)LNOEXCEPT{ m_GlobalMusicVolume = s; }
 
+		/// @brief 获得资源代数
+		/// @note 每当有资源被加载、移除或资源池被清空时递增，用于判断缓存的资源指针是否仍然有效
+		///       加载同样需要递增，因为新资源可能遮蔽另一个资源池中的同名资源
+		fuInt GetResourceGeneration()const LNOEXCEPT { return m_iResourceGeneration; }
+
+		/// @brief 使所有缓存的资源指针失效
+		void InvalidateResourceCache()LNOEXCEPT { ++m_iResourceGeneration; }
+
 		/// @brief 获得当前激活的资源池类型
 		ResourcePoolType GetActivedPoolType()LNOEXCEPT
 		{
@@ -873,6 +985,11 @@ namespace LuaSTGPlus
 			fcyRefPointer<ResTexture> tRet = FindTexture(texname);
 			if (!tRet)
 				return false;
+			if (!tRet->GetTexture())  // 无窗口模式下不知道纹理尺寸
+			{
+				out.Set(0.f, 0.f);
+				return true;
+			}
 			out.x = static_cast<float>(tRet->GetTexture()->GetWidth());
 			out.y = static_cast<float>(tRet->GetTexture()->GetHeight());
 			return true;
@@ -949,6 +1066,52 @@ namespace LuaSTGPlus
 				tRet = m_GlobalResourcePool.GetFX(name);
 			return tRet;
 		}
+
+		/// @brief 寻找可作为对象图像的资源（图像、动画、粒子）
+		/// @note 与依次调用FindSprite、FindAnimation、FindParticle的结果一致，
+		///       即资源类型优先，同类型时关卡资源池优先。每个资源池只需查找一次。
+		Resource* FindImageResource(const char* name)LNOEXCEPT
+		{
+			Resource* tStage = m_StageResourcePool.GetImageResource(name);
+			if (tStage && tStage->GetType() == ResourceType::Sprite)
+				return tStage;
+			Resource* tGlobal = m_GlobalResourcePool.GetImageResource(name);
+			if (!tStage)
+				return tGlobal;
+			if (!tGlobal)
+				return tStage;
+			// 枚举值Sprite < Animation < Particle恰好与优先级顺序一致
+			return tGlobal->GetType() < tStage->GetType() ? tGlobal : tStage;
+		}
+
+		/// @brief 按类型寻找资源
+		/// @note 返回的指针由资源池持有，仅在资源代数改变前有效
+		Resource* FindResource(ResourceType t, const char* name)LNOEXCEPT
+		{
+			switch (t)
+			{
+			case ResourceType::Texture:
+				return FindTexture(name);
+			case ResourceType::Sprite:
+				return FindSprite(name);
+			case ResourceType::Animation:
+				return FindAnimation(name);
+			case ResourceType::Music:
+				return FindMusic(name);
+			case ResourceType::SoundEffect:
+				return FindSound(name);
+			case ResourceType::Particle:
+				return FindParticle(name);
+			case ResourceType::SpriteFont:
+				return FindSpriteFont(name);
+			case ResourceType::TrueTypeFont:
+				return FindTTFFont(name);
+			case ResourceType::FX:
+				return FindFX(name);
+			default:
+				return nullptr;
+			}
+		}
 	public:
 		ResourceMgr();
 	};
@@ -0,0 +1,113 @@
+﻿#pragma once
+#include "Global.h"
+
+namespace LuaSTGPlus
+{
+	/// @brief 容量为2的幂的环形缓冲区下标管理器
+	/// @note  只维护队首位置和元素数量，数据由使用者以若干数组(SoA)的形式自行持有。
+	///        下标换算使用掩码而非取余。
+	class RingBufferIndex
+	{
+	public:
+		/// @brief 连续区间
+		struct Span
+		{
+			size_t Begin;  // 起始槽位
+			size_t Count;  // 元素个数
+		};
+	private:
+		size_t m_Mask = 0;
+		size_t m_Front = 0;
+		size_t m_Count = 0;
+	public:
+		/// @brief 检查是否为2的幂
+		static bool IsPowerOfTwo(size_t v) { return v != 0 && (v & (v - 1)) == 0; }
+
+		/// @brief 取不小于v的2的幂
+		static size_t NextPowerOfTwo(size_t v)
+		{
+			size_t tRet = 1;
+			while (tRet < v)
+				tRet <<= 1;
+			return tRet;
+		}
+	public:
+		/// @brief 将逻辑下标(0为队首)换算为数组槽位
+		size_t operator[](size_t idx)const
+		{
+			LASSERT(idx < m_Count);
+			return (m_Front + idx) & m_Mask;
+		}
+		bool IsEmpty()const { return m_Count == 0; }
+		bool IsFull()const { return m_Count > m_Mask; }
+		size_t Size()const { return m_Count; }
+		size_t Capacity()const { return m_Mask + 1; }
+
+		/// @brief 队首槽位
+		size_t Front()const
+		{
+			LASSERT(!IsEmpty());
+			return m_Front;
+		}
+
+		/// @brief 队尾槽位
+		size_t Back()const
+		{
+			LASSERT(!IsEmpty());
+			return (m_Front + m_Count - 1) & m_Mask;
+		}
+
+		/// @brief 在队尾追加一个元素
+		/// @return 新元素的槽位
+		size_t Push()
+		{
+			LASSERT(!IsFull());
+			size_t tSlot = (m_Front + m_Count) & m_Mask;
+			++m_Count;
+			return tSlot;
+		}
+
+		/// @brief 移除队首元素
+		/// @return 被移除元素的槽位
+		size_t Pop()
+		{
+			LASSERT(!IsEmpty());
+			size_t tSlot = m_Front;
+			m_Front = (m_Front + 1) & m_Mask;
+			--m_Count;
+			return tSlot;
+		}
+
+		/// @brief 获取所有元素所在的两段连续区间
+		/// @note  按逻辑顺序先遍历first再遍历second，未回绕时second.Count为0
+		void GetSpans(Span& first, Span& second)const
+		{
+			size_t tTail = Capacity() - m_Front;
+			first.Begin = m_Front;
+			second.Begin = 0;
+			if (m_Count <= tTail)
+			{
+				first.Count = m_Count;
+				second.Count = 0;
+			}
+			else
+			{
+				first.Count = tTail;
+				second.Count = m_Count - tTail;
+			}
+		}
+
+		/// @brief 清空并重新设置容量
+		/// @param[in] capacity 容量，必须为2的幂
+		void Reset(size_t capacity)
+		{
+			LASSERT(IsPowerOfTwo(capacity));
+			m_Mask = capacity - 1;
+			m_Front = 0;
+			m_Count = 0;
+		}
+	public:
+		RingBufferIndex() {}
+		explicit RingBufferIndex(size_t capacity) { Reset(capacity); }
+	};
+}
@@ -39,6 +39,36 @@ namespace LuaSTGPlus
 		}
 	};
 
+	/// @brief ۼƼʱ
+	/// @note  Stopʱʱۼӵ
+	class AccumulatedTimerScope
+	{
+	private:
+		fcyStopWatch m_StopWatch;
+		float* m_pOut;
+	private:
+		AccumulatedTimerScope& operator=(const AccumulatedTimerScope&);
+		AccumulatedTimerScope(const AccumulatedTimerScope&);
+	public:
+		void Stop()
+		{
+			if (m_pOut)
+			{
+				*m_pOut += static_cast<float>(m_StopWatch.GetElapsed());
+				m_pOut = nullptr;
+			}
+		}
+	public:
+		AccumulatedTimerScope(float& Out)
+			: m_pOut(&Out)
+		{
+		}
+		~AccumulatedTimerScope()
+		{
+			Stop();
+		}
+	};
+
 	/// @brief ַʽ
 	/// @param Format ַʽ֧־
 	std::string StringFormat(const char* Format, ...)LNOEXCEPT;
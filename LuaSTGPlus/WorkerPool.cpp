@@ -0,0 +1,149 @@
+﻿#include "WorkerPool.h"
+#include "Profiler.h"
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+WorkerPool::WorkerPool(size_t workerCount)
+	: m_Queues(new ChunkQueue[workerCount + 1])
+{
+	for (size_t i = 0; i < workerCount; ++i)
+		m_Workers.emplace_back(&WorkerPool::workerThread, this, i + 1);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> tLock(m_Lock);
+		m_bExit = true;
+	}
+	m_JobCond.notify_all();
+
+	for (auto& i : m_Workers)
+	{
+		if (i.joinable())
+			i.join();
+	}
+}
+
+bool WorkerPool::popChunk(size_t self, size_t& chunk)LNOEXCEPT
+{
+	ChunkQueue& tQueue = m_Queues[self];
+	lock_guard<mutex> tLock(tQueue.lock);
+	if (tQueue.begin >= tQueue.end)
+		return false;
+	chunk = tQueue.begin++;
+	return true;
+}
+
+bool WorkerPool::stealChunks(size_t self, size_t& chunk)LNOEXCEPT
+{
+	size_t tQueueCount = m_Workers.size() + 1;
+	for (size_t i = 1; i < tQueueCount; ++i)
+	{
+		ChunkQueue& tVictim = m_Queues[(self + i) % tQueueCount];
+		size_t tBegin, tEnd;
+		{
+			lock_guard<mutex> tLock(tVictim.lock);
+			if (tVictim.begin >= tVictim.end)
+				continue;
+
+			// 窃取剩余区间的后一半，对方继续从头部顺序执行
+			tBegin = tVictim.end - (tVictim.end - tVictim.begin + 1) / 2;
+			tEnd = tVictim.end;
+			tVictim.end = tBegin;
+		}
+
+		// 第一块立即执行，其余放入自己的队列供自己取用或被他人窃取
+		ChunkQueue& tQueue = m_Queues[self];
+		{
+			lock_guard<mutex> tLock(tQueue.lock);
+			tQueue.begin = tBegin + 1;
+			tQueue.end = tEnd;
+		}
+		chunk = tBegin;
+		return true;
+	}
+
+	// 任务块只会在队列间转移而不会新增，所有队列为空时本线程可以结束
+	return false;
+}
+
+void WorkerPool::runChunks(size_t self)LNOEXCEPT
+{
+	size_t tChunk;
+	while (popChunk(self, tChunk) || stealChunks(self, tChunk))
+	{
+		size_t tBegin = tChunk * m_iJobGrain;
+		(*m_pJob)(tBegin, min(tBegin + m_iJobGrain, m_iJobCount));
+	}
+}
+
+void WorkerPool::workerThread(size_t self)LNOEXCEPT
+{
+	LPROFILER.RegisterThread("Worker");
+
+	uint64_t tLastGeneration = 0;
+	while (true)
+	{
+		{
+			unique_lock<mutex> tLock(m_Lock);
+			m_JobCond.wait(tLock, [&]() { return m_bExit || m_iGeneration != tLastGeneration; });
+			if (m_bExit)
+				return;
+			tLastGeneration = m_iGeneration;
+		}
+
+		runChunks(self);
+
+		{
+			lock_guard<mutex> tLock(m_Lock);
+			if (--m_iBusyWorkers == 0)
+				m_DoneCond.notify_one();
+		}
+	}
+}
+
+void WorkerPool::ParallelFor(size_t count, size_t grain, const RangeJob& job)LNOEXCEPT
+{
+	if (count == 0)
+		return;
+	if (grain == 0)
+		grain = 1;
+
+	// 任务量不足以拆分时直接在调用线程上执行
+	if (m_Workers.empty() || count <= grain)
+	{
+		job(0, count);
+		return;
+	}
+
+	{
+		lock_guard<mutex> tLock(m_Lock);
+		m_pJob = &job;
+		m_iJobCount = count;
+		m_iJobGrain = grain;
+
+		// 按连续区间均分任务块，相邻的块由同一线程执行
+		size_t tChunkCount = (count + grain - 1) / grain;
+		size_t tQueueCount = m_Workers.size() + 1;
+		for (size_t i = 0; i < tQueueCount; ++i)
+		{
+			lock_guard<mutex> tQueueLock(m_Queues[i].lock);
+			m_Queues[i].begin = tChunkCount * i / tQueueCount;
+			m_Queues[i].end = tChunkCount * (i + 1) / tQueueCount;
+		}
+
+		m_iBusyWorkers = m_Workers.size();
+		++m_iGeneration;
+	}
+	m_JobCond.notify_all();
+
+	// 调用线程同样参与执行
+	runChunks(0);
+
+	// 等待所有工作线程退出当前批次
+	unique_lock<mutex> tLock(m_Lock);
+	m_DoneCond.wait(tLock, [&]() { return m_iBusyWorkers == 0; });
+	m_pJob = nullptr;
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include "Global.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace LuaSTGPlus
+{
+	/// @brief 工作线程池
+	/// @note  用于将彼此独立的任务分块并行执行，调用线程同样参与执行。
+	///        任务之间不能有依赖，也不能访问lua虚拟机。
+	///        任务块预先按连续区间均分给各线程，线程做完自己的部分后从其他线程的区间尾部窃取一半。
+	class WorkerPool
+	{
+	public:
+		/// @brief 任务函数，处理下标区间[begin, end)
+		typedef std::function<void(size_t, size_t)> RangeJob;
+	private:
+		/// @brief 线程持有的任务块区间[begin, end)
+		struct ChunkQueue
+		{
+			std::mutex lock;
+			size_t begin = 0;
+			size_t end = 0;
+			char padding[64];  // 避免相邻队列伪共享
+		};
+	private:
+		std::vector<std::thread> m_Workers;
+		std::unique_ptr<ChunkQueue[]> m_Queues;  // 下标0为调用线程，其余依次对应工作线程
+
+		std::mutex m_Lock;
+		std::condition_variable m_JobCond;  // 通知有新任务
+		std::condition_variable m_DoneCond;  // 通知任务完成
+		uint64_t m_iGeneration = 0;  // 任务批次
+		size_t m_iBusyWorkers = 0;  // 尚未完成当前批次的工作线程数
+		bool m_bExit = false;
+
+		// 当前批次
+		const RangeJob* m_pJob = nullptr;
+		size_t m_iJobCount = 0;
+		size_t m_iJobGrain = 1;
+	private:
+		void workerThread(size_t self)LNOEXCEPT;
+		bool popChunk(size_t self, size_t& chunk)LNOEXCEPT;
+		bool stealChunks(size_t self, size_t& chunk)LNOEXCEPT;
+		void runChunks(size_t self)LNOEXCEPT;
+	public:
+		/// @brief 获取工作线程数(不含调用线程)
+		size_t GetWorkerCount()const LNOEXCEPT { return m_Workers.size(); }
+
+		/// @brief 并行执行任务
+		/// @param[in] count 下标总数
+		/// @param[in] grain 每块的下标数
+		/// @param[in] job   任务函数，会被以互不重叠的区间调用若干次
+		/// @note  返回时所有区间均已处理完毕
+		void ParallelFor(size_t count, size_t grain, const RangeJob& job)LNOEXCEPT;
+	protected:
+		WorkerPool& operator=(const WorkerPool&);
+		WorkerPool(const WorkerPool&);
+	public:
+		/// @brief 构造线程池
+		/// @param[in] workerCount 工作线程数，为0时所有任务在调用线程上执行
+		WorkerPool(size_t workerCount);
+		~WorkerPool();
+	};
+}
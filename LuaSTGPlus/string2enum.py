@@ -140,6 +140,75 @@ def final_hash_func(key, idx_list, T1, T2, g_table, m):
     n = len(g_table)
     return (g_table[keyhash(key, T1, idx_list, n)] + g_table[keyhash(key, T2, idx_list, n)]) % m
 
+def char_literal(c, wide_char):
+    prefix = u'L' if wide_char else u''
+    if c == u'\0':
+        return prefix + u"'\\0'"
+    return prefix + u"'%s'" % c
+
+def string_literal(s, wide_char):
+    return (u'L' if wide_char else u'') + u'"%s"' % s
+
+# generate nested switch on characters
+# each key is resolved by switching on its leading characters until only one candidate remains,
+# then the rest of the key is checked with a single compare
+# after changing the generator, run the PropertyHashTest project to check the result against the old lookup
+def write_switch(out_file, options, items, depth, indent):
+    wide_char = options["wide_char"]
+    enum_name = options["enum_name"]
+    tab = u"\t" * indent
+    groups = {}
+    order = []
+    for key, value in items:
+        c = charat(key, depth)
+        if c not in groups:
+            groups[c] = []
+            order.append(c)
+        groups[c].append((key, value))
+    out_file.write(tab + u"switch (key[%d])\n" % depth)
+    out_file.write(tab + u"{\n")
+    for c in sorted(order):
+        group = groups[c]
+        out_file.write(tab + u"case %s:\n" % char_literal(c, wide_char))
+        if c == u'\0':
+            # the key ends here
+            out_file.write(tab + u"\treturn %s::%s;\n" % (enum_name, group[0][1]))
+        elif len(group) == 1:
+            key, value = group[0]
+            rest = key[depth + 1:]
+            if len(rest) == 0:
+                cond = u"key[%d] == %s" % (depth + 1, char_literal(u'\0', wide_char))
+            else:
+                cond = u"%s(key + %d, %s) == 0" % (options["strcmp"], depth + 1, string_literal(rest, wide_char))
+            out_file.write(tab + u"\treturn %s ? %s::%s : %s::_KEY_NOT_FOUND;\n" % (cond, enum_name, value, enum_name))
+        else:
+            write_switch(out_file, options, group, depth + 1, indent + 1)
+    out_file.write(tab + u"default:\n")
+    out_file.write(tab + u"\treturn %s::_KEY_NOT_FOUND;\n" % enum_name)
+    out_file.write(tab + u"}\n")
+
+def generated_switch(options, keys, enums):
+    char_type = "wchar_t" if options["wide_char"] else "char"
+    with open(options["output"], "w") as out_file:
+        out_file.write(u"#pragma once\n")
+        out_file.write(u"#include <cstring>\n")
+        out_file.write(u"\n")
+        out_file.write(u"namespace %s\n" % options["namespace"])
+        out_file.write(u"{\n")
+        out_file.write(u"\tenum class %s\n" % options["enum_name"])
+        out_file.write(u"\t{\n")
+        for i in range(0, len(enums)):
+            out_file.write(u"\t\t%s = %d,\n" % (enums[i], i))
+        out_file.write(u"\t\t_KEY_NOT_FOUND = -1\n")
+        out_file.write(u"\t};\n")
+        out_file.write(u"\n")
+        out_file.write(u"\tinline %s %s(const %s* key)\n" % (options["enum_name"], options["hashfunc_name"], char_type))
+        out_file.write(u"\t{\n")
+        write_switch(out_file, options, list(zip(keys, enums)), 0, 2)
+        out_file.write(u"\t}\n")
+        out_file.write(u"}\n")
+    print("*** finished")
+
 def generated_mpf(filename):
     with open(filename, "r") as f:
         options = json.load(f)
@@ -152,6 +221,10 @@ def generated_mpf(filename):
         enums.append(item[1])
         keydict[item[0]] = item[1]
         enumdict[item[1]] = item[0]
+    # "switch" method: nested character switch, no hash table needed
+    if options.get("method", "mpf") == "switch":
+        generated_switch(options, keys, enums)
+        return
     # step1: find best indices
     best_indices = find_best_indices(keys)
     # step2: generate random table and graph
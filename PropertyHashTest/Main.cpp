@@ -0,0 +1,224 @@
+﻿/// @file Main.cpp
+/// @brief GameObjectPropertyHash的一致性测试与性能测试
+/// @note  对比string2enum.py生成的逐字符switch与原先的完美哈希实现。
+///        一致性测试检查所有属性名以及若干用户字段名在两种实现下得到相同的结果；
+///        性能测试按接近实际脚本的比例混合访问属性与用户字段，输出每次查找的纳秒数。
+///        用法: PropertyHashTest，结果不一致时返回1。
+#include "../LuaSTGPlus/Global.h"
+#include "../LuaSTGPlus/GameObjectPropertyHash.inl"
+
+#include <random>
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+namespace Baseline
+{
+	/// @brief 原先的GameObjectPropertyHash，由旧版string2enum.py生成的完美哈希
+	inline GameObjectProperty GameObjectPropertyHash(const char* key)
+	{
+		static const char* s_orgKeyList[] =
+		{
+			"x",
+			"y",
+			"dx",
+			"dy",
+			"rot",
+			"omiga",
+			"timer",
+			"vx",
+			"vy",
+			"ax",
+			"ay",
+			"layer",
+			"group",
+			"hide",
+			"bound",
+			"navi",
+			"colli",
+			"status",
+			"hscale",
+			"vscale",
+			"class",
+			"a",
+			"b",
+			"rect",
+			"img",
+			"ani",
+		};
+
+		static const unsigned int s_bestIndices[] =
+		{
+			0, 1,
+		};
+
+		static const unsigned int s_hashTable1[] =
+		{
+			191, 127,
+		};
+
+		static const unsigned int s_hashTable2[] =
+		{
+			239, 14,
+		};
+
+		static const unsigned int s_hashTableG[] =
+		{
+			0, 0, 0, 0, 15, 0, 0, 0, 0, 16,
+			13, 0, 19, 0, 9, 0, 12, 0, 0, 5,
+			4, 22, 8, 23, 13, 16, 22, 0, 0, 15,
+			22, 20, 8, 14, 19, 0, 14, 21, 6, 0,
+			20, 17, 0,
+		};
+
+		unsigned int f1 = 0, f2 = 0, len = strlen(key);
+		for (unsigned int i = 0; i < 2; ++i)
+		{
+			unsigned int idx = s_bestIndices[i];
+			if (idx < len)
+			{
+				f1 = (f1 + s_hashTable1[i] * (unsigned int)key[idx]) % 43;
+				f2 = (f2 + s_hashTable2[i] * (unsigned int)key[idx]) % 43;
+			}
+			else
+				break;
+		}
+
+		unsigned int hash = (s_hashTableG[f1] + s_hashTableG[f2]) % 26;
+		if (strcmp(s_orgKeyList[hash], key) == 0)
+			return static_cast<GameObjectProperty>(hash);
+		return GameObjectProperty::_KEY_NOT_FOUND;
+	}
+}
+
+/// @brief 属性名，顺序同GameObjectProperty
+static const char* const s_PropertyKeys[] =
+{
+	"x", "y", "dx", "dy", "rot", "omiga", "timer", "vx", "vy", "ax", "ay", "layer", "group",
+	"hide", "bound", "navi", "colli", "status", "hscale", "vscale", "class", "a", "b", "rect", "img", "ani",
+};
+
+/// @brief 常见的用户字段名，包括与属性名有相同前缀或只差一个字符的名称
+static const char* const s_UserKeys[] =
+{
+	"hp", "speed", "angle", "_blend", "_a", "_r", "_g", "_b", "x0", "y0", "vx0", "tx", "ty", "t", "v",
+	"delay", "image", "imgs", "layers", "rota", "timer2", "is_class", "_servants", "colli_group", "", "aa", "xy",
+};
+
+/// @brief 查找的键与出现次数，用于构造混合访问序列
+struct WeightedKey
+{
+	const char* key;
+	unsigned weight;
+};
+
+/// @brief 接近实际脚本的访问比例，运动与计时相关的属性最为频繁，约三成为用户字段
+static const WeightedKey s_Mix[] =
+{
+	{ "x", 8 }, { "y", 8 }, { "vx", 4 }, { "vy", 4 }, { "rot", 5 }, { "timer", 6 }, { "img", 3 }, { "layer", 3 },
+	{ "hide", 2 }, { "colli", 2 }, { "group", 1 }, { "a", 1 }, { "b", 1 }, { "omiga", 1 }, { "hscale", 1 }, { "status", 1 },
+	{ "hp", 4 }, { "speed", 3 }, { "angle", 3 }, { "_blend", 2 }, { "_a", 1 }, { "x0", 1 }, { "delay", 1 }, { "t", 1 }, { "image", 1 },
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// 一致性测试
+////////////////////////////////////////////////////////////////////////////////
+
+static int RunConsistencyTest()
+{
+	int tFailures = 0;
+	for (size_t i = 0; i < _countof(s_PropertyKeys); ++i)
+	{
+		GameObjectProperty tNew = GameObjectPropertyHash(s_PropertyKeys[i]);
+		GameObjectProperty tOld = Baseline::GameObjectPropertyHash(s_PropertyKeys[i]);
+		if (tNew != static_cast<GameObjectProperty>(i) || tOld != tNew)
+		{
+			printf("mismatch on property '%s': new %d, baseline %d\n", s_PropertyKeys[i], (int)tNew, (int)tOld);
+			++tFailures;
+		}
+	}
+	for (size_t i = 0; i < _countof(s_UserKeys); ++i)
+	{
+		GameObjectProperty tNew = GameObjectPropertyHash(s_UserKeys[i]);
+		GameObjectProperty tOld = Baseline::GameObjectPropertyHash(s_UserKeys[i]);
+		if (tNew != GameObjectProperty::_KEY_NOT_FOUND || tOld != tNew)
+		{
+			printf("mismatch on user field '%s': new %d, baseline %d\n", s_UserKeys[i], (int)tNew, (int)tOld);
+			++tFailures;
+		}
+	}
+	return tFailures;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 性能测试
+////////////////////////////////////////////////////////////////////////////////
+
+static int s_iChecksum = 0;  // 防止查找被优化掉
+
+template <GameObjectProperty(*Lookup)(const char*)>
+static double RunBench(const vector<const char*>& keys, size_t rounds)
+{
+	fcyStopWatch tWatch;
+	for (size_t r = 0; r < rounds; ++r)
+	{
+		for (size_t i = 0; i < keys.size(); ++i)
+			s_iChecksum += (int)Lookup(keys[i]);
+	}
+	return tWatch.GetElapsed() * 1e9 / (double)(rounds * keys.size());
+}
+
+static void RunBenchmarks()
+{
+	static const size_t s_OpsPerCase = 20000000;  // 每项约执行的查找数
+
+	// 键的字符串各自独立分配，与lua字符串一样不共享字面量的地址
+	vector<string> tStorage;
+	vector<WeightedKey> tMix(s_Mix, s_Mix + _countof(s_Mix));
+	for (size_t i = 0; i < tMix.size(); ++i)
+		tStorage.push_back(tMix[i].key);
+
+	struct Case
+	{
+		const char* name;
+		vector<const char*> keys;
+	};
+	Case tCases[3] = { { "mixed" }, { "hit only" }, { "miss only" } };
+
+	mt19937 tRnd(1);
+	for (size_t i = 0; i < tMix.size(); ++i)
+	{
+		bool bHit = GameObjectPropertyHash(tStorage[i].c_str()) != GameObjectProperty::_KEY_NOT_FOUND;
+		for (unsigned w = 0; w < tMix[i].weight * 64; ++w)
+		{
+			tCases[0].keys.push_back(tStorage[i].c_str());
+			tCases[bHit ? 1 : 2].keys.push_back(tStorage[i].c_str());
+		}
+	}
+	for (int c = 0; c < 3; ++c)
+		shuffle(tCases[c].keys.begin(), tCases[c].keys.end(), tRnd);
+
+	printf("%-10s %10s %10s\n", "keys", "switch", "baseline");
+	for (int c = 0; c < 3; ++c)
+	{
+		size_t tRounds = max<size_t>(s_OpsPerCase / tCases[c].keys.size(), 1);
+		double tNew = RunBench<&GameObjectPropertyHash>(tCases[c].keys, tRounds);
+		double tOld = RunBench<&Baseline::GameObjectPropertyHash>(tCases[c].keys, tRounds);
+		printf("%-10s %8.2fns %8.2fns\n", tCases[c].name, tNew, tOld);
+	}
+	printf("(checksum %d)\n", s_iChecksum);
+}
+
+int main()
+{
+	int tFailures = RunConsistencyTest();
+	if (tFailures > 0)
+	{
+		printf("consistency test FAILED: %d key(s)\n", tFailures);
+		return 1;
+	}
+	printf("consistency test passed\n\n");
+
+	RunBenchmarks();
+	return 0;
+}
@@ -0,0 +1,516 @@
+﻿/// @file Main.cpp
+/// @brief 渲染路径的差分测试
+/// @note  以不进行实际绘制的方式对比合批后的顶点与原先逐个提交的顶点。
+///        曲线激光: 固定的节点序列分别经由原先的逐段四边形和GameObjectBentLaser::BuildVertices生成，
+///        按索引缓冲还原每一段的四边形后比较顶点坐标与纹理坐标。
+///        粒子: 同一组粒子分别经由原先的逐个设置精灵颜色并调用Draw2和SubmitParticleBatches生成，
+///        以记录绘制调用的设备代替f2dGraphics2D，比较每个粒子的四边形。
+///        用法: RenderTest，存在差异时返回1。
+#include "../LuaSTGPlus/GameObjectBentLaser.h"
+#include "../LuaSTGPlus/ParticleBatch.h"
+
+#include <random>
+
+using namespace std;
+using namespace LuaSTGPlus;
+
+// 容许的相对误差
+// 急转弯处的斜接长度对舍入误差很敏感，两种实现先缩放后归一化的顺序不同，因此不使用绝对误差
+static const float s_Epsilon = 0.0001f;
+
+static int s_iFailures = 0;
+
+#define CHECK(cond, name, item) \
+	if (!(cond)) \
+	{ \
+		if (s_iFailures++ < 16) \
+			printf("check failed at line %d (%s, #%u): %s\n", __LINE__, name, (unsigned)(item), #cond); \
+	}
+
+/// @brief 四边形，顶点顺序同LAPP.RenderTexture
+struct Quad
+{
+	f2dGraphics2DVertex v[4];
+};
+
+static bool NearlyEqual(float a, float b)
+{
+	return fabs(a - b) <= s_Epsilon * max(1.f, fabs(a));
+}
+
+static bool NearlyEqual(const f2dGraphics2DVertex& a, const f2dGraphics2DVertex& b)
+{
+	return NearlyEqual(a.x, b.x) && NearlyEqual(a.y, b.y) && NearlyEqual(a.u, b.u) && NearlyEqual(a.v, b.v) &&
+		a.z == b.z && a.color == b.color;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 曲线激光
+////////////////////////////////////////////////////////////////////////////////
+
+namespace Baseline
+{
+	/// @brief 原先的曲线激光实现，逐段生成四边形
+	/// @note  节点队列与总长度的维护同原先的Update，Render中的LAPP.RenderTexture换为记录四边形
+	class BentLaser
+	{
+	private:
+		struct LaserNode
+		{
+			fcyVec2 pos;
+			float half_width;
+		};
+		vector<LaserNode> m_Queue;
+		size_t m_iMaxSize;
+		float m_fLength = 0.f;
+	public:
+		void Update(fcyVec2 pos, int length, float width)
+		{
+			// 移除多余的节点，保证长度在length范围内
+			while (m_Queue.size() >= m_iMaxSize || m_Queue.size() >= (size_t)length)
+			{
+				LaserNode tLastPop = m_Queue.front();
+				m_Queue.erase(m_Queue.begin());
+
+				// 减少总长度
+				if (!m_Queue.empty())
+				{
+					LaserNode tFront = m_Queue.front();
+					m_fLength -= (tLastPop.pos - tFront.pos).Length();
+				}
+			}
+
+			// 添加新节点
+			LaserNode tNode;
+			tNode.pos = pos;
+			tNode.half_width = width / 2.f;
+			m_Queue.push_back(tNode);
+
+			// 增加总长度
+			if (m_Queue.size() > 1)
+				m_fLength += (m_Queue[m_Queue.size() - 2].pos - m_Queue.back().pos).Length();
+		}
+
+		/// @brief 生成各段的四边形，纹理坐标以纹素为单位
+		void Render(vector<Quad>& out, fcyColor c, float tex_left, float tex_top, float tex_width, float tex_height, float scale)const
+		{
+			if (m_Queue.size() <= 1)
+				return;
+
+			Quad renderVertex = { {
+				{ 0, 0, 0.5f, c.argb, 0, tex_top },
+				{ 0, 0, 0.5f, c.argb, 0, tex_top },
+				{ 0, 0, 0.5f, c.argb, 0, tex_top + tex_height },
+				{ 0, 0, 0.5f, c.argb, 0, tex_top + tex_height }
+			} };
+			f2dGraphics2DVertex* v = renderVertex.v;
+
+			float tVecLength = 0;
+			for (size_t i = 0; i < m_Queue.size() - 1; ++i)
+			{
+				const LaserNode& cur = m_Queue[i];
+				const LaserNode& next = m_Queue[i + 1];
+
+				// === 计算最左侧的两个点 ===
+				fcyVec2 offsetA = cur.pos - next.pos;
+				float lenOffsetA = offsetA.Length();
+				if (lenOffsetA < 0.0001f && i + 1 != m_Queue.size() - 1)
+					continue;
+
+				fcyVec2 expandVec = offsetA.GetNormalize();
+				std::swap(expandVec.x, expandVec.y);
+				expandVec.y = -expandVec.y;
+
+				if (i == 0)
+				{
+					float expX = expandVec.x * scale * cur.half_width;
+					float expY = expandVec.y * scale * cur.half_width;
+					v[0].x = cur.pos.x + expX;
+					v[0].y = cur.pos.y + expY;
+					v[0].u = tex_left;
+					v[3].x = cur.pos.x - expX;
+					v[3].y = cur.pos.y - expY;
+					v[3].u = tex_left;
+				}
+				else
+				{
+					v[0].x = v[1].x;
+					v[0].y = v[1].y;
+					v[0].u = v[1].u;
+					v[3].x = v[2].x;
+					v[3].y = v[2].y;
+					v[3].u = v[2].u;
+				}
+
+				// === 计算最右侧的两个点 ===
+				tVecLength += lenOffsetA;
+				if (i == m_Queue.size() - 2)
+				{
+					float expX = expandVec.x * scale * next.half_width;
+					float expY = expandVec.y * scale * next.half_width;
+					v[1].x = next.pos.x + expX;
+					v[1].y = next.pos.y + expY;
+					v[1].u = tex_left + tex_width;
+					v[2].x = next.pos.x - expX;
+					v[2].y = next.pos.y - expY;
+					v[2].u = tex_left + tex_width;
+				}
+				else
+				{
+					float expX, expY;
+					const LaserNode& afterNext = m_Queue[i + 2];
+
+					fcyVec2 offsetB = afterNext.pos - next.pos;
+					fcyVec2 angleBisect = offsetA.GetNormalize() + offsetB.GetNormalize();
+					float angleBisectLen = angleBisect.Length();
+
+					if (angleBisectLen < 0.00002f || angleBisectLen > 1.99998f)
+					{
+						expX = expandVec.x * scale * next.half_width;
+						expY = expandVec.y * scale * next.half_width;
+					}
+					else
+					{
+						angleBisect *= (1 / angleBisectLen);
+						float t = angleBisect * offsetA.GetNormalize();
+						float l = scale * next.half_width;
+						float expandDelta = sqrt(l * l / (1.f - t * t));
+						expX = angleBisect.x * expandDelta;
+						expY = angleBisect.y * expandDelta;
+					}
+
+					float u = tex_left + tVecLength / m_fLength * tex_width;
+					v[1].x = next.pos.x + expX;
+					v[1].y = next.pos.y + expY;
+					v[1].u = u;
+					v[2].x = next.pos.x - expX;
+					v[2].y = next.pos.y - expY;
+					v[2].u = u;
+
+					// 修正交叉的情况
+					float cross1 = fcyVec2(v[1].x - v[0].x, v[1].y - v[0].y) * fcyVec2(v[2].x - v[3].x, v[2].y - v[3].y);
+					float cross2 = fcyVec2(v[2].x - v[0].x, v[2].y - v[0].y) * fcyVec2(v[1].x - v[3].x, v[1].y - v[3].y);
+					if (cross2 > cross1)
+					{
+						std::swap(v[1].x, v[2].x);
+						std::swap(v[1].y, v[2].y);
+					}
+				}
+
+				out.push_back(renderVertex);
+			}
+		}
+	public:
+		BentLaser(size_t maxNode)
+			: m_iMaxSize(maxNode) {}
+	};
+}
+
+/// @brief 曲线激光的测试用例
+struct BentLaserCase
+{
+	const char* name;
+	vector<fcyVec2> nodes;  // 依次加入的节点坐标
+	vector<float> widths;  // 各节点的宽度，为空时均为16
+	int length;  // 传给Update的length
+};
+
+static void RunBentLaserCase(const BentLaserCase& test)
+{
+	const float tTexWidth = 256.f, tTexHeight = 128.f;
+	const float tTexLeft = 32.f, tTexTop = 16.f, tTexW = 128.f, tTexH = 32.f;
+	const float tScale = 1.5f;
+	const fcyColor tColor(255, 200, 100, 50);
+	const size_t tMaxNode = 64;
+
+	Baseline::BentLaser tOld(tMaxNode);
+	GameObjectBentLaser* pNew = GameObjectBentLaser::AllocInstance(tMaxNode);
+	for (size_t i = 0; i < test.nodes.size(); ++i)
+	{
+		float tWidth = test.widths.empty() ? 16.f : test.widths[i];
+		tOld.Update(test.nodes[i], test.length, tWidth);
+		pNew->PushNode(test.nodes[i].x, test.nodes[i].y, test.length, tWidth);
+	}
+
+	vector<Quad> tOldQuads;
+	tOld.Render(tOldQuads, tColor, tTexLeft, tTexTop, tTexW, tTexH, tScale);
+
+	vector<f2dGraphics2DVertex> tVerts(pNew->GetNodeCount() * 2);
+	size_t tVertCount = pNew->BuildVertices(tVerts.data(), tColor, tTexLeft / tTexWidth, tTexW / tTexWidth,
+		tTexTop / tTexHeight, (tTexTop + tTexH) / tTexHeight, tScale);
+	size_t tSegCount = tVertCount / 2 - 1;
+
+	CHECK(tVertCount == pNew->GetNodeCount() * 2, test.name, 0);
+	CHECK(tSegCount == tOldQuads.size(), test.name, 0);
+
+	// 由索引缓冲还原每段的四边形: 三角形(0, 1, 2)和(0, 2, 3)
+	const fuShort* pIndex = GameObjectBentLaser::GetIndexBuffer();
+	for (size_t s = 0; s < tSegCount && s < tOldQuads.size(); ++s)
+	{
+		const fuShort* p = &pIndex[s * 6];
+		CHECK(p[3] == p[0] && p[4] == p[2], test.name, s);
+		const fuShort tCorner[4] = { p[0], p[1], p[2], p[5] };
+
+		for (int k = 0; k < 4; ++k)
+		{
+			const f2dGraphics2DVertex& a = tOldQuads[s].v[k];
+			const f2dGraphics2DVertex& b = tVerts[tCorner[k]];
+			CHECK(NearlyEqual(a.x, b.x) && NearlyEqual(a.y, b.y), test.name, s);
+			CHECK(NearlyEqual(a.u / tTexWidth, b.u) && NearlyEqual(a.v / tTexHeight, b.v), test.name, s);
+			CHECK(a.z == b.z && a.color == b.color, test.name, s);
+		}
+	}
+
+	GameObjectBentLaser::FreeInstance(pNew);
+	printf("  %-14s %2u segment(s)\n", test.name, (unsigned)tSegCount);
+}
+
+static void RunBentLaserTests()
+{
+	vector<BentLaserCase> tCases;
+
+	// 直线，节点数超过length，覆盖队首移出与环形缓冲区回绕
+	{
+		BentLaserCase t = { "straight" };
+		for (int i = 0; i < 40; ++i)
+			t.nodes.push_back(fcyVec2(-100.f + i * 5.f, 20.f + i * 2.f));
+		t.length = 24;
+		tCases.push_back(t);
+	}
+
+	// 急转弯，转角依次为约150度、90度和170度
+	{
+		BentLaserCase t = { "sharp turn" };
+		t.nodes.push_back(fcyVec2(0.f, 0.f));
+		t.nodes.push_back(fcyVec2(40.f, 0.f));
+		t.nodes.push_back(fcyVec2(80.f, 0.f));
+		t.nodes.push_back(fcyVec2(45.f, 20.f));
+		t.nodes.push_back(fcyVec2(10.f, 40.f));
+		t.nodes.push_back(fcyVec2(10.f, 80.f));
+		t.nodes.push_back(fcyVec2(50.f, 80.f));
+		t.nodes.push_back(fcyVec2(10.f, 84.f));
+		t.nodes.push_back(fcyVec2(-30.f, 88.f));
+		t.length = 32;
+		tCases.push_back(t);
+	}
+
+	// 沿圆弧前进，宽度逐节点变化
+	{
+		BentLaserCase t = { "width change" };
+		for (int i = 0; i < 20; ++i)
+		{
+			float a = i * 0.25f;
+			t.nodes.push_back(fcyVec2(60.f * cos(a), 60.f * sin(a)));
+			t.widths.push_back(4.f + (i % 5) * 6.f);
+		}
+		t.length = 32;
+		tCases.push_back(t);
+	}
+
+	// 只有两个节点
+	{
+		BentLaserCase t = { "2 nodes" };
+		t.nodes.push_back(fcyVec2(-10.f, 5.f));
+		t.nodes.push_back(fcyVec2(30.f, -25.f));
+		t.length = 2;
+		tCases.push_back(t);
+	}
+
+	printf("bent laser:\n");
+	for (size_t i = 0; i < tCases.size(); ++i)
+		RunBentLaserCase(tCases[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// 粒子
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief 记录绘制调用的设备
+struct RecordingDevice
+{
+	struct Batch
+	{
+		vector<f2dGraphics2DVertex> vertex;
+		vector<fuShort> index;
+	};
+	vector<Quad> quads;  // DrawQuad
+	vector<Batch> batches;  // DrawRaw
+
+	bool DrawQuad(const f2dGraphics2DVertex vertex[])
+	{
+		Quad t;
+		memcpy(t.v, vertex, sizeof(t.v));
+		quads.push_back(t);
+		return true;
+	}
+	bool DrawRaw(const f2dGraphics2DVertex* vertex, fuInt vertCount, const fuShort* index, fuInt indexCount)
+	{
+		Batch t;
+		t.vertex.assign(vertex, vertex + vertCount);
+		t.index.assign(index, index + indexCount);
+		batches.push_back(t);
+		return true;
+	}
+};
+
+namespace Baseline
+{
+	/// @brief 精灵，只包含粒子绘制用到的部分
+	/// @note  顶点的生成同f2dSprite::Draw2: 以热点为原点的四边形先缩放、再旋转，最后平移到中心
+	class Sprite
+	{
+	private:
+		fcyRect m_TexRect;
+		fcyVec2 m_HotSpot;
+		float m_fTexWidth, m_fTexHeight;
+		float m_fZ;
+		fcyColor m_Color[4];
+	public:
+		fcyColor GetColor(fuInt idx)const { return m_Color[idx]; }
+		void SetColor(fcyColor c) { m_Color[0] = m_Color[1] = m_Color[2] = m_Color[3] = c; }
+		void Draw2(RecordingDevice& graph, const fcyVec2& center, const fcyVec2& scale, float rotation)const
+		{
+			fcyRect tRect(-m_HotSpot.x, m_HotSpot.y, m_TexRect.GetWidth() - m_HotSpot.x, m_HotSpot.y - m_TexRect.GetHeight());
+			fcyRect tUV(m_TexRect.a.x / m_fTexWidth, m_TexRect.a.y / m_fTexHeight, m_TexRect.b.x / m_fTexWidth, m_TexRect.b.y / m_fTexHeight);
+			f2dGraphics2DVertex tVerts[4] =
+			{
+				{ tRect.a.x, tRect.a.y, m_fZ, m_Color[0].argb, tUV.a.x, tUV.a.y },
+				{ tRect.b.x, tRect.a.y, m_fZ, m_Color[1].argb, tUV.b.x, tUV.a.y },
+				{ tRect.b.x, tRect.b.y, m_fZ, m_Color[2].argb, tUV.b.x, tUV.b.y },
+				{ tRect.a.x, tRect.b.y, m_fZ, m_Color[3].argb, tUV.a.x, tUV.b.y }
+			};
+
+			float tSin = sin(rotation);
+			float tCos = cos(rotation);
+			for (int i = 0; i < 4; ++i)
+			{
+				float tx = tVerts[i].x * scale.x;
+				float ty = tVerts[i].y * scale.y;
+				tVerts[i].x = tx * tCos - ty * tSin + center.x;
+				tVerts[i].y = tx * tSin + ty * tCos + center.y;
+			}
+			graph.DrawQuad(tVerts);
+		}
+	public:
+		Sprite(const fcyRect& texRect, fcyVec2 hotSpot, float texWidth, float texHeight, float z, fcyColor c)
+			: m_TexRect(texRect), m_HotSpot(hotSpot), m_fTexWidth(texWidth), m_fTexHeight(texHeight), m_fZ(z)
+		{
+			SetColor(c);
+		}
+	};
+
+	/// @brief 原先的ParticlePool::Render，逐个粒子设置精灵颜色后调用Draw2
+	static void RenderParticles(RecordingDevice& graph, Sprite& sprite, bool alphaOnly, const ResParticle::ParticleStorage& d, size_t count,
+		float scaleX, float scaleY)
+	{
+		fcyColor tOrgColor = sprite.GetColor(0U);
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (alphaOnly)
+				sprite.SetColor(fcyColor((int)(d.colColor[3][i] * 255), tOrgColor.r, tOrgColor.g, tOrgColor.b));
+			else
+				sprite.SetColor(fcyColor(d.colColor[3][i], d.colColor[0][i], d.colColor[1][i], d.colColor[2][i]));
+			sprite.Draw2(graph, fcyVec2(d.vecLocationX[i], d.vecLocationY[i]), fcyVec2(scaleX * d.fSize[i], scaleY * d.fSize[i]), d.fSpin[i]);
+		}
+		sprite.SetColor(tOrgColor);
+	}
+}
+
+static void RunParticleCase(const char* name, bool alphaOnly, size_t count)
+{
+	// 偏离中心的热点，渲染时x、y方向缩放不同
+	const fcyRect tTexRect(40.f, 24.f, 72.f, 40.f);
+	const fcyVec2 tHotSpot(6.f, 13.f);
+	const float tTexWidth = 256.f, tTexHeight = 128.f;
+	const float tZ = 0.25f;
+	const fcyColor tOrgColor(200, 10, 20, 30);
+	const float tScaleX = 1.25f, tScaleY = 0.75f;
+
+	// 随机的位置、旋转、大小与逐粒子颜色
+	mt19937 tRnd((unsigned)count);
+	uniform_real_distribution<float> tPos(-200.f, 200.f), tSpin(-10.f, 10.f), tSize(0.2f, 3.f), tColor(0.f, 1.f);
+	vector<float> tX(count), tY(count), tSpinData(count), tSizeData(count), tColorData[4];
+	for (int c = 0; c < 4; ++c)
+		tColorData[c].resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		tX[i] = tPos(tRnd);
+		tY[i] = tPos(tRnd);
+		tSpinData[i] = tSpin(tRnd);
+		tSizeData[i] = tSize(tRnd);
+		for (int c = 0; c < 4; ++c)
+			tColorData[c][i] = tColor(tRnd);
+	}
+	ResParticle::ParticleStorage d;
+	memset(&d, 0, sizeof(d));
+	d.vecLocationX = tX.data();
+	d.vecLocationY = tY.data();
+	d.fSpin = tSpinData.data();
+	d.fSize = tSizeData.data();
+	for (int c = 0; c < 4; ++c)
+		d.colColor[c] = tColorData[c].data();
+
+	RecordingDevice tOld;
+	Baseline::Sprite tSprite(tTexRect, tHotSpot, tTexWidth, tTexHeight, tZ, tOrgColor);
+	Baseline::RenderParticles(tOld, tSprite, alphaOnly, d, count, tScaleX, tScaleY);
+
+	RecordingDevice tNew;
+	ParticleQuadBuilder tBuilder(tTexRect, tHotSpot, tTexWidth, tTexHeight, tZ, tOrgColor, alphaOnly, tScaleX, tScaleY);
+	bool bRet = SubmitParticleBatches(tBuilder, d, count, [&](const f2dGraphics2DVertex* vertex, fuInt vertCount, const fuShort* index, fuInt indexCount) -> bool {
+		return tNew.DrawRaw(vertex, vertCount, index, indexCount);
+	});
+
+	CHECK(bRet, name, 0);
+	CHECK(tOld.quads.size() == count, name, 0);
+	CHECK(tNew.batches.size() == (count + LPARTICLE_BATCHSIZE - 1) / LPARTICLE_BATCHSIZE, name, 0);
+
+	// 由每批的索引还原粒子的四边形: 三角形(0, 1, 2)和(0, 2, 3)
+	size_t tParticle = 0;
+	for (size_t b = 0; b < tNew.batches.size(); ++b)
+	{
+		const RecordingDevice::Batch& tBatch = tNew.batches[b];
+		CHECK(tBatch.vertex.size() <= LPARTICLE_BATCHSIZE * 4, name, b);
+		CHECK(tBatch.vertex.size() % 4 == 0 && tBatch.index.size() == tBatch.vertex.size() / 4 * 6, name, b);
+
+		for (size_t q = 0; q * 6 < tBatch.index.size() && tParticle < tOld.quads.size(); ++q, ++tParticle)
+		{
+			const fuShort* p = &tBatch.index[q * 6];
+			CHECK(p[3] == p[0] && p[4] == p[2], name, tParticle);
+			const fuShort tCorner[4] = { p[0], p[1], p[2], p[5] };
+			for (int k = 0; k < 4; ++k)
+			{
+				CHECK(tCorner[k] < tBatch.vertex.size(), name, tParticle);
+				if (tCorner[k] < tBatch.vertex.size())
+					CHECK(NearlyEqual(tOld.quads[tParticle].v[k], tBatch.vertex[tCorner[k]]), name, tParticle);
+			}
+		}
+	}
+	CHECK(tParticle == count, name, tParticle);
+
+	// 原先的实现在绘制结束时恢复精灵颜色
+	CHECK(tSprite.GetColor(0U).argb == tOrgColor.argb, name, 0);
+
+	printf("  %-14s %4u particle(s), %u batch(es)\n", name, (unsigned)count, (unsigned)tNew.batches.size());
+}
+
+static void RunParticleTests()
+{
+	printf("particle:\n");
+	RunParticleCase("color", false, LPARTICLE_BATCHSIZE * 2 + 88);
+	RunParticleCase("alpha only", true, LPARTICLE_BATCHSIZE * 2 + 88);
+	RunParticleCase("full batch", false, LPARTICLE_BATCHSIZE);
+	RunParticleCase("single", true, 1);
+}
+
+int main()
+{
+	RunBentLaserTests();
+	RunParticleTests();
+	if (s_iFailures > 0)
+	{
+		printf("render test FAILED: %d check(s)\n", s_iFailures);
+		return 1;
+	}
+	printf("render test passed\n");
+	return 0;
+}
@@ -0,0 +1,397 @@
+-- 基准测试场景
+-- 依次执行scenes中的场景，每个场景先预热WARMUP_FRAMES帧使对象数达到稳定，再执行SCENE_FRAMES帧
+-- 以/benchmark启动时，预热帧记入名为"warmup:场景名"的场景，其余帧记入以场景名命名的场景
+-- 所有场景执行完毕后FrameFunc返回true，程序退出并写出报告
+-- 以/scene:场景名启动时只执行该场景，可以重复指定多个场景
+-- 每个场景结束时将lstg.ObjFrame与lstg.UpdateParticles的平均耗时写到日志，这部分只依赖os.clock，可以在不支持/benchmark的旧版本上对比
+-- 旧版本在ObjFrame中更新粒子池，没有lstg.UpdateParticles，对比时应以两者之和为准
+
+local WARMUP_FRAMES = 120
+local SCENE_FRAMES = 600
+
+local GROUP_PLAYER = 1
+local GROUP_BULLET = 2
+
+local function Nop()
+end
+
+local rand = lstg.Rand()
+local laser_color = lstg.Color(255, 255, 255, 255)
+
+local player
+local bullet_count = 0
+local hit_count = 0
+local emitters = {}
+local snapshot_stat = {}
+
+---------------------------------------- 对象类
+
+-- 自机，沿圆周移动，接受子弹的碰撞
+local Player = {
+	is_class = true,
+	function(self)  -- init
+		self.img = "bench_bullet"
+		self.group = GROUP_PLAYER
+		self.layer = 20
+		self.bound = false
+		self.a, self.b = 2, 2
+	end,
+	Nop,  -- del
+	function(self)  -- frame
+		local t = self.timer * 0.03
+		self.x = 120 * math.cos(t)
+		self.y = -160 + 60 * math.sin(t)
+	end,
+	lstg.DefaultRenderFunc,  -- render
+	function(self, other)  -- colli
+		hit_count = hit_count + 1
+	end,
+	Nop,  -- kill
+}
+
+local function OnBulletRemoved(self)
+	bullet_count = bullet_count - 1
+end
+
+-- 直线运动的子弹，出界后删除
+local Bullet = {
+	is_class = true,
+	function(self, x, y, speed, angle)  -- init
+		self.img = "bench_bullet"
+		self.group = GROUP_BULLET
+		self.layer = 10
+		self.x, self.y = x, y
+		lstg.SetV(self, speed, angle, true)
+		bullet_count = bullet_count + 1
+	end,
+	OnBulletRemoved,  -- del
+	Nop,  -- frame
+	lstg.DefaultRenderFunc,  -- render
+	Nop,  -- colli
+	OnBulletRemoved,  -- kill
+}
+
+-- 追踪自机的子弹，每帧至多转向3度，不会出界删除
+local HomingBullet = {
+	is_class = true,
+	function(self, x, y)  -- init
+		self.img = "bench_bullet"
+		self.group = GROUP_BULLET
+		self.layer = 10
+		self.bound = false
+		self.x, self.y = x, y
+		self.heading = rand:Float(0, 360)
+		bullet_count = bullet_count + 1
+	end,
+	OnBulletRemoved,  -- del
+	function(self)  -- frame
+		local d = (lstg.Angle(self, player) - self.heading + 180) % 360 - 180
+		if d > 3 then
+			d = 3
+		elseif d < -3 then
+			d = -3
+		end
+		self.heading = self.heading + d
+		lstg.SetV(self, 2, self.heading, true)
+	end,
+	lstg.DefaultRenderFunc,  -- render
+	Nop,  -- colli
+	OnBulletRemoved,  -- kill
+}
+
+-- 曲线激光，头部沿李萨如曲线移动
+local Laser = {
+	is_class = true,
+	function(self, index)  -- init
+		self.bound = false
+		self.colli = false
+		self.layer = 5
+		self.phase = index * 0.7
+		self.data = lstg.BentLaserData()
+	end,
+	Nop,  -- del
+	function(self)  -- frame
+		local t = self.timer * 0.02 + self.phase
+		self.x = 180 * math.sin(t * 1.3)
+		self.y = 40 + 180 * math.sin(t * 0.7)
+		self.data:Update(self, 64, 12)
+		if self.data:CollisionCheck(player.x, player.y) then
+			hit_count = hit_count + 1
+		end
+	end,
+	function(self)  -- render
+		self.data:Render("bench_tex", "mul+add", laser_color, 0, 16, 32, 16)
+	end,
+	Nop,  -- colli
+	Nop,  -- kill
+}
+
+-- 粒子发射器，在原位附近左右摆动
+local Emitter = {
+	is_class = true,
+	function(self, x, y, emission)  -- init
+		self.img = "bench_ps"
+		self.bound = false
+		self.colli = false
+		self.layer = 0
+		self.x, self.y = x, y
+		self.x0 = x
+		lstg.ParticleFire(self)
+		lstg.ParticleSetEmission(self, emission)
+		table.insert(emitters, self)
+	end,
+	Nop,  -- del
+	function(self)  -- frame
+		self.x = self.x0 + 16 * math.sin(self.timer * 0.05)
+	end,
+	lstg.DefaultRenderFunc,  -- render
+	Nop,  -- colli
+	Nop,  -- kill
+}
+
+-- 静止的对象，用于填满对象池
+local Filler = {
+	is_class = true,
+	function(self, x, y)  -- init
+		self.img = "bench_bullet"
+		self.bound = false
+		self.colli = false
+		self.layer = 10
+		self.x, self.y = x, y
+	end,
+	Nop,  -- del
+	Nop,  -- frame
+	lstg.DefaultRenderFunc,  -- render
+	Nop,  -- colli
+	Nop,  -- kill
+}
+
+local function FireRing(x, y, n, speed, angle)
+	for i = 0, n - 1 do
+		lstg.New(Bullet, x, y, speed, angle + 360 * i / n)
+	end
+end
+
+---------------------------------------- 场景
+
+-- 场景的init在场景开始时调用，frame在每帧执行对象更新前调用，参数为场景开始以来的帧数
+-- finish可选，在场景结束时调用，返回的字符串附加在日志末尾
+local scenes = {
+	-- 自屏幕上方持续发射100发一圈的环形弹，场上维持约1万发子弹
+	{
+		name = "ring_spam",
+		frame = function(t)
+			if bullet_count < 10000 then
+				FireRing(0, 120, 100, 1.5, t * 7)
+			end
+		end,
+	},
+	-- 500发追踪弹
+	{
+		name = "homing",
+		init = function()
+			for i = 1, 500 do
+				lstg.New(HomingBullet, rand:Float(-200, 200), rand:Float(0, 240))
+			end
+		end,
+	},
+	-- 30条曲线激光
+	{
+		name = "bent_laser",
+		init = function()
+			for i = 1, 30 do
+				lstg.New(Laser, i)
+			end
+		end,
+	},
+	-- 200个粒子发射器，每个约200个存活粒子
+	{
+		name = "particle_emitter",
+		init = function()
+			for i = 0, 199 do
+				lstg.New(Emitter, -190 + (i % 20) * 20, -180 + math.floor(i / 20) * 40, 100)
+			end
+		end,
+	},
+	-- 512个粒子发射器，每个500个存活粒子，用于对比粒子池的更新开销
+	-- 粒子寿命为2秒，预热结束时各粒子池恰好达到稳定的粒子数
+	{
+		name = "particle_512x500",
+		init = function()
+			for i = 0, 511 do
+				lstg.New(Emitter, -186 + (i % 32) * 12, -240 + math.floor(i / 32) * 30, 250)
+			end
+		end,
+	},
+	-- 每60帧中先用10帧铺满1万发慢速子弹，再在第40帧将其全部消除
+	{
+		name = "mass_clear",
+		frame = function(t)
+			local c = t % 60
+			if c < 10 then
+				for i = 1, 10 do
+					FireRing(rand:Float(-150, 150), rand:Float(0, 200), 100, 0.3, rand:Float(0, 360))
+				end
+			elseif c == 40 then
+				for _, obj in lstg.ObjList(GROUP_BULLET) do
+					lstg.Kill(obj)
+				end
+			end
+		end,
+	},
+	-- 对象池满载(连同自机共32768个对象)时每帧保存并恢复一次快照，测量快照的耗时
+	-- 旧版本没有lstg.SavePoolState，此时只测量满载时的ObjFrame
+	{
+		name = "snapshot_32768",
+		init = function()
+			snapshot_stat = { save = 0, load = 0, frames = 0, size = 0 }
+			for i = 0, 32766 do
+				lstg.New(Filler, -191 + (i % 192) * 2, -238 + math.floor(i / 192) * 2.8)
+			end
+		end,
+		frame = function(t)
+			if not lstg.SavePoolState then
+				return
+			end
+			local t0 = os.clock()
+			snapshot_stat.size = lstg.SavePoolState(1)
+			local t1 = os.clock()
+			assert(lstg.LoadPoolState(1), "can't load pool state.")
+			if t >= WARMUP_FRAMES then
+				snapshot_stat.save = snapshot_stat.save + t1 - t0
+				snapshot_stat.load = snapshot_stat.load + os.clock() - t1
+				snapshot_stat.frames = snapshot_stat.frames + 1
+			end
+		end,
+		finish = function()
+			if snapshot_stat.frames == 0 then
+				return ""
+			end
+			lstg.ClearPoolState(1)
+			return string.format(", SavePoolState %.3f ms, LoadPoolState %.3f ms, %d bytes", snapshot_stat.save * 1000 / snapshot_stat.frames,
+				snapshot_stat.load * 1000 / snapshot_stat.frames, snapshot_stat.size)
+		end,
+	},
+}
+
+-- 按/scene参数筛选场景，未指定时执行全部场景
+do
+	local selected = {}
+	for _, arg in pairs(lstg.args) do
+		local name = string.match(arg, "^/scene:(.+)$")
+		if name then
+			selected[name] = true
+		end
+	end
+	if next(selected) then
+		local filtered = {}
+		for _, scene in ipairs(scenes) do
+			if selected[scene.name] then
+				table.insert(filtered, scene)
+			end
+		end
+		assert(#filtered > 0, "no scene matches the /scene arguments.")
+		scenes = filtered
+	end
+end
+
+local scene_index = 0
+local scene_timer = 0
+local objframe_time = 0
+local particle_time = 0
+
+-- 旧版本没有lstg.BenchmarkScene
+local function MarkScene(name)
+	if lstg.BenchmarkScene then
+		lstg.BenchmarkScene(name)
+	end
+end
+
+local function StartScene(index)
+	lstg.ResetPool()
+	bullet_count = 0
+	hit_count = 0
+	emitters = {}
+	objframe_time = 0
+	particle_time = 0
+	rand:Seed(index)
+	player = lstg.New(Player)
+
+	local scene = scenes[index]
+	if scene.init then
+		scene.init()
+	end
+	MarkScene("warmup:" .. scene.name)
+	scene_index, scene_timer = index, 0
+end
+
+local function FinishScene()
+	local particles = 0
+	for _, obj in ipairs(emitters) do
+		particles = particles + lstg.ParticleGetn(obj)
+	end
+	local scene = scenes[scene_index]
+	lstg.Print(string.format("benchmark: %s finished, %d objects, %d particles, %d hits, ObjFrame %.3f ms/frame, UpdateParticles %.3f ms/frame%s",
+		scene.name, lstg.GetnObj(), particles, hit_count, objframe_time * 1000 / SCENE_FRAMES, particle_time * 1000 / SCENE_FRAMES,
+		scene.finish and scene.finish() or ""))
+end
+
+---------------------------------------- 全局回调
+
+function GameInit()
+	lstg.SetBound(-224, 224, -256, 256)
+	lstg.LoadTexture("bench_tex", "bench.png")
+	lstg.LoadImage("bench_bullet", "bench_tex", 0, 0, 16, 16, 4, 4)
+	lstg.LoadImage("bench_spark", "bench_tex", 16, 0, 16, 16)
+	lstg.LoadPS("bench_ps", "spark.psi", "bench_spark")
+	StartScene(1)
+end
+
+function FrameFunc()
+	-- 场景切换放在帧开头，使切换所在的帧记入新场景
+	if scene_timer == WARMUP_FRAMES + SCENE_FRAMES then
+		StartScene(scene_index + 1)
+	elseif scene_timer == WARMUP_FRAMES then
+		MarkScene(scenes[scene_index].name)
+	end
+
+	local scene = scenes[scene_index]
+	if scene.frame then
+		scene.frame(scene_timer)
+	end
+
+	local t0 = os.clock()
+	lstg.ObjFrame()
+	local t1 = os.clock()
+	if lstg.UpdateParticles then
+		lstg.UpdateParticles()
+	end
+	if scene_timer >= WARMUP_FRAMES then
+		objframe_time = objframe_time + t1 - t0
+		particle_time = particle_time + os.clock() - t1
+	end
+	lstg.BoundCheck()
+	lstg.CollisionCheck(GROUP_PLAYER, GROUP_BULLET)
+	lstg.UpdateXY()
+	lstg.AfterFrame()
+
+	scene_timer = scene_timer + 1
+	if scene_timer == WARMUP_FRAMES + SCENE_FRAMES then
+		FinishScene()
+		return scene_index == #scenes
+	end
+	return false
+end
+
+-- 窗口模式下运行时需要
+FocusLoseFunc = Nop
+FocusGainFunc = Nop
+
+function RenderFunc()
+	lstg.BeginScene()
+	lstg.RenderClear(lstg.Color(255, 0, 0, 0))
+	lstg.SetViewport(0, 640, 0, 480)
+	lstg.SetOrtho(-320, 320, -240, 240)
+	lstg.ObjRender()
+	lstg.EndScene()
+end
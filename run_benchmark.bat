@@ -0,0 +1,13 @@
+@echo off
+rem Runs the canned scenes in benchmark\ headlessly and writes the JSON report.
+rem Usage: run_benchmark.bat [report path relative to benchmark\] [engine exe]
+setlocal
+set REPORT=%~1
+if "%REPORT%"=="" set REPORT=report.json
+set ENGINE=%~2
+if "%ENGINE%"=="" set ENGINE=%~dp0LuaSTGPlus\bin\LuaSTGPlus.exe
+pushd "%~dp0benchmark"
+"%ENGINE%" /benchmark:%REPORT%
+set RESULT=%ERRORLEVEL%
+popd
+exit /b %RESULT%